@@ -0,0 +1,64 @@
+// Copyright (c) 2024 The Bitbi Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockencodings.h>
+#include <consensus/amount.h>
+#include <kernel/mempool_entry.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <test/util/txmempool.h>
+#include <txmempool.h>
+#include <util/check.h>
+#include <validation.h>
+
+#include <vector>
+
+static constexpr size_t MEMPOOL_TXS{50000};
+static constexpr size_t BLOCK_TXS{3000};
+
+// Reconstruct a compact block of transactions that are all in a large mempool,
+// which is dominated by computing the short ID of every mempool transaction.
+static void BlockEncodingInitData(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>();
+    CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
+
+    CBlock block;
+    block.nBits = 0x207fffff;
+    {
+        LOCK2(cs_main, pool.cs);
+        TestMemPoolEntryHelper entry;
+        for (size_t i = 0; i < MEMPOOL_TXS; ++i) {
+            CMutableTransaction tx;
+            tx.vin.resize(1);
+            tx.vin[0].prevout.n = i;
+            tx.vout.resize(1);
+            tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            tx.vout[0].nValue = i;
+            const CTransactionRef ref{MakeTransactionRef(tx)};
+            pool.addUnchecked(entry.Fee(1000).FromTx(ref));
+            if (i == 0) {
+                // Stands in for the coinbase, which is always prefilled.
+                block.vtx.push_back(ref);
+            } else if (i % (MEMPOOL_TXS / BLOCK_TXS) == 0) {
+                block.vtx.push_back(ref);
+            }
+        }
+    }
+    const CBlockHeaderAndShortTxIDs cmpctblock{block};
+    const std::vector<std::pair<uint256, CTransactionRef>> extra_txn;
+
+    bench.run([&] {
+        PartiallyDownloadedBlock partial_block{&pool};
+        const auto status{partial_block.InitData(cmpctblock, extra_txn)};
+        assert(status == READ_STATUS_OK);
+    });
+}
+
+BENCHMARK(BlockEncodingInitData, benchmark::PriorityLevel::HIGH);
@@ -196,6 +196,16 @@ static void SipHash_32b(benchmark::Bench& bench)
     });
 }
 
+static void SipHash_32b_x4(benchmark::Bench& bench)
+{
+    std::array<uint256, 4> x{};
+    uint64_t k1 = 0;
+    bench.batch(4).unit("hash").run([&] {
+        const auto hashes{SipHashUint256x4(0, ++k1, {&x[0], &x[1], &x[2], &x[3]})};
+        for (int i = 0; i < 4; ++i) *((uint64_t*)x[i].begin()) = hashes[i];
+    });
+}
+
 static void FastRandom_32bit(benchmark::Bench& bench)
 {
     FastRandomContext rng(true);
@@ -223,8 +233,9 @@ static void MuHash(benchmark::Bench& bench)
     });
 }
 
-static void MuHashMul(benchmark::Bench& bench)
+static void MuHashMul_STANDARD(benchmark::Bench& bench)
 {
+    bench.name(strprintf("%s using the '%s' MuHash3072 implementation", __func__, MuHash3072AutoDetect(muhash_implementation::STANDARD)));
     MuHash3072 acc;
     FastRandomContext rng(true);
     MuHash3072 muhash{rng.randbytes(32)};
@@ -232,10 +243,25 @@ static void MuHashMul(benchmark::Bench& bench)
     bench.run([&] {
         acc *= muhash;
     });
+    MuHash3072AutoDetect();
 }
 
-static void MuHashDiv(benchmark::Bench& bench)
+static void MuHashMul_X86_MULX(benchmark::Bench& bench)
 {
+    bench.name(strprintf("%s using the '%s' MuHash3072 implementation", __func__, MuHash3072AutoDetect(muhash_implementation::USE_X86_MULX)));
+    MuHash3072 acc;
+    FastRandomContext rng(true);
+    MuHash3072 muhash{rng.randbytes(32)};
+
+    bench.run([&] {
+        acc *= muhash;
+    });
+    MuHash3072AutoDetect();
+}
+
+static void MuHashDiv_STANDARD(benchmark::Bench& bench)
+{
+    bench.name(strprintf("%s using the '%s' MuHash3072 implementation", __func__, MuHash3072AutoDetect(muhash_implementation::STANDARD)));
     MuHash3072 acc;
     FastRandomContext rng(true);
     MuHash3072 muhash{rng.randbytes(32)};
@@ -243,6 +269,48 @@ static void MuHashDiv(benchmark::Bench& bench)
     bench.run([&] {
         acc /= muhash;
     });
+    MuHash3072AutoDetect();
+}
+
+static void MuHashDiv_X86_MULX(benchmark::Bench& bench)
+{
+    bench.name(strprintf("%s using the '%s' MuHash3072 implementation", __func__, MuHash3072AutoDetect(muhash_implementation::USE_X86_MULX)));
+    MuHash3072 acc;
+    FastRandomContext rng(true);
+    MuHash3072 muhash{rng.randbytes(32)};
+
+    bench.run([&] {
+        acc /= muhash;
+    });
+    MuHash3072AutoDetect();
+}
+
+static void MuHashFinalize_STANDARD(benchmark::Bench& bench)
+{
+    bench.name(strprintf("%s using the '%s' MuHash3072 implementation", __func__, MuHash3072AutoDetect(muhash_implementation::STANDARD)));
+    FastRandomContext rng(true);
+    MuHash3072 muhash{rng.randbytes(32)};
+    muhash /= MuHash3072{rng.randbytes(32)};
+    uint256 out;
+
+    bench.run([&] {
+        muhash.Finalize(out);
+    });
+    MuHash3072AutoDetect();
+}
+
+static void MuHashFinalize_X86_MULX(benchmark::Bench& bench)
+{
+    bench.name(strprintf("%s using the '%s' MuHash3072 implementation", __func__, MuHash3072AutoDetect(muhash_implementation::USE_X86_MULX)));
+    FastRandomContext rng(true);
+    MuHash3072 muhash{rng.randbytes(32)};
+    muhash /= MuHash3072{rng.randbytes(32)};
+    uint256 out;
+
+    bench.run([&] {
+        muhash.Finalize(out);
+    });
+    MuHash3072AutoDetect();
 }
 
 static void MuHashPrecompute(benchmark::Bench& bench)
@@ -270,6 +338,7 @@ BENCHMARK(SHA256_32b_SSE4, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SHA256_32b_AVX2, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SHA256_32b_SHANI, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SipHash_32b, benchmark::PriorityLevel::HIGH);
+BENCHMARK(SipHash_32b_x4, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SHA256D64_1024_STANDARD, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SHA256D64_1024_SSE4, benchmark::PriorityLevel::HIGH);
 BENCHMARK(SHA256D64_1024_AVX2, benchmark::PriorityLevel::HIGH);
@@ -278,6 +347,10 @@ BENCHMARK(FastRandom_32bit, benchmark::PriorityLevel::HIGH);
 BENCHMARK(FastRandom_1bit, benchmark::PriorityLevel::HIGH);
 
 BENCHMARK(MuHash, benchmark::PriorityLevel::HIGH);
-BENCHMARK(MuHashMul, benchmark::PriorityLevel::HIGH);
-BENCHMARK(MuHashDiv, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MuHashMul_STANDARD, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MuHashMul_X86_MULX, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MuHashDiv_STANDARD, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MuHashDiv_X86_MULX, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MuHashFinalize_STANDARD, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MuHashFinalize_X86_MULX, benchmark::PriorityLevel::HIGH);
 BENCHMARK(MuHashPrecompute, benchmark::PriorityLevel::HIGH);
@@ -103,6 +103,31 @@ static void ComplexMemPool(benchmark::Bench& bench)
     });
 }
 
+static void MempoolRemoveForBlock(benchmark::Bench& bench)
+{
+    FastRandomContext det_rand{true};
+    int childTxs = 800;
+    if (bench.complexityN() > 1) {
+        childTxs = static_cast<int>(bench.complexityN());
+    }
+    std::vector<CTransactionRef> ordered_coins = CreateOrderedCoins(det_rand, childTxs, /*min_ancestors=*/1);
+    // The coins are in topological order, so any prefix is a valid block, and
+    // leaves plenty of in-mempool descendants to update.
+    const std::vector<CTransactionRef> block_txs(ordered_coins.begin(), ordered_coins.begin() + ordered_coins.size() / 2);
+    const std::vector<CTransactionRef> later_txs(ordered_coins.begin() + ordered_coins.size() / 2, ordered_coins.end());
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>(ChainType::MAIN);
+    CTxMemPool& pool = *testing_setup.get()->m_node.mempool;
+    LOCK2(cs_main, pool.cs);
+    bench.run([&]() NO_THREAD_SAFETY_ANALYSIS {
+        for (auto& tx : ordered_coins) {
+            AddTx(tx, pool);
+        }
+        pool.removeForBlock(block_txs, /*nBlockHeight=*/1);
+        pool.removeForBlock(later_txs, /*nBlockHeight=*/2);
+        assert(pool.size() == 0);
+    });
+}
+
 static void MempoolCheck(benchmark::Bench& bench)
 {
     FastRandomContext det_rand{true};
@@ -119,4 +144,5 @@ static void MempoolCheck(benchmark::Bench& bench)
 }
 
 BENCHMARK(ComplexMemPool, benchmark::PriorityLevel::HIGH);
+BENCHMARK(MempoolRemoveForBlock, benchmark::PriorityLevel::HIGH);
 BENCHMARK(MempoolCheck, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,57 @@
+// Copyright (c) 2024 The Bitbi Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <kernel/mempool_entry.h>
+#include <policy/fees.h>
+#include <primitives/transaction.h>
+#include <test/util/setup_common.h>
+#include <test/util/txmempool.h>
+
+#include <vector>
+
+static constexpr int TXS_PER_BLOCK{200};
+
+// Feed a block's worth of transactions through the estimator, confirm them,
+// and ask for estimates at a few targets, as the RPC and the wallet would.
+static void PolicyEstimatorBlock(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    CBlockPolicyEstimator estimator{testing_setup->m_path_root / "fee_estimates.dat", /*read_stale_estimates=*/false};
+
+    std::vector<CTransactionRef> txs;
+    for (int i = 0; i < TXS_PER_BLOCK; ++i) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.n = i;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        txs.push_back(MakeTransactionRef(tx));
+    }
+
+    unsigned int height{1};
+    bench.run([&] {
+        TestMemPoolEntryHelper entry;
+        entry.Height(height);
+        std::vector<CTxMemPoolEntry> entries;
+        entries.reserve(txs.size());
+        for (size_t i = 0; i < txs.size(); ++i) {
+            // Vary the feerate across the buckets
+            entries.push_back(entry.Fee(1000 + 100 * i).FromTx(txs[i]));
+            estimator.processTransaction(entries.back(), /*validFeeEstimate=*/true);
+        }
+        std::vector<const CTxMemPoolEntry*> block;
+        for (const auto& e : entries) block.push_back(&e);
+        estimator.processBlock(++height, block);
+        for (int target : {2, 6, 25, 144}) {
+            for (bool conservative : {false, true}) {
+                FeeCalculation calc;
+                ankerl::nanobench::doNotOptimizeAway(estimator.estimateSmartFee(target, &calc, conservative));
+                ankerl::nanobench::doNotOptimizeAway(estimator.estimateSmartFee(target, nullptr, conservative));
+            }
+        }
+    });
+}
+
+BENCHMARK(PolicyEstimatorBlock, benchmark::PriorityLevel::HIGH);
@@ -0,0 +1,50 @@
+// Copyright (c) 2024 The Bitbi Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <txrequest.h>
+#include <uint256.h>
+
+#include <chrono>
+#include <vector>
+
+static constexpr int NUM_PEERS{125};
+static constexpr int NUM_TXS{1000};
+
+// Every transaction is announced by every peer, as happens for transactions
+// relayed across the network, then every peer is asked for what to request, as
+// SendMessages does each time it visits the peer, and the selected
+// announcements are requested and answered.
+static void TxRequestAnnounceAndRequest(benchmark::Bench& bench)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<uint256> txhashes;
+    for (int i = 0; i < NUM_TXS; ++i) txhashes.push_back(rng.rand256());
+
+    bench.run([&] {
+        TxRequestTracker tracker{/*deterministic=*/true};
+        std::chrono::microseconds now{1'000'000};
+        for (const uint256& txhash : txhashes) {
+            for (NodeId peer = 0; peer < NUM_PEERS; ++peer) {
+                tracker.ReceivedInv(peer, GenTxid::Wtxid(txhash), /*preferred=*/peer % 4 == 0, now + std::chrono::seconds{peer % 3});
+            }
+            now += std::chrono::microseconds{100};
+        }
+        std::vector<std::pair<NodeId, GenTxid>> expired;
+        while (tracker.Size()) {
+            now += std::chrono::milliseconds{100};
+            for (NodeId peer = 0; peer < NUM_PEERS; ++peer) {
+                for (const GenTxid& gtxid : tracker.GetRequestable(peer, now, &expired)) {
+                    tracker.RequestedTx(peer, gtxid.GetHash(), now + std::chrono::seconds{60});
+                    tracker.ReceivedResponse(peer, gtxid.GetHash());
+                    tracker.ForgetTxHash(gtxid.GetHash());
+                }
+            }
+        }
+    });
+}
+
+BENCHMARK(TxRequestAnnounceAndRequest, benchmark::PriorityLevel::HIGH);
@@ -15,7 +15,72 @@
 #include <txmempool.h>
 #include <validation.h>
 
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <vector>
+
+namespace {
+/**
+ * Open-addressing table from short IDs to positions in a block, built once per compact block
+ * and probed once per mempool transaction. Slots are picked by multiply-shift hashing with a
+ * random odd multiplier, so that a peer cannot choose short IDs that pile up in one probe
+ * sequence.
+ */
+class ShortIdTable
+{
+    /** Marks an empty slot. Short IDs only have 48 bits, so this is never a valid one. */
+    static constexpr uint64_t EMPTY{~uint64_t{0}};
+    /** Longest probe sequence accepted when inserting. With a load factor of at most 1/2, longer
+     *  sequences are vanishingly unlikely for honest (uniformly distributed) short IDs. */
+    static constexpr size_t MAX_PROBE{64};
+
+    struct Slot {
+        uint64_t shortid{EMPTY};
+        uint16_t index{0};
+    };
+
+    std::vector<Slot> m_slots;
+    const uint64_t m_multiplier{GetRand<uint64_t>() | 1};
+    int m_shift{64};
+
+    size_t Home(uint64_t shortid) const { return (shortid * m_multiplier) >> m_shift; }
+
+public:
+    explicit ShortIdTable(size_t count)
+    {
+        size_t size{16};
+        while (size < 2 * count) size *= 2;
+        m_slots.resize(size);
+        while ((size_t{1} << (64 - m_shift)) < size) --m_shift;
+    }
+
+    /** Add a short ID. Returns false if it is already present, or if its probe sequence is
+     *  too long. */
+    bool Insert(uint64_t shortid, uint16_t index)
+    {
+        const size_t mask{m_slots.size() - 1};
+        for (size_t i = Home(shortid), probe = 0; probe < MAX_PROBE; i = (i + 1) & mask, ++probe) {
+            if (m_slots[i].shortid == shortid) return false;
+            if (m_slots[i].shortid == EMPTY) {
+                m_slots[i] = {shortid, index};
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::optional<uint16_t> Find(uint64_t shortid) const
+    {
+        const size_t mask{m_slots.size() - 1};
+        for (size_t i = Home(shortid), probe = 0; probe < MAX_PROBE; i = (i + 1) & mask, ++probe) {
+            if (m_slots[i].shortid == shortid) return m_slots[i].index;
+            if (m_slots[i].shortid == EMPTY) break;
+        }
+        return std::nullopt;
+    }
+};
+} // namespace
 
 CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block) :
         nonce(GetRand<uint64_t>()),
@@ -42,7 +107,7 @@ void CBlockHeaderAndShortTxIDs::FillShortTxIDSelector() const {
 
 uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txhash) const {
     static_assert(SHORTTXIDS_LENGTH == 6, "shorttxids calculation assumes 6-byte shorttxids");
-    return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & 0xffffffffffffL;
+    return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & SHORTTXID_MASK;
 }
 
 
@@ -80,47 +145,31 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     // Because well-formed cmpctblock messages will have a (relatively) uniform distribution
     // of short IDs, any highly-uneven distribution of elements can be safely treated as a
     // READ_STATUS_FAILED.
-    std::unordered_map<uint64_t, uint16_t> shorttxids(cmpctblock.shorttxids.size());
+    ShortIdTable shorttxids(cmpctblock.shorttxids.size());
     uint16_t index_offset = 0;
     for (size_t i = 0; i < cmpctblock.shorttxids.size(); i++) {
         while (txn_available[i + index_offset])
             index_offset++;
-        shorttxids[cmpctblock.shorttxids[i]] = i + index_offset;
-        // To determine the chance that the number of entries in a bucket exceeds N,
-        // we use the fact that the number of elements in a single bucket is
-        // binomially distributed (with n = the number of shorttxids S, and p =
-        // 1 / the number of buckets), that in the worst case the number of buckets is
-        // equal to S (due to std::unordered_map having a default load factor of 1.0),
-        // and that the chance for any bucket to exceed N elements is at most
-        // buckets * (the chance that any given bucket is above N elements).
-        // Thus: P(max_elements_per_bucket > N) <= S * (1 - cdf(binomial(n=S,p=1/S), N)).
-        // If we assume blocks of up to 16000, allowing 12 elements per bucket should
-        // only fail once per ~1 million block transfers (per peer and connection).
-        if (shorttxids.bucket_size(shorttxids.bucket(cmpctblock.shorttxids[i])) > 12)
-            return READ_STATUS_FAILED;
+        // TODO: in the shortid-collision case, we should instead request both transactions
+        // which collided. Falling back to full-block-request here is overkill.
+        if (!shorttxids.Insert(cmpctblock.shorttxids[i], i + index_offset))
+            return READ_STATUS_FAILED; // Short ID collision, or too uneven a distribution
     }
-    // TODO: in the shortid-collision case, we should instead request both transactions
-    // which collided. Falling back to full-block-request here is overkill.
-    if (shorttxids.size() != cmpctblock.shorttxids.size())
-        return READ_STATUS_FAILED; // Short ID collision
 
     std::vector<bool> have_txn(txn_available.size());
-    {
-    LOCK(pool->cs);
-    for (size_t i = 0; i < pool->vTxHashes.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(pool->vTxHashes[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = pool->vTxHashes[i].second->GetSharedTx();
-                have_txn[idit->second]  = true;
+    // Returns whether every short ID has been matched.
+    const auto match_mempool_tx = [&](uint64_t shortid, const CTxMemPoolEntry& entry) {
+        if (const auto index{shorttxids.Find(shortid)}) {
+            if (!have_txn[*index]) {
+                txn_available[*index] = entry.GetSharedTx();
+                have_txn[*index]  = true;
                 mempool_count++;
             } else {
                 // If we find two mempool txn that match the short id, just request it.
                 // This should be rare enough that the extra bandwidth doesn't matter,
                 // but eating a round-trip due to FillBlock failure would be annoying
-                if (txn_available[idit->second]) {
-                    txn_available[idit->second].reset();
+                if (txn_available[*index]) {
+                    txn_available[*index].reset();
                     mempool_count--;
                 }
             }
@@ -128,18 +177,32 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
         // Though ideally we'd continue scanning for the two-txn-match-shortid case,
         // the performance win of an early exit here is too good to pass up and worth
         // the extra risk.
-        if (mempool_count == shorttxids.size())
-            break;
+        return mempool_count == cmpctblock.shorttxids.size();
+    };
+    {
+    LOCK(pool->cs);
+    const auto& tx_hashes{pool->vTxHashes};
+    // Hash four transactions at a time; the last batch is padded with repeats of its last hash.
+    for (size_t i = 0; i < tx_hashes.size(); i += 4) {
+        const size_t lanes{std::min<size_t>(4, tx_hashes.size() - i)};
+        std::array<const uint256*, 4> hashes;
+        for (size_t lane = 0; lane < 4; ++lane) {
+            hashes[lane] = &tx_hashes[i + std::min(lane, lanes - 1)].first;
+        }
+        const auto shortids{SipHashUint256x4(cmpctblock.shorttxidk0, cmpctblock.shorttxidk1, hashes)};
+        bool done{false};
+        for (size_t lane = 0; lane < lanes && !done; ++lane) {
+            done = match_mempool_tx(shortids[lane] & CBlockHeaderAndShortTxIDs::SHORTTXID_MASK, *tx_hashes[i + lane].second);
+        }
+        if (done) break;
     }
     }
 
     for (size_t i = 0; i < extra_txn.size(); i++) {
-        uint64_t shortid = cmpctblock.GetShortID(extra_txn[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = extra_txn[i].second;
-                have_txn[idit->second]  = true;
+        if (const auto index{shorttxids.Find(cmpctblock.GetShortID(extra_txn[i].first))}) {
+            if (!have_txn[*index]) {
+                txn_available[*index] = extra_txn[i].second;
+                have_txn[*index]  = true;
                 mempool_count++;
                 extra_count++;
             } else {
@@ -149,9 +212,9 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
                 // but eating a round-trip due to FillBlock failure would be annoying
                 // Note that we don't want duplication between extra_txn and mempool to
                 // trigger this case, so we compare witness hashes first
-                if (txn_available[idit->second] &&
-                        txn_available[idit->second]->GetWitnessHash() != extra_txn[i].second->GetWitnessHash()) {
-                    txn_available[idit->second].reset();
+                if (txn_available[*index] &&
+                        txn_available[*index]->GetWitnessHash() != extra_txn[i].second->GetWitnessHash()) {
+                    txn_available[*index].reset();
                     mempool_count--;
                     extra_count--;
                 }
@@ -160,7 +223,7 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
         // Though ideally we'd continue scanning for the two-txn-match-shortid case,
         // the performance win of an early exit here is too good to pass up and worth
         // the extra risk.
-        if (mempool_count == shorttxids.size())
+        if (mempool_count == cmpctblock.shorttxids.size())
             break;
     }
 
@@ -103,6 +103,7 @@ protected:
 
 public:
     static constexpr int SHORTTXIDS_LENGTH = 6;
+    static constexpr uint64_t SHORTTXID_MASK{0xffffffffffff};
 
     CBlockHeader header;
 
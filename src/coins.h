@@ -19,7 +19,9 @@
 #include <stdint.h>
 
 #include <functional>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 /**
  * A UTXO entry.
@@ -197,6 +199,11 @@ public:
     //! Get a cursor to iterate over the whole state
     virtual std::unique_ptr<CCoinsViewCursor> Cursor() const;
 
+    //! Get up to count cursors over disjoint, ascending txid ranges that
+    //! together iterate over the whole state as of a single point in time.
+    //! Returns an empty vector if not supported.
+    virtual std::vector<std::unique_ptr<CCoinsViewCursor>> ShardedCursors(unsigned int count) const;
+
     //! As we use CCoinsViews polymorphically, have a virtual destructor
     virtual ~CCoinsView() {}
 
@@ -220,6 +227,7 @@ public:
     void SetBackend(CCoinsView &viewIn);
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
+    std::vector<std::unique_ptr<CCoinsViewCursor>> ShardedCursors(unsigned int count) const override;
     size_t EstimateSize() const override;
 };
 
@@ -259,6 +267,9 @@ public:
     std::unique_ptr<CCoinsViewCursor> Cursor() const override {
         throw std::logic_error("CCoinsViewCache cursor iteration not supported.");
     }
+    std::vector<std::unique_ptr<CCoinsViewCursor>> ShardedCursors(unsigned int count) const override {
+        throw std::logic_error("CCoinsViewCache cursor iteration not supported.");
+    }
 
     /**
      * Check if we have the given utxo already loaded in this cache.
@@ -92,7 +92,7 @@ unsigned int GetSpecialScriptSize(unsigned int nSize)
     return 0;
 }
 
-bool DecompressScript(CScript& script, unsigned int nSize, const CompressedScript& in)
+unsigned int PrepareSpecialScript(CScript& script, unsigned int nSize)
 {
     switch(nSize) {
     case 0x00:
@@ -100,25 +100,37 @@ bool DecompressScript(CScript& script, unsigned int nSize, const CompressedScrip
         script[0] = OP_DUP;
         script[1] = OP_HASH160;
         script[2] = 20;
-        memcpy(&script[3], in.data(), 20);
         script[23] = OP_EQUALVERIFY;
         script[24] = OP_CHECKSIG;
-        return true;
+        return 3;
     case 0x01:
         script.resize(23);
         script[0] = OP_HASH160;
         script[1] = 20;
-        memcpy(&script[2], in.data(), 20);
         script[22] = OP_EQUAL;
-        return true;
+        return 2;
     case 0x02:
     case 0x03:
         script.resize(35);
         script[0] = 33;
         script[1] = nSize;
-        memcpy(&script[2], in.data(), 32);
         script[34] = OP_CHECKSIG;
+        return 2;
+    }
+    assert(false);
+}
+
+bool DecompressScript(CScript& script, unsigned int nSize, const CompressedScript& in)
+{
+    switch(nSize) {
+    case 0x00:
+    case 0x01:
+    case 0x02:
+    case 0x03: {
+        const unsigned int pos = PrepareSpecialScript(script, nSize);
+        memcpy(&script[pos], in.data(), GetSpecialScriptSize(nSize));
         return true;
+    }
     case 0x04:
     case 0x05:
         unsigned char vch[33] = {};
@@ -26,6 +26,13 @@ using CompressedScript = prevector<33, unsigned char>;
 bool CompressScript(const CScript& script, CompressedScript& out);
 unsigned int GetSpecialScriptSize(unsigned int nSize);
 bool DecompressScript(CScript& script, unsigned int nSize, const CompressedScript& in);
+/**
+ * Resize script to special script type nSize (0x00-0x03) and fill in its
+ * opcodes, leaving the payload bytes to be written by the caller.
+ *
+ * @returns the offset of the GetSpecialScriptSize(nSize) payload bytes in script
+ */
+unsigned int PrepareSpecialScript(CScript& script, unsigned int nSize);
 
 /**
  * Compress amount.
@@ -77,6 +84,12 @@ struct ScriptCompression
     void Unser(Stream &s, CScript& script) {
         unsigned int nSize = 0;
         s >> VARINT(nSize);
+        if (nSize < 0x04) {
+            // The payload is stored verbatim; read it directly into place.
+            const unsigned int pos = PrepareSpecialScript(script, nSize);
+            s >> Span{script}.subspan(pos, GetSpecialScriptSize(nSize));
+            return;
+        }
         if (nSize < nSpecialScripts) {
             CompressedScript vch(GetSpecialScriptSize(nSize), 0x00);
             s >> Span{vch};
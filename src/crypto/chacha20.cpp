@@ -7,12 +7,43 @@
 
 #include <crypto/common.h>
 #include <crypto/chacha20.h>
+#include <compat/cpuid.h>
 #include <support/cleanse.h>
 #include <span.h>
 
 #include <algorithm>
+#include <limits>
 #include <string.h>
 
+#if defined(ENABLE_AVX2) && defined(HAVE_GETCPUID)
+namespace chacha20_avx2
+{
+/** Output eight consecutive blocks, XORed with in unless it is nullptr. The block counter must not wrap within them. */
+void Crypt_8way(const uint32_t* input, const unsigned char* in, unsigned char* out);
+}
+
+namespace {
+/** Whether the CPU supports AVX2 and the OS has enabled the AVX registers. */
+bool HaveAVX2()
+{
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_xsave = (ecx >> 27) & 1;
+    const bool have_avx = (ecx >> 28) & 1;
+    if (!have_xsave || !have_avx) return false;
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    if ((a & 6) != 6) return false;
+    GetCPUID(0, 0, eax, ebx, ecx, edx);
+    if (eax < 7) return false;
+    GetCPUID(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 5) & 1;
+}
+
+const bool g_use_avx2{HaveAVX2()};
+} // namespace
+#endif
+
 constexpr static inline uint32_t rotl32(uint32_t v, int c) { return (v << c) | (v >> (32 - c)); }
 
 #define QUARTERROUND(a,b,c,d) \
@@ -23,6 +54,22 @@ constexpr static inline uint32_t rotl32(uint32_t v, int c) { return (v << c) | (
 
 #define REPEAT10(a) do { {a}; {a}; {a}; {a}; {a}; {a}; {a}; {a}; {a}; {a}; } while(0)
 
+/** Process blocks eight at a time where the CPU allows it, leaving the rest to the caller. m may be nullptr. */
+static inline void Crypt8Way(uint32_t* input, const unsigned char*& m, unsigned char*& c, size_t& blocks)
+{
+#if defined(ENABLE_AVX2) && defined(HAVE_GETCPUID)
+    if (!g_use_avx2) return;
+    while (blocks >= 8 && input[8] <= std::numeric_limits<uint32_t>::max() - 7) {
+        chacha20_avx2::Crypt_8way(input, m, c);
+        input[8] += 8;
+        if (!input[8]) ++input[9];
+        if (m) m += 8 * ChaCha20Aligned::BLOCKLEN;
+        c += 8 * ChaCha20Aligned::BLOCKLEN;
+        blocks -= 8;
+    }
+#endif
+}
+
 void ChaCha20Aligned::SetKey(Span<const std::byte> key) noexcept
 {
     assert(key.size() == KEYLEN);
@@ -64,6 +111,9 @@ inline void ChaCha20Aligned::Keystream(Span<std::byte> output) noexcept
     size_t blocks = output.size() / BLOCKLEN;
     assert(blocks * BLOCKLEN == output.size());
 
+    const unsigned char* m = nullptr;
+    Crypt8Way(input, m, c, blocks);
+
     uint32_t x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15;
     uint32_t j4, j5, j6, j7, j8, j9, j10, j11, j12, j13, j14, j15;
 
@@ -167,6 +217,8 @@ inline void ChaCha20Aligned::Crypt(Span<const std::byte> in_bytes, Span<std::byt
     size_t blocks = out_bytes.size() / BLOCKLEN;
     assert(blocks * BLOCKLEN == out_bytes.size());
 
+    Crypt8Way(input, m, c, blocks);
+
     uint32_t x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15;
     uint32_t j4, j5, j6, j7, j8, j9, j10, j11, j12, j13, j14, j15;
 
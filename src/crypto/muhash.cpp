@@ -8,12 +8,27 @@
 #include <crypto/common.h>
 #include <hash.h>
 
+#include <compat/cpuid.h>
+
 #include <cassert>
 #include <cstdio>
 #include <limits>
 
+#if defined(__x86_64__) || defined(__amd64__)
+#if defined(USE_ASM)
+namespace muhash_x86_mulx
+{
+void Multiply(uint64_t* out, const uint64_t* a, const uint64_t* b);
+}
+#endif
+#endif
+
 namespace {
 
+/** Optimized implementation of out = a * b (mod 2^3072 - 1103717), not necessarily fully reduced.
+ *  out may alias a or b. Null if only the standard implementation is available. */
+void (*MultiplyImpl)(uint64_t* out, const uint64_t* a, const uint64_t* b) = nullptr;
+
 using limb_t = Num3072::limb_t;
 using double_limb_t = Num3072::double_limb_t;
 constexpr int LIMB_SIZE = Num3072::LIMB_SIZE;
@@ -180,6 +195,14 @@ Num3072 Num3072::GetInverse() const
 
 void Num3072::Multiply(const Num3072& a)
 {
+    if constexpr (LIMB_SIZE == 64) {
+        if (MultiplyImpl) {
+            MultiplyImpl(reinterpret_cast<uint64_t*>(this->limbs), reinterpret_cast<const uint64_t*>(this->limbs), reinterpret_cast<const uint64_t*>(a.limbs));
+            if (this->IsOverflow()) this->FullReduce();
+            return;
+        }
+    }
+
     limb_t c0 = 0, c1 = 0, c2 = 0;
     Num3072 tmp;
 
@@ -217,6 +240,14 @@ void Num3072::Multiply(const Num3072& a)
 
 void Num3072::Square()
 {
+    if constexpr (LIMB_SIZE == 64) {
+        if (MultiplyImpl) {
+            MultiplyImpl(reinterpret_cast<uint64_t*>(this->limbs), reinterpret_cast<const uint64_t*>(this->limbs), reinterpret_cast<const uint64_t*>(this->limbs));
+            if (this->IsOverflow()) this->FullReduce();
+            return;
+        }
+    }
+
     limb_t c0 = 0, c1 = 0, c2 = 0;
     Num3072 tmp;
 
@@ -275,6 +306,30 @@ void Num3072::Divide(const Num3072& a)
     if (this->IsOverflow()) this->FullReduce();
 }
 
+std::string MuHash3072AutoDetect(muhash_implementation::UseImplementation use_implementation)
+{
+    std::string ret = "standard";
+    MultiplyImpl = nullptr;
+
+#if defined(USE_ASM) && defined(HAVE_GETCPUID) && (defined(__x86_64__) || defined(__amd64__))
+    if constexpr (LIMB_SIZE == 64) {
+        uint32_t eax, ebx, ecx, edx;
+        GetCPUID(0, 0, eax, ebx, ecx, edx);
+        if (eax >= 7 && (use_implementation & muhash_implementation::USE_X86_MULX)) {
+            GetCPUID(7, 0, eax, ebx, ecx, edx);
+            const bool have_bmi2 = (ebx >> 8) & 1;
+            const bool have_adx = (ebx >> 19) & 1;
+            if (have_bmi2 && have_adx) {
+                MultiplyImpl = muhash_x86_mulx::Multiply;
+                ret = "x86_mulx";
+            }
+        }
+    }
+#endif
+
+    return ret;
+}
+
 Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE]) {
     for (int i = 0; i < LIMBS; ++i) {
         if (sizeof(limb_t) == 4) {
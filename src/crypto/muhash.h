@@ -13,6 +13,7 @@
 #include <uint256.h>
 
 #include <stdint.h>
+#include <string>
 
 class Num3072
 {
@@ -128,4 +129,17 @@ public:
     }
 };
 
+namespace muhash_implementation {
+enum UseImplementation : uint8_t {
+    STANDARD = 0,
+    USE_X86_MULX = 1 << 0,
+    USE_ALL = USE_X86_MULX,
+};
+}
+
+/** Autodetect the best available Num3072 multiplication implementation.
+ *  Returns the name of the implementation.
+ */
+std::string MuHash3072AutoDetect(muhash_implementation::UseImplementation use_implementation = muhash_implementation::USE_ALL);
+
 #endif // BITCOIN_CRYPTO_MUHASH_H
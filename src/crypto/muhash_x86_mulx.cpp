@@ -0,0 +1,78 @@
+// Copyright (c) 2024 The Bitbi Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// Num3072 multiplication using the BMI2 mulx and ADX adcx/adox instructions,
+// which allow the low and high halves of the partial products to be
+// accumulated in two independent carry chains.
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+namespace muhash_x86_mulx
+{
+namespace {
+
+constexpr int LIMBS = 48;
+/** 2^3072 - 1103717 is the modulus, see muhash.cpp. */
+constexpr uint64_t MAX_PRIME_DIFF = 1103717;
+
+/** t[0..48] += a * b[0..47]. Requires t[48] to be zero on entry. */
+inline void MulAddRow(uint64_t* t, uint64_t a, const uint64_t* b)
+{
+    __asm__ __volatile__(
+        "xorl %%r10d, %%r10d\n\t" // clears CF and OF, r10 holds the previous high half
+#define MULX_STEP(j) \
+        "mulx " #j "*8(%[b]), %%r8, %%r9\n\t" \
+        "adcx " #j "*8(%[t]), %%r8\n\t" \
+        "adox %%r10, %%r8\n\t" \
+        "movq %%r8, " #j "*8(%[t])\n\t" \
+        "movq %%r9, %%r10\n\t"
+        MULX_STEP(0) MULX_STEP(1) MULX_STEP(2) MULX_STEP(3) MULX_STEP(4) MULX_STEP(5)
+        MULX_STEP(6) MULX_STEP(7) MULX_STEP(8) MULX_STEP(9) MULX_STEP(10) MULX_STEP(11)
+        MULX_STEP(12) MULX_STEP(13) MULX_STEP(14) MULX_STEP(15) MULX_STEP(16) MULX_STEP(17)
+        MULX_STEP(18) MULX_STEP(19) MULX_STEP(20) MULX_STEP(21) MULX_STEP(22) MULX_STEP(23)
+        MULX_STEP(24) MULX_STEP(25) MULX_STEP(26) MULX_STEP(27) MULX_STEP(28) MULX_STEP(29)
+        MULX_STEP(30) MULX_STEP(31) MULX_STEP(32) MULX_STEP(33) MULX_STEP(34) MULX_STEP(35)
+        MULX_STEP(36) MULX_STEP(37) MULX_STEP(38) MULX_STEP(39) MULX_STEP(40) MULX_STEP(41)
+        MULX_STEP(42) MULX_STEP(43) MULX_STEP(44) MULX_STEP(45) MULX_STEP(46) MULX_STEP(47)
+#undef MULX_STEP
+        "movl $0, %%r8d\n\t"
+        "adcx %%r8, %%r10\n\t"
+        "adox %%r8, %%r10\n\t"
+        "movq %%r10, 48*8(%[t])\n\t"
+        :
+        : [t] "r"(t), [b] "r"(b), "d"(a)
+        : "r8", "r9", "r10", "cc", "memory");
+}
+
+} // namespace
+
+void Multiply(uint64_t* out, const uint64_t* a, const uint64_t* b)
+{
+    uint64_t t[2 * LIMBS + 1] = {0};
+    for (int i = 0; i < LIMBS; ++i) MulAddRow(t + i, a[i], b);
+
+    /* Reduce the 6144-bit product using 2^3072 = MAX_PRIME_DIFF (mod p). */
+    uint64_t carry = 0;
+    for (int j = 0; j < LIMBS; ++j) {
+        unsigned __int128 x = (unsigned __int128)t[LIMBS + j] * MAX_PRIME_DIFF + t[j] + carry;
+        out[j] = (uint64_t)x;
+        carry = (uint64_t)(x >> 64);
+    }
+    /* Fold the remaining carry back in, which overflows again at most once. */
+    while (carry) {
+        unsigned __int128 x = (unsigned __int128)carry * MAX_PRIME_DIFF + out[0];
+        out[0] = (uint64_t)x;
+        carry = (uint64_t)(x >> 64);
+        for (int j = 1; carry && j < LIMBS; ++j) {
+            out[j] += carry;
+            carry = out[j] < carry;
+        }
+    }
+}
+
+} // namespace muhash_x86_mulx
+
+#endif
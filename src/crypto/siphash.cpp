@@ -15,6 +15,16 @@
     v2 = ROTL(v2, 32); \
 } while (0)
 
+/** SIPROUND on two independent states, interleaved so that their dependency chains overlap. */
+#define SIPROUND_X2 do { \
+    v0 += v1; w0 += w1; v1 = ROTL(v1, 13); w1 = ROTL(w1, 13); v1 ^= v0; w1 ^= w0; \
+    v0 = ROTL(v0, 32); w0 = ROTL(w0, 32); \
+    v2 += v3; w2 += w3; v3 = ROTL(v3, 16); w3 = ROTL(w3, 16); v3 ^= v2; w3 ^= w2; \
+    v0 += v3; w0 += w3; v3 = ROTL(v3, 21); w3 = ROTL(w3, 21); v3 ^= v0; w3 ^= w0; \
+    v2 += v1; w2 += w1; v1 = ROTL(v1, 17); w1 = ROTL(w1, 17); v1 ^= v2; w1 ^= w2; \
+    v2 = ROTL(v2, 32); w2 = ROTL(w2, 32); \
+} while (0)
+
 CSipHasher::CSipHasher(uint64_t k0, uint64_t k1)
 {
     v[0] = 0x736f6d6570736575ULL ^ k0;
@@ -172,3 +182,68 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+namespace {
+/** Same as SipHashUint256, on two values at once. */
+void SipHashUint256x2(uint64_t k0, uint64_t k1, const uint256& val_a, const uint256& val_b, uint64_t& out_a, uint64_t& out_b)
+{
+    uint64_t d = val_a.GetUint64(0), e = val_b.GetUint64(0);
+    uint64_t v0 = 0x736f6d6570736575ULL ^ k0;
+    uint64_t v1 = 0x646f72616e646f6dULL ^ k1;
+    uint64_t v2 = 0x6c7967656e657261ULL ^ k0;
+    uint64_t v3 = 0x7465646279746573ULL ^ k1;
+    uint64_t w0 = v0, w1 = v1, w2 = v2, w3 = v3 ^ e;
+    v3 ^= d;
+
+    SIPROUND_X2;
+    SIPROUND_X2;
+    v0 ^= d;
+    w0 ^= e;
+    d = val_a.GetUint64(1);
+    e = val_b.GetUint64(1);
+    v3 ^= d;
+    w3 ^= e;
+    SIPROUND_X2;
+    SIPROUND_X2;
+    v0 ^= d;
+    w0 ^= e;
+    d = val_a.GetUint64(2);
+    e = val_b.GetUint64(2);
+    v3 ^= d;
+    w3 ^= e;
+    SIPROUND_X2;
+    SIPROUND_X2;
+    v0 ^= d;
+    w0 ^= e;
+    d = val_a.GetUint64(3);
+    e = val_b.GetUint64(3);
+    v3 ^= d;
+    w3 ^= e;
+    SIPROUND_X2;
+    SIPROUND_X2;
+    v0 ^= d;
+    w0 ^= e;
+    v3 ^= (uint64_t{4}) << 59;
+    w3 ^= (uint64_t{4}) << 59;
+    SIPROUND_X2;
+    SIPROUND_X2;
+    v0 ^= (uint64_t{4}) << 59;
+    w0 ^= (uint64_t{4}) << 59;
+    v2 ^= 0xFF;
+    w2 ^= 0xFF;
+    SIPROUND_X2;
+    SIPROUND_X2;
+    SIPROUND_X2;
+    SIPROUND_X2;
+    out_a = v0 ^ v1 ^ v2 ^ v3;
+    out_b = w0 ^ w1 ^ w2 ^ w3;
+}
+} // namespace
+
+std::array<uint64_t, 4> SipHashUint256x4(uint64_t k0, uint64_t k1, const std::array<const uint256*, 4>& vals)
+{
+    std::array<uint64_t, 4> out;
+    SipHashUint256x2(k0, k1, *vals[0], *vals[1], out[0], out[1]);
+    SipHashUint256x2(k0, k1, *vals[2], *vals[3], out[2], out[3]);
+    return out;
+}
@@ -5,6 +5,7 @@
 #ifndef BITCOIN_CRYPTO_SIPHASH_H
 #define BITCOIN_CRYPTO_SIPHASH_H
 
+#include <array>
 #include <stdint.h>
 
 #include <span.h>
@@ -45,4 +46,12 @@ public:
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
 
+/** Compute SipHashUint256 of four values at once.
+ *
+ *  The computations are independent and interleaved in pairs, so that the CPU can overlap
+ *  their dependency chains. Used to hash many values under the same key,
+ *  e.g. the short IDs of all mempool transactions for a compact block.
+ */
+std::array<uint64_t, 4> SipHashUint256x4(uint64_t k0, uint64_t k1, const std::array<const uint256*, 4>& vals);
+
 #endif // BITCOIN_CRYPTO_SIPHASH_H
@@ -395,6 +395,21 @@ CDBIterator* CDBWrapper::NewIterator()
     return new CDBIterator{*this, std::make_unique<CDBIterator::IteratorImpl>(DBContext().pdb->NewIterator(DBContext().iteroptions))};
 }
 
+std::vector<std::unique_ptr<CDBIterator>> CDBWrapper::NewIterators(size_t count)
+{
+    leveldb::ReadOptions options{DBContext().iteroptions};
+    options.snapshot = DBContext().pdb->GetSnapshot();
+    std::vector<std::unique_ptr<CDBIterator>> iterators;
+    iterators.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        iterators.push_back(std::make_unique<CDBIterator>(*this, std::make_unique<CDBIterator::IteratorImpl>(DBContext().pdb->NewIterator(options))));
+    }
+    // Iterators pin the state they were created at by themselves, so the
+    // snapshot is only needed while creating them.
+    DBContext().pdb->ReleaseSnapshot(options.snapshot);
+    return iterators;
+}
+
 void CDBIterator::SeekImpl(Span<const std::byte> key)
 {
     leveldb::Slice slKey(CharCast(key.data()), key.size());
@@ -166,8 +166,7 @@ public:
 
     template<typename V> bool GetValue(V& value) {
         try {
-            DataStream ssValue{GetValueImpl()};
-            ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
+            XorSpanReader ssValue{GetValueImpl(), MakeByteSpan(dbwrapper_private::GetObfuscateKey(parent))};
             ssValue >> value;
         } catch (const std::exception&) {
             return false;
@@ -228,8 +227,9 @@ public:
             return false;
         }
         try {
-            DataStream ssValue{MakeByteSpan(*strValue)};
-            ssValue.Xor(obfuscate_key);
+            // Deserialize straight from the value returned by leveldb,
+            // de-obfuscating while reading instead of via a temporary copy.
+            XorSpanReader ssValue{MakeByteSpan(*strValue), MakeByteSpan(obfuscate_key)};
             ssValue >> value;
         } catch (const std::exception&) {
             return false;
@@ -277,6 +277,13 @@ public:
 
     CDBIterator* NewIterator();
 
+    /**
+     * Create count iterators that all see the database as of the same point
+     * in time, so that they can be used to walk disjoint key ranges in
+     * parallel.
+     */
+    std::vector<std::unique_ptr<CDBIterator>> NewIterators(size_t count);
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
@@ -20,19 +20,27 @@
 #include <uint256.h>
 #include <util/check.h>
 #include <util/overflow.h>
+#include <util/threadnames.h>
 #include <validation.h>
 #include <version.h>
 
+#include <algorithm>
 #include <cassert>
+#include <future>
 #include <iosfwd>
 #include <iterator>
-#include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
+#include <variant>
+#include <vector>
 
 namespace kernel {
 
+//! Maximum number of threads used to walk the UTXO set for order-independent statistics
+static constexpr unsigned int MAX_UTXO_STATS_SHARDS{16};
+
 CCoinsStats::CCoinsStats(int block_height, const uint256& block_hash)
     : nHeight(block_height),
       hashBlock(block_hash) {}
@@ -89,62 +97,153 @@ static void ApplyCoinHash(std::nullptr_t, const COutPoint& outpoint, const Coin&
 //! It is also possible, though very unlikely, that a change in this
 //! construction could cause a previously invalid (and potentially malicious)
 //! UTXO snapshot to be considered valid.
+//!
+//! Coins are hashed one by one in coins database order.
 template <typename T>
-static void ApplyHash(T& hash_obj, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+static void ApplyHash(T& hash_obj, const COutPoint& outpoint, const Coin& coin)
+{
+    ApplyCoinHash(hash_obj, outpoint, coin);
+}
+
+static void ApplyStats(CCoinsStats& stats, bool new_tx, const Coin& coin)
 {
-    for (auto it = outputs.begin(); it != outputs.end(); ++it) {
-        COutPoint outpoint = COutPoint(hash, it->first);
-        Coin coin = it->second;
-        ApplyCoinHash(hash_obj, outpoint, coin);
+    if (new_tx) stats.nTransactions++;
+    stats.nTransactionOutputs++;
+    if (stats.total_amount.has_value()) {
+        stats.total_amount = CheckedAdd(*stats.total_amount, coin.out.nValue);
     }
+    stats.nBogoSize += GetBogoSize(coin.out.scriptPubKey);
 }
 
-static void ApplyStats(CCoinsStats& stats, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+static void FinalizeHash(HashWriter& ss, CCoinsStats& stats)
 {
-    assert(!outputs.empty());
-    stats.nTransactions++;
-    for (auto it = outputs.begin(); it != outputs.end(); ++it) {
-        stats.nTransactionOutputs++;
-        if (stats.total_amount.has_value()) {
-            stats.total_amount = CheckedAdd(*stats.total_amount, it->second.out.nValue);
-        }
-        stats.nBogoSize += GetBogoSize(it->second.out.scriptPubKey);
+    stats.hashSerialized = ss.GetHash();
+}
+static void FinalizeHash(MuHash3072& muhash, CCoinsStats& stats)
+{
+    uint256 out;
+    muhash.Finalize(out);
+    stats.hashSerialized = out;
+}
+static void FinalizeHash(std::nullptr_t, CCoinsStats& stats) {}
+
+static std::variant<HashWriter, MuHash3072, std::nullptr_t> MakeHashObject(CoinStatsHashType hash_type)
+{
+    switch (hash_type) {
+    case(CoinStatsHashType::HASH_SERIALIZED): return HashWriter{};
+    case(CoinStatsHashType::MUHASH): return MuHash3072{};
+    case(CoinStatsHashType::NONE): return nullptr;
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
+CoinStatsAccumulator::CoinStatsAccumulator(CoinStatsHashType hash_type, CCoinsStats& stats)
+    : m_stats{stats}, m_hash_obj{MakeHashObject(hash_type)} {}
+
+bool CoinStatsAccumulator::Add(const COutPoint& outpoint, const Coin& coin)
+{
+    // The database sorts the outputs of a transaction by the VARINT encoding
+    // of their index, which is not numeric order (16511 sorts after 16512),
+    // so only the txids are required to be in order.
+    const bool new_tx{!m_prev_txid || *m_prev_txid != outpoint.hash};
+    if (m_prev_txid && outpoint.hash < *m_prev_txid) return false;
+    if (new_tx) m_prev_outputs.clear();
+    if (!m_prev_outputs.insert(outpoint.n).second) return false;
+    ApplyStats(m_stats, new_tx, coin);
+    std::visit([&](auto& hash_obj) { ApplyHash(hash_obj, outpoint, coin); }, m_hash_obj);
+    m_prev_txid = outpoint.hash;
+    m_stats.coins_count++;
+    return true;
+}
+
+void CoinStatsAccumulator::Combine(CoinStatsAccumulator& other)
+{
+    m_stats.nTransactions += other.m_stats.nTransactions;
+    m_stats.nTransactionOutputs += other.m_stats.nTransactionOutputs;
+    m_stats.nBogoSize += other.m_stats.nBogoSize;
+    m_stats.coins_count += other.m_stats.coins_count;
+    if (m_stats.total_amount.has_value()) {
+        m_stats.total_amount = other.m_stats.total_amount.has_value() ? CheckedAdd(*m_stats.total_amount, *other.m_stats.total_amount) : std::nullopt;
+    }
+
+    if (auto* muhash = std::get_if<MuHash3072>(&m_hash_obj)) {
+        *muhash *= std::get<MuHash3072>(other.m_hash_obj);
+    } else {
+        assert(std::holds_alternative<std::nullptr_t>(m_hash_obj) && std::holds_alternative<std::nullptr_t>(other.m_hash_obj));
     }
 }
 
-//! Calculate statistics about the unspent transaction output set
-template <typename T>
-static bool ComputeUTXOStats(CCoinsView* view, CCoinsStats& stats, T hash_obj, const std::function<void()>& interruption_point)
+void CoinStatsAccumulator::Finalize()
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-    assert(pcursor);
+    std::visit([&](auto& hash_obj) { FinalizeHash(hash_obj, m_stats); }, m_hash_obj);
+}
 
-    uint256 prevkey;
-    std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid()) {
+//! Feed all coins of a cursor to an accumulator
+static bool AccumulateCoins(CCoinsViewCursor& cursor, CoinStatsAccumulator& accumulator, const std::function<void()>& interruption_point)
+{
+    while (cursor.Valid()) {
         if (interruption_point) interruption_point();
         COutPoint key;
         Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            if (!outputs.empty() && key.hash != prevkey) {
-                ApplyStats(stats, prevkey, outputs);
-                ApplyHash(hash_obj, prevkey, outputs);
-                outputs.clear();
-            }
-            prevkey = key.hash;
-            outputs[key.n] = std::move(coin);
-            stats.coins_count++;
-        } else {
+        if (!cursor.GetKey(key) || !cursor.GetValue(coin)) {
             return error("%s: unable to read value", __func__);
         }
-        pcursor->Next();
+        if (!accumulator.Add(key, coin)) {
+            return error("%s: coins cursor out of order", __func__);
+        }
+        cursor.Next();
+    }
+    return true;
+}
+
+//! Walk the shards of the UTXO set on one thread each, and combine the results in shard order
+static bool AccumulateShards(std::vector<std::unique_ptr<CCoinsViewCursor>>& cursors, CoinStatsAccumulator& accumulator, CoinStatsHashType hash_type, const std::function<void()>& interruption_point)
+{
+    std::vector<CCoinsStats> shard_stats(cursors.size());
+    std::vector<CoinStatsAccumulator> shard_accumulators;
+    shard_accumulators.reserve(cursors.size());
+    for (auto& stats : shard_stats) {
+        shard_accumulators.emplace_back(hash_type, stats);
+    }
+
+    std::vector<std::future<bool>> results;
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        results.push_back(std::async(std::launch::async, [&, i] {
+            util::ThreadRename(strprintf("utxostats.%i", i));
+            return AccumulateCoins(*cursors[i], shard_accumulators[i], interruption_point);
+        }));
     }
-    if (!outputs.empty()) {
-        ApplyStats(stats, prevkey, outputs);
-        ApplyHash(hash_obj, prevkey, outputs);
+    bool success{true};
+    for (size_t i = 0; i < results.size(); ++i) {
+        // Rethrows any exception thrown by the interruption point
+        if (!results[i].get()) success = false;
+        if (success) accumulator.Combine(shard_accumulators[i]);
     }
+    return success;
+}
+
+//! Calculate statistics about the unspent transaction output set
+static bool ComputeUTXOStats(CCoinsView* view, CCoinsStats& stats, CoinStatsHashType hash_type, const std::function<void()>& interruption_point)
+{
+    CoinStatsAccumulator accumulator{hash_type, stats};
 
-    FinalizeHash(hash_obj, stats);
+    // The serialized hash commits to the order of the whole set, so it can
+    // only be computed over a single cursor. The other hash types are order
+    // independent, so the set can be split into shards that are walked in
+    // parallel.
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    const unsigned int num_shards{std::clamp(std::thread::hardware_concurrency(), 1U, MAX_UTXO_STATS_SHARDS)};
+    if (hash_type != CoinStatsHashType::HASH_SERIALIZED && num_shards > 1) {
+        cursors = view->ShardedCursors(num_shards);
+    }
+    if (cursors.empty()) {
+        std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+        assert(pcursor);
+        if (!AccumulateCoins(*pcursor, accumulator, interruption_point)) return false;
+    } else if (!AccumulateShards(cursors, accumulator, hash_type, interruption_point)) {
+        return false;
+    }
+    accumulator.Finalize();
 
     stats.nDiskSize = view->EstimateSize();
 
@@ -156,39 +255,10 @@ std::optional<CCoinsStats> ComputeUTXOStats(CoinStatsHashType hash_type, CCoinsV
     CBlockIndex* pindex = WITH_LOCK(::cs_main, return blockman.LookupBlockIndex(view->GetBestBlock()));
     CCoinsStats stats{Assert(pindex)->nHeight, pindex->GetBlockHash()};
 
-    bool success = [&]() -> bool {
-        switch (hash_type) {
-        case(CoinStatsHashType::HASH_SERIALIZED): {
-            HashWriter ss{};
-            return ComputeUTXOStats(view, stats, ss, interruption_point);
-        }
-        case(CoinStatsHashType::MUHASH): {
-            MuHash3072 muhash;
-            return ComputeUTXOStats(view, stats, muhash, interruption_point);
-        }
-        case(CoinStatsHashType::NONE): {
-            return ComputeUTXOStats(view, stats, nullptr, interruption_point);
-        }
-        } // no default case, so the compiler can warn about missing cases
-        assert(false);
-    }();
-
-    if (!success) {
+    if (!ComputeUTXOStats(view, stats, hash_type, interruption_point)) {
         return std::nullopt;
     }
     return stats;
 }
 
-static void FinalizeHash(HashWriter& ss, CCoinsStats& stats)
-{
-    stats.hashSerialized = ss.GetHash();
-}
-static void FinalizeHash(MuHash3072& muhash, CCoinsStats& stats)
-{
-    uint256 out;
-    muhash.Finalize(out);
-    stats.hashSerialized = out;
-}
-static void FinalizeHash(std::nullptr_t, CCoinsStats& stats) {}
-
 } // namespace kernel
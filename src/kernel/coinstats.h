@@ -5,17 +5,20 @@
 #ifndef BITCOIN_KERNEL_COINSTATS_H
 #define BITCOIN_KERNEL_COINSTATS_H
 
+#include <coins.h>
 #include <consensus/amount.h>
 #include <crypto/muhash.h>
+#include <hash.h>
 #include <streams.h>
 #include <uint256.h>
 
 #include <cstdint>
 #include <functional>
 #include <optional>
+#include <set>
+#include <variant>
 
 class CCoinsView;
-class Coin;
 class COutPoint;
 class CScript;
 namespace node {
@@ -76,6 +79,48 @@ uint64_t GetBogoSize(const CScript& script_pub_key);
 void ApplyCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin);
 void RemoveCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin);
 
+/**
+ * Incrementally computes the statistics and hash of a UTXO set from coins
+ * supplied in coins database order, i.e. grouped by txid in increasing order.
+ * Callers that already walk the whole UTXO set, such as when writing or
+ * loading a snapshot, get the same result as ComputeUTXOStats without a
+ * second pass over the database. Each coin is hashed as it is added, so
+ * nothing is copied or buffered.
+ */
+class CoinStatsAccumulator
+{
+public:
+    CoinStatsAccumulator(CoinStatsHashType hash_type, CCoinsStats& stats);
+
+    /**
+     * Add the next coin of the set.
+     *
+     * @returns false if the outpoint is a duplicate or its txid sorts before
+     *          that of the previous coin, in which case nothing is added. The
+     *          outputs of one transaction may come in any order.
+     */
+    [[nodiscard]] bool Add(const COutPoint& outpoint, const Coin& coin);
+
+    /**
+     * Fold in the coins accumulated by other, which must cover a range of
+     * txids sorting entirely after the coins added here, such as the next
+     * shard of the same UTXO set. Only supported for hash types that do not
+     * depend on the order of the coins.
+     */
+    void Combine(CoinStatsAccumulator& other);
+
+    //! Store the resulting hash in the stats.
+    void Finalize();
+
+private:
+    CCoinsStats& m_stats;
+    std::variant<HashWriter, MuHash3072, std::nullptr_t> m_hash_obj;
+    //! Txid of the last coin added, if any
+    std::optional<uint256> m_prev_txid;
+    //! Output indexes added so far for m_prev_txid
+    std::set<uint32_t> m_prev_outputs;
+};
+
 std::optional<CCoinsStats> ComputeUTXOStats(CoinStatsHashType hash_type, CCoinsView* view, node::BlockManager& blockman, const std::function<void()>& interruption_point = {});
 } // namespace kernel
 
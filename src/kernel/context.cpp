@@ -4,6 +4,7 @@
 
 #include <kernel/context.h>
 
+#include <crypto/muhash.h>
 #include <crypto/sha256.h>
 #include <key.h>
 #include <logging.h>
@@ -22,6 +23,8 @@ Context::Context()
     g_context = this;
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string muhash_algo = MuHash3072AutoDetect();
+    LogPrintf("Using the '%s' MuHash3072 implementation\n", muhash_algo);
     RandomInit();
     ECC_Start();
 }
@@ -8,20 +8,23 @@
 #include <consensus/amount.h>
 #include <consensus/validation.h>
 #include <core_memusage.h>
+#include <memusage.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
+#include <prevector.h>
 #include <primitives/transaction.h>
 #include <util/epochguard.h>
 #include <util/overflow.h>
 
+#include <algorithm>
 #include <chrono>
 #include <functional>
 #include <memory>
-#include <set>
 #include <stddef.h>
 #include <stdint.h>
 
 class CBlockIndex;
+class CTxMemPoolEntry;
 
 struct LockPoints {
     // Will be set to the blockchain height and median time past
@@ -50,6 +53,37 @@ struct CompareIteratorByHash {
     }
 };
 
+/**
+ * The in-mempool parents or children of an entry, sorted by txid.
+ *
+ * Most transactions have no more than two of either, so the first two are
+ * stored inline and larger sets use a flat array. This is a fraction of the
+ * size of a std::set, which costs a tree node allocation per element.
+ */
+class CTxMemPoolEntryRefs
+{
+public:
+    using value_type = std::reference_wrapper<const CTxMemPoolEntry>;
+    using const_iterator = prevector<2, value_type>::const_iterator;
+
+    const_iterator begin() const { return m_refs.begin(); }
+    const_iterator end() const { return m_refs.end(); }
+    size_t size() const { return m_refs.size(); }
+    bool empty() const { return m_refs.empty(); }
+
+    /** Add an entry. Returns false if it was already present. */
+    bool insert(const CTxMemPoolEntry& entry);
+    /** Remove an entry. Returns false if it was not present. */
+    bool erase(const CTxMemPoolEntry& entry);
+
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(m_refs); }
+
+private:
+    prevector<2, value_type> m_refs;
+
+    prevector<2, value_type>::iterator LowerBound(const CTxMemPoolEntry& entry);
+};
+
 /** \class CTxMemPoolEntry
  *
  * CTxMemPoolEntry stores data about the corresponding transaction, as well
@@ -67,39 +101,42 @@ class CTxMemPoolEntry
 public:
     typedef std::reference_wrapper<const CTxMemPoolEntry> CTxMemPoolEntryRef;
     // two aliases, should the types ever diverge
-    typedef std::set<CTxMemPoolEntryRef, CompareIteratorByHash> Parents;
-    typedef std::set<CTxMemPoolEntryRef, CompareIteratorByHash> Children;
+    typedef CTxMemPoolEntryRefs Parents;
+    typedef CTxMemPoolEntryRefs Children;
 
 private:
+    // Members are ordered by size to avoid padding.
     const CTransactionRef tx;
     mutable Parents m_parents;
     mutable Children m_children;
     const CAmount nFee;             //!< Cached to avoid expensive parent-transaction lookups
-    const int32_t nTxWeight;         //!< ... and avoid recomputing tx weight (also used for GetTxSize())
-    const size_t nUsageSize;        //!< ... and total memory usage
     const int64_t nTime;            //!< Local time when entering the mempool
     const uint64_t entry_sequence;  //!< Sequence number used to determine whether this transaction is too recent for relay
-    const unsigned int entryHeight; //!< Chain height when entering the mempool
-    const bool spendsCoinbase;      //!< keep track of transactions that spend a coinbase
-    const int64_t sigOpCost;        //!< Total sigop cost
     CAmount m_modified_fee;         //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;          //!< Track the height and time at which tx was final
 
     // Information about descendants of this transaction that are in the
     // mempool; if we remove this transaction we must remove all of these
     // descendants as well.
-    int64_t m_count_with_descendants{1}; //!< number of descendant transactions
     // Using int64_t instead of int32_t to avoid signed integer overflow issues.
-    int64_t nSizeWithDescendants;      //!< ... and size
+    int64_t nSizeWithDescendants;      //!< size of us and our descendants
     CAmount nModFeesWithDescendants;   //!< ... and total fees (all including us)
 
     // Analogous statistics for ancestor transactions
-    int64_t m_count_with_ancestors{1};
-    // Using int64_t instead of int32_t to avoid signed integer overflow issues.
     int64_t nSizeWithAncestors;
     CAmount nModFeesWithAncestors;
     int64_t nSigOpCostWithAncestors;
 
+    // Counts are bounded by the number of transactions in the mempool, and
+    // per-transaction values by consensus limits, so 32 bits suffice.
+    int32_t m_count_with_descendants{1}; //!< number of descendant transactions
+    int32_t m_count_with_ancestors{1};
+    const int32_t nTxWeight;         //!< Cached to avoid recomputing tx weight (also used for GetTxSize())
+    const int32_t sigOpCost;         //!< Total sigop cost
+    const uint32_t nUsageSize;       //!< Cached total memory usage
+    const unsigned int entryHeight;  //!< Chain height when entering the mempool
+    const bool spendsCoinbase;       //!< keep track of transactions that spend a coinbase
+
 public:
     CTxMemPoolEntry(const CTransactionRef& tx, CAmount fee,
                     int64_t time, unsigned int entry_height, uint64_t entry_sequence,
@@ -107,20 +144,20 @@ public:
                     int64_t sigops_cost, LockPoints lp)
         : tx{tx},
           nFee{fee},
-          nTxWeight{GetTransactionWeight(*tx)},
-          nUsageSize{RecursiveDynamicUsage(tx)},
           nTime{time},
           entry_sequence{entry_sequence},
-          entryHeight{entry_height},
-          spendsCoinbase{spends_coinbase},
-          sigOpCost{sigops_cost},
           m_modified_fee{nFee},
           lockPoints{lp},
-          nSizeWithDescendants{GetTxSize()},
-          nModFeesWithDescendants{nFee},
-          nSizeWithAncestors{GetTxSize()},
-          nModFeesWithAncestors{nFee},
-          nSigOpCostWithAncestors{sigOpCost} {}
+          nTxWeight{GetTransactionWeight(*tx)},
+          sigOpCost{static_cast<int32_t>(sigops_cost)},
+          nUsageSize{static_cast<uint32_t>(RecursiveDynamicUsage(tx))},
+          entryHeight{entry_height},
+          spendsCoinbase{spends_coinbase}
+    {
+        nSizeWithDescendants = nSizeWithAncestors = GetTxSize();
+        nModFeesWithDescendants = nModFeesWithAncestors = nFee;
+        nSigOpCostWithAncestors = sigOpCost;
+    }
 
     const CTransaction& GetTx() const { return *this->tx; }
     CTransactionRef GetSharedTx() const { return this->tx; }
@@ -178,4 +215,27 @@ public:
 
 using CTxMemPoolEntryRef = CTxMemPoolEntry::CTxMemPoolEntryRef;
 
+inline prevector<2, CTxMemPoolEntryRefs::value_type>::iterator CTxMemPoolEntryRefs::LowerBound(const CTxMemPoolEntry& entry)
+{
+    return std::lower_bound(m_refs.begin(), m_refs.end(), entry.GetTx().GetHash(), [](const value_type& ref, const uint256& hash) {
+        return ref.get().GetTx().GetHash() < hash;
+    });
+}
+
+inline bool CTxMemPoolEntryRefs::insert(const CTxMemPoolEntry& entry)
+{
+    auto it{LowerBound(entry)};
+    if (it != m_refs.end() && it->get().GetTx().GetHash() == entry.GetTx().GetHash()) return false;
+    m_refs.insert(it, std::cref(entry));
+    return true;
+}
+
+inline bool CTxMemPoolEntryRefs::erase(const CTxMemPoolEntry& entry)
+{
+    auto it{LowerBound(entry)};
+    if (it == m_refs.end() || it->get().GetTx().GetHash() != entry.GetTx().GetHash()) return false;
+    m_refs.erase(it);
+    return true;
+}
+
 #endif // BITCOIN_KERNEL_MEMPOOL_ENTRY_H
@@ -24,6 +24,8 @@ struct MemPoolLimits {
     int64_t descendant_count{DEFAULT_DESCENDANT_LIMIT};
     //! The maximum allowed size in virtual bytes of an entry and its descendants within a package.
     int64_t descendant_size_vbytes{DEFAULT_DESCENDANT_SIZE_LIMIT_KVB * 1'000};
+    //! The maximum allowed number of transactions in the cluster of an entry. Only enforced with -clustermempool.
+    int64_t cluster_count{DEFAULT_CLUSTER_LIMIT};
 
     /**
      * @return MemPoolLimits with all the limits set to the maximum
@@ -31,7 +33,7 @@ struct MemPoolLimits {
     static constexpr MemPoolLimits NoLimits()
     {
         int64_t no_limit{std::numeric_limits<int64_t>::max()};
-        return {no_limit, no_limit, no_limit, no_limit};
+        return {no_limit, no_limit, no_limit, no_limit, no_limit};
     }
 };
 } // namespace kernel
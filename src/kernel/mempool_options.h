@@ -23,6 +23,10 @@ static constexpr unsigned int DEFAULT_BLOCKSONLY_MAX_MEMPOOL_SIZE_MB{5};
 static constexpr unsigned int DEFAULT_MEMPOOL_EXPIRY_HOURS{336};
 /** Default for -mempoolfullrbf, if the transaction replaceability signaling is ignored */
 static constexpr bool DEFAULT_MEMPOOL_FULL_RBF{false};
+/** Default for -clustermempool, if eviction and block assembly use cluster linearizations */
+static constexpr bool DEFAULT_CLUSTER_MEMPOOL{false};
+/** Default for -persistmempoolv1, if the mempool is saved in the format older versions can read */
+static constexpr bool DEFAULT_PERSIST_V1_DAT{false};
 /** Default for -acceptnonstdtxn */
 static constexpr bool DEFAULT_ACCEPT_NON_STD_TXN{false};
 
@@ -56,6 +60,10 @@ struct MemPoolOptions {
     bool permit_bare_multisig{DEFAULT_PERMIT_BAREMULTISIG};
     bool require_standard{true};
     bool full_rbf{DEFAULT_MEMPOOL_FULL_RBF};
+    /** Evict and mine whole chunks of linearized clusters instead of descendant/ancestor packages. */
+    bool cluster_mempool{DEFAULT_CLUSTER_MEMPOOL};
+    /** Save mempool.dat without the chain tip and checksum, for downgrades. */
+    bool persist_v1_dat{DEFAULT_PERSIST_V1_DAT};
     MemPoolLimits limits{};
 };
 } // namespace kernel
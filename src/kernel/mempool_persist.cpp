@@ -6,6 +6,7 @@
 
 #include <clientversion.h>
 #include <consensus/amount.h>
+#include <hash.h>
 #include <logging.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
@@ -19,6 +20,7 @@
 #include <util/time.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdio>
 #include <exception>
@@ -34,7 +36,21 @@ using fsbridge::FopenFn;
 
 namespace kernel {
 
-static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+static const uint64_t MEMPOOL_DUMP_VERSION_NO_CHECKSUM = 1;
+/** Adds a trailing checksum. Numbered apart from the versions of the format
+ *  inherited from Bitcoin Core, which uses 2 for its obfuscated files. */
+static const uint64_t MEMPOOL_DUMP_VERSION = 1001;
+
+/** Number of loaded transactions that are script checked and submitted together. */
+static constexpr size_t MEMPOOL_LOAD_BATCH_SIZE{500};
+
+namespace {
+struct DumpedTx {
+    CTransactionRef tx;
+    int64_t time;
+    int64_t fee_delta;
+};
+} // namespace
 
 bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active_chainstate, ImportMempoolOptions&& opts)
 {
@@ -54,85 +70,109 @@ bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active
     int64_t unbroadcast = 0;
     const auto now{NodeClock::now()};
 
+    // Read the whole file first, so that a corrupted one is rejected before
+    // any of its transactions is submitted.
+    std::vector<DumpedTx> txs;
+    std::map<uint256, CAmount> mapDeltas;
+    std::set<uint256> unbroadcast_txids;
     try {
+        HashVerifier verifier{file};
+        OverrideStream stream{&verifier, CLIENT_VERSION};
         uint64_t version;
-        file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        stream >> version;
+        if (version != MEMPOOL_DUMP_VERSION_NO_CHECKSUM && version != MEMPOOL_DUMP_VERSION) {
             return false;
         }
         uint64_t total_txns_to_load;
-        file >> total_txns_to_load;
-        uint64_t txns_tried = 0;
-        LogPrintf("Loading %u mempool transactions from disk...\n", total_txns_to_load);
-        int next_tenth_to_report = 0;
-        while (txns_tried < total_txns_to_load) {
-            const int percentage_done(100.0 * txns_tried / total_txns_to_load);
+        stream >> total_txns_to_load;
+        for (uint64_t i = 0; i < total_txns_to_load; ++i) {
+            DumpedTx& dumped{txs.emplace_back()};
+            stream >> dumped.tx >> dumped.time >> dumped.fee_delta;
+        }
+        stream >> mapDeltas;
+        stream >> unbroadcast_txids;
+        if (version == MEMPOOL_DUMP_VERSION) {
+            uint256 checksum;
+            file >> checksum;
+            if (checksum != verifier.GetHash()) {
+                throw std::runtime_error{"Checksum mismatch, data corrupted"};
+            }
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
+        return false;
+    }
+
+    LogPrintf("Loading %u mempool transactions from disk...\n", txs.size());
+    int next_tenth_to_report = 0;
+    uint64_t txns_tried = 0;
+    std::vector<PreCheckedTransaction> batch;
+    for (size_t batch_start = 0; batch_start < txs.size(); batch_start += MEMPOOL_LOAD_BATCH_SIZE) {
+        batch.clear();
+        const size_t batch_end{std::min(batch_start + MEMPOOL_LOAD_BATCH_SIZE, txs.size())};
+        for (size_t i = batch_start; i < batch_end; ++i) {
+            const int percentage_done(100.0 * txns_tried / txs.size());
             if (next_tenth_to_report < percentage_done / 10) {
                 LogPrintf("Progress loading mempool transactions from disk: %d%% (tried %u, %u remaining)\n",
-                        percentage_done, txns_tried, total_txns_to_load - txns_tried);
+                        percentage_done, txns_tried, txs.size() - txns_tried);
                 next_tenth_to_report = percentage_done / 10;
             }
             ++txns_tried;
 
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
+            const auto& [tx, time, fee_delta] = txs[i];
+            const int64_t nTime{opts.use_current_time ? TicksSinceEpoch<std::chrono::seconds>(now) : time};
 
-            if (opts.use_current_time) {
-                nTime = TicksSinceEpoch<std::chrono::seconds>(now);
-            }
-
-            CAmount amountdelta = nFeeDelta;
+            CAmount amountdelta = fee_delta;
             if (amountdelta && opts.apply_fee_delta_priority) {
                 pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
             if (nTime > TicksSinceEpoch<std::chrono::seconds>(now - pool.m_expiry)) {
-                LOCK(cs_main);
-                const auto& accepted = AcceptToMemoryPool(active_chainstate, tx, nTime, /*bypass_limits=*/false, /*test_accept=*/false);
-                if (accepted.m_result_type == MempoolAcceptResult::ResultType::VALID) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (pool.exists(GenTxid::Txid(tx->GetHash()))) {
-                        ++already_there;
-                    } else {
-                        ++failed;
-                    }
-                }
+                batch.emplace_back(tx, nTime);
             } else {
                 ++expired;
             }
-            if (active_chainstate.m_chainman.m_interrupt)
-                return false;
         }
-        std::map<uint256, CAmount> mapDeltas;
-        file >> mapDeltas;
 
-        if (opts.apply_fee_delta_priority) {
-            for (const auto& i : mapDeltas) {
-                pool.PrioritiseTransaction(i.first, i.second);
+        // Verify the scripts of the batch on the script check threads without
+        // holding cs_main, so that block validation can proceed while a large
+        // mempool is loaded. The batch is then submitted under a single
+        // cs_main acquisition, carrying on from those checks.
+        active_chainstate.m_chainman.PreCheckTransactions(batch);
+        LOCK(cs_main);
+        for (PreCheckedTransaction& precheck : batch) {
+            const CTransactionRef tx{precheck.GetTx()};
+            const auto accepted{active_chainstate.m_chainman.ProcessTransaction(std::move(precheck))};
+            if (accepted.m_result_type == MempoolAcceptResult::ResultType::VALID) {
+                ++count;
+            } else {
+                // mempool may contain the transaction already, e.g. from
+                // wallet(s) having loaded it while we were processing
+                // mempool transactions; consider these as valid, instead of
+                // failed, but mark them as 'already there'
+                if (pool.exists(GenTxid::Txid(tx->GetHash()))) {
+                    ++already_there;
+                } else {
+                    ++failed;
+                }
             }
         }
+        if (active_chainstate.m_chainman.m_interrupt)
+            return false;
+    }
 
-        std::set<uint256> unbroadcast_txids;
-        file >> unbroadcast_txids;
-        if (opts.apply_unbroadcast_set) {
-            unbroadcast = unbroadcast_txids.size();
-            for (const auto& txid : unbroadcast_txids) {
-                // Ensure transactions were accepted to mempool then add to
-                // unbroadcast set.
-                if (pool.get(txid) != nullptr) pool.AddUnbroadcastTx(txid);
-            }
+    if (opts.apply_fee_delta_priority) {
+        for (const auto& i : mapDeltas) {
+            pool.PrioritiseTransaction(i.first, i.second);
+        }
+    }
+
+    if (opts.apply_unbroadcast_set) {
+        unbroadcast = unbroadcast_txids.size();
+        for (const auto& txid : unbroadcast_txids) {
+            // Ensure transactions were accepted to mempool then add to
+            // unbroadcast set.
+            if (pool.get(txid) != nullptr) pool.AddUnbroadcastTx(txid);
         }
-    } catch (const std::exception& e) {
-        LogPrintf("Failed to deserialize mempool data on disk: %s. Continuing anyway.\n", e.what());
-        return false;
     }
 
     LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there, %i waiting for initial broadcast\n", count, failed, expired, already_there, unbroadcast);
@@ -168,22 +208,26 @@ bool DumpMempool(const CTxMemPool& pool, const fs::path& dump_path, FopenFn mock
         }
 
         CAutoFile file{filestr, CLIENT_VERSION};
+        HashedSourceWriter hasher{file};
+        OverrideStream stream{&hasher, CLIENT_VERSION};
 
-        uint64_t version = MEMPOOL_DUMP_VERSION;
-        file << version;
+        const uint64_t version{pool.m_persist_v1_dat ? MEMPOOL_DUMP_VERSION_NO_CHECKSUM : MEMPOOL_DUMP_VERSION};
+        stream << version;
 
-        file << (uint64_t)vinfo.size();
+        stream << (uint64_t)vinfo.size();
         for (const auto& i : vinfo) {
-            file << *(i.tx);
-            file << int64_t{count_seconds(i.m_time)};
-            file << int64_t{i.nFeeDelta};
+            stream << *(i.tx);
+            stream << int64_t{count_seconds(i.m_time)};
+            stream << int64_t{i.nFeeDelta};
             mapDeltas.erase(i.tx->GetHash());
         }
 
-        file << mapDeltas;
+        stream << mapDeltas;
 
         LogPrintf("Writing %d unbroadcast transactions to disk.\n", unbroadcast_txids.size());
-        file << unbroadcast_txids;
+        stream << unbroadcast_txids;
+
+        if (version == MEMPOOL_DUMP_VERSION) file << hasher.GetHash();
 
         if (!skip_file_commit && !FileCommit(file.Get()))
             throw std::runtime_error("FileCommit failed");
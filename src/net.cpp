@@ -122,7 +122,21 @@ size_t CSerializedNetMsg::GetMemoryUsage() const noexcept
     // Don't count the dynamic memory used for the m_type string, by assuming it fits in the
     // "small string" optimization area (which stores data inside the object itself, up to some
     // size; 15 bytes in modern libstdc++).
-    return sizeof(*this) + memusage::DynamicUsage(data);
+    // A shared payload is counted in full by every message referencing it, so that send buffer
+    // limits behave as if each peer had its own copy.
+    size_t usage{sizeof(*this) + memusage::DynamicUsage(data)};
+    if (m_shared) usage += memusage::MallocUsage(sizeof(SharedPayload)) + memusage::DynamicUsage(m_shared->data);
+    return usage;
+}
+
+void CSerializedNetMsg::Share()
+{
+    if (m_shared) return;
+    auto shared = std::make_shared<SharedPayload>();
+    shared->hash = Hash(data);
+    shared->data = std::move(data);
+    ClearShrink(data);
+    m_shared = std::move(shared);
 }
 
 void CConnman::AddAddrFetch(const std::string& strDest)
@@ -800,28 +814,37 @@ CNetMessage V1Transport::GetReceivedMessage(const std::chrono::microseconds time
     return msg;
 }
 
+bool Transport::GetBytesToSendMany(bool have_next_message, std::vector<SendSpan>& spans) const noexcept
+{
+    const auto& [to_send, more, msg_type] = GetBytesToSend(have_next_message);
+    if (!to_send.empty()) spans.push_back({to_send, &msg_type});
+    return more;
+}
+
 bool V1Transport::SetMessageToSend(CSerializedNetMsg& msg) noexcept
 {
     AssertLockNotHeld(m_send_mutex);
     // Determine whether a new message can be set.
     LOCK(m_send_mutex);
-    if (m_sending_header || m_bytes_sent < m_message_to_send.data.size()) return false;
+    if (m_send_queue.size() >= MAX_SEND_QUEUE) return false;
 
-    // create dbl-sha256 checksum
-    uint256 hash = Hash(msg.data);
+    // create dbl-sha256 checksum, unless it was computed when the payload was shared
+    const uint256 hash = msg.m_shared ? msg.m_shared->hash : Hash(msg.data);
 
     // create header
-    CMessageHeader hdr(m_magic_bytes, msg.m_type.c_str(), msg.data.size());
+    CMessageHeader hdr(m_magic_bytes, msg.m_type.c_str(), msg.Payload().size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
     // serialize header
-    m_header_to_send.clear();
-    CVectorWriter{INIT_PROTO_VERSION, m_header_to_send, 0, hdr};
+    MessageToSend& queued = m_send_queue.emplace_back();
+    CVectorWriter{INIT_PROTO_VERSION, queued.header, 0, hdr};
 
     // update state
-    m_message_to_send = std::move(msg);
-    m_sending_header = true;
-    m_bytes_sent = 0;
+    queued.msg = std::move(msg);
+    if (m_send_queue.size() == 1) {
+        m_sending_header = true;
+        m_bytes_sent = 0;
+    }
     return true;
 }
 
@@ -829,45 +852,85 @@ Transport::BytesToSend V1Transport::GetBytesToSend(bool have_next_message) const
 {
     AssertLockNotHeld(m_send_mutex);
     LOCK(m_send_mutex);
+    static const std::string EMPTY;
+    if (m_send_queue.empty()) return {{}, have_next_message, EMPTY};
+    const MessageToSend& front = m_send_queue.front();
+    // Anything queued behind the first message is sendable right after it.
+    const bool more_after_front = have_next_message || m_send_queue.size() > 1;
     if (m_sending_header) {
-        return {Span{m_header_to_send}.subspan(m_bytes_sent),
+        return {Span{front.header}.subspan(m_bytes_sent),
                 // We have more to send after the header if the message has payload, or if there
                 // is a next message after that.
-                have_next_message || !m_message_to_send.data.empty(),
-                m_message_to_send.m_type
+                more_after_front || !front.msg.Payload().empty(),
+                front.msg.m_type
                };
     } else {
-        return {Span{m_message_to_send.data}.subspan(m_bytes_sent),
+        return {front.msg.Payload().subspan(m_bytes_sent),
                 // We only have more to send after this message's payload if there is another
                 // message.
-                have_next_message,
-                m_message_to_send.m_type
+                more_after_front,
+                front.msg.m_type
                };
     }
 }
 
+bool V1Transport::GetBytesToSendMany(bool have_next_message, std::vector<SendSpan>& spans) const noexcept
+{
+    AssertLockNotHeld(m_send_mutex);
+    LOCK(m_send_mutex);
+    for (size_t i = 0; i < m_send_queue.size(); ++i) {
+        const MessageToSend& queued = m_send_queue[i];
+        const bool first{i == 0};
+        Span<const uint8_t> header{queued.header};
+        Span<const uint8_t> payload{queued.msg.Payload()};
+        if (first && m_sending_header) header = header.subspan(m_bytes_sent);
+        if (first && !m_sending_header) {
+            header = {};
+            payload = payload.subspan(m_bytes_sent);
+        }
+        if (!header.empty()) spans.push_back({header, &queued.msg.m_type});
+        if (!payload.empty()) spans.push_back({payload, &queued.msg.m_type});
+    }
+    return have_next_message;
+}
+
 void V1Transport::MarkBytesSent(size_t bytes_sent) noexcept
 {
     AssertLockNotHeld(m_send_mutex);
     LOCK(m_send_mutex);
-    m_bytes_sent += bytes_sent;
-    if (m_sending_header && m_bytes_sent == m_header_to_send.size()) {
-        // We're done sending a message's header. Switch to sending its data bytes.
-        m_sending_header = false;
-        m_bytes_sent = 0;
-    } else if (!m_sending_header && m_bytes_sent == m_message_to_send.data.size()) {
-        // We're done sending a message's data. Wipe the data vector to reduce memory consumption.
-        ClearShrink(m_message_to_send.data);
+    while (!m_send_queue.empty()) {
+        const MessageToSend& front = m_send_queue.front();
+        if (m_sending_header) {
+            const size_t sent{std::min(bytes_sent, front.header.size() - m_bytes_sent)};
+            m_bytes_sent += sent;
+            bytes_sent -= sent;
+            if (m_bytes_sent < front.header.size()) break;
+            // We're done sending a message's header. Switch to sending its data bytes.
+            m_sending_header = false;
+            m_bytes_sent = 0;
+        }
+        const size_t payload_size{front.msg.Payload().size()};
+        const size_t sent{std::min(bytes_sent, payload_size - m_bytes_sent)};
+        m_bytes_sent += sent;
+        bytes_sent -= sent;
+        if (m_bytes_sent < payload_size) break;
+        // We're done sending a message's data. Drop it to release its memory, and continue with
+        // the header of the next one.
+        m_send_queue.pop_front();
+        m_sending_header = true;
         m_bytes_sent = 0;
     }
+    Assume(bytes_sent == 0);
 }
 
 size_t V1Transport::GetSendMemoryUsage() const noexcept
 {
     AssertLockNotHeld(m_send_mutex);
     LOCK(m_send_mutex);
-    // Don't count sending-side fields besides m_message_to_send, as they're all small and bounded.
-    return m_message_to_send.GetMemoryUsage();
+    // Don't count sending-side fields besides the queued messages, as they're all small and bounded.
+    size_t usage{0};
+    for (const MessageToSend& queued : m_send_queue) usage += queued.msg.GetMemoryUsage();
+    return usage;
 }
 
 namespace {
@@ -1459,17 +1522,18 @@ bool V2Transport::SetMessageToSend(CSerializedNetMsg& msg) noexcept
     if (!(m_send_state == SendState::READY && m_send_buffer.empty())) return false;
     // Construct contents (encoding message type + payload).
     std::vector<uint8_t> contents;
+    const Span<const unsigned char> payload{msg.Payload()};
     auto short_message_id = V2_MESSAGE_MAP(msg.m_type);
     if (short_message_id) {
-        contents.resize(1 + msg.data.size());
+        contents.resize(1 + payload.size());
         contents[0] = *short_message_id;
-        std::copy(msg.data.begin(), msg.data.end(), contents.begin() + 1);
+        std::copy(payload.begin(), payload.end(), contents.begin() + 1);
     } else {
         // Initialize with zeroes, and then write the message type string starting at offset 1.
         // This means contents[0] and the unused positions in contents[1..13] remain 0x00.
-        contents.resize(1 + CMessageHeader::COMMAND_SIZE + msg.data.size(), 0);
+        contents.resize(1 + CMessageHeader::COMMAND_SIZE + payload.size(), 0);
         std::copy(msg.m_type.begin(), msg.m_type.end(), contents.data() + 1);
-        std::copy(msg.data.begin(), msg.data.end(), contents.begin() + 1 + CMessageHeader::COMMAND_SIZE);
+        std::copy(payload.begin(), payload.end(), contents.begin() + 1 + CMessageHeader::COMMAND_SIZE);
     }
     // Construct ciphertext in send buffer.
     m_send_buffer.resize(contents.size() + BIP324Cipher::EXPANSION);
@@ -1477,6 +1541,7 @@ bool V2Transport::SetMessageToSend(CSerializedNetMsg& msg) noexcept
     m_send_type = msg.m_type;
     // Release memory
     ClearShrink(msg.data);
+    msg.m_shared.reset();
     return true;
 }
 
@@ -1497,6 +1562,17 @@ Transport::BytesToSend V2Transport::GetBytesToSend(bool have_next_message) const
     };
 }
 
+bool V2Transport::GetBytesToSendMany(bool have_next_message, std::vector<SendSpan>& spans) const noexcept
+{
+    AssertLockNotHeld(m_send_mutex);
+    // The ciphertext of a message is already contiguous in m_send_buffer, so outside of V1
+    // fallback there is nothing to gather.
+    if (WITH_LOCK(m_send_mutex, return m_send_state == SendState::V1)) {
+        return m_v1_fallback.GetBytesToSendMany(have_next_message, spans);
+    }
+    return Transport::GetBytesToSendMany(have_next_message, spans);
+}
+
 void V2Transport::MarkBytesSent(size_t bytes_sent) noexcept
 {
     AssertLockNotHeld(m_send_mutex);
@@ -1572,28 +1648,36 @@ std::pair<size_t, bool> CConnman::SocketSendData(CNode& node) const
     size_t nSentSize = 0;
     bool data_left{false}; //!< second return value (whether unsent data remains)
     std::optional<bool> expected_more;
+    std::vector<Transport::SendSpan> spans;
+    std::vector<Span<const unsigned char>> buffers;
 
     while (true) {
-        if (it != node.vSendMsg.end()) {
-            // If possible, move one message from the send queue to the transport. This fails when
-            // there is an existing message still being sent, or (for v2 transports) when the
-            // handshake has not yet completed.
+        // Move as many messages from the send queue to the transport as it accepts. This stops
+        // when the transport's own queue is full, or (for v2 transports) when the handshake has
+        // not yet completed.
+        while (it != node.vSendMsg.end()) {
             size_t memusage = it->GetMemoryUsage();
-            if (node.m_transport->SetMessageToSend(*it)) {
-                // Update memory usage of send buffer (as *it will be deleted).
-                node.m_send_memusage -= memusage;
-                ++it;
-            }
-        }
-        const auto& [data, more, msg_type] = node.m_transport->GetBytesToSend(it != node.vSendMsg.end());
-        // We rely on the 'more' value returned by GetBytesToSend to correctly predict whether more
-        // bytes are still to be sent, to correctly set the MSG_MORE flag. As a sanity check,
+            if (!node.m_transport->SetMessageToSend(*it)) break;
+            // Update memory usage of send buffer (as *it will be deleted).
+            node.m_send_memusage -= memusage;
+            ++it;
+        }
+        spans.clear();
+        const bool more = node.m_transport->GetBytesToSendMany(it != node.vSendMsg.end(), spans);
+        // We rely on the 'more' value returned by GetBytesToSendMany to correctly predict whether
+        // more bytes are still to be sent, to correctly set the MSG_MORE flag. As a sanity check,
         // verify that the previously returned 'more' was correct.
-        if (expected_more.has_value()) Assume(!data.empty() == *expected_more);
+        if (expected_more.has_value()) Assume(!spans.empty() == *expected_more);
         expected_more = more;
-        data_left = !data.empty(); // will be overwritten on next loop if all of data gets sent
-        int nBytes = 0;
-        if (!data.empty()) {
+        data_left = !spans.empty(); // will be overwritten on next loop if all of data gets sent
+        size_t to_send{0};
+        buffers.clear();
+        for (const auto& span : spans) {
+            buffers.push_back(span.data);
+            to_send += span.data.size();
+        }
+        ssize_t nBytes = 0;
+        if (!spans.empty()) {
             LOCK(node.m_sock_mutex);
             // There is no socket in case we've already disconnected, or in test cases without
             // real connections. In these cases, we bail out immediately and just leave things
@@ -1607,19 +1691,26 @@ std::pair<size_t, bool> CConnman::SocketSendData(CNode& node) const
                 flags |= MSG_MORE;
             }
 #endif
-            nBytes = node.m_sock->Send(reinterpret_cast<const char*>(data.data()), data.size(), flags);
+            // Hand the headers and payloads of all queued messages to the kernel at once.
+            nBytes = node.m_sock->SendMany(buffers, flags);
         }
         if (nBytes > 0) {
             node.m_last_send = GetTime<std::chrono::seconds>();
             node.nSendBytes += nBytes;
-            // Notify transport that bytes have been processed.
-            node.m_transport->MarkBytesSent(nBytes);
             // Update statistics per message type.
-            if (!msg_type.empty()) { // don't report v2 handshake bytes for now
-                node.AccountForSentBytes(msg_type, nBytes);
+            size_t accounted{0};
+            for (const auto& span : spans) {
+                if (accounted == (size_t)nBytes) break;
+                const size_t span_bytes{std::min(span.data.size(), (size_t)nBytes - accounted)};
+                if (!span.m_type->empty()) { // don't report v2 handshake bytes for now
+                    node.AccountForSentBytes(*span.m_type, span_bytes);
+                }
+                accounted += span_bytes;
             }
+            // Notify transport that bytes have been processed. This invalidates spans.
+            node.m_transport->MarkBytesSent(nBytes);
             nSentSize += nBytes;
-            if ((size_t)nBytes != data.size()) {
+            if ((size_t)nBytes != to_send) {
                 // could not send full message; stop sending more
                 break;
             }
@@ -2001,15 +2092,11 @@ bool CConnman::InactivityCheck(const CNode& node) const
     return false;
 }
 
-Sock::EventsPerSock CConnman::GenerateWaitSockets(Span<CNode* const> nodes)
+void CConnman::UpdateSockEvents(Span<CNode* const> nodes)
 {
-    Sock::EventsPerSock events_per_sock;
-
-    for (const ListenSocket& hListenSocket : vhListenSocket) {
-        events_per_sock.emplace(hListenSocket.sock, Sock::Events{Sock::RECV});
-    }
-
     for (CNode* pnode : nodes) {
+        if (!pnode->m_sock_events_changed.exchange(false)) continue;
+
         bool select_recv = !pnode->fPauseRecv;
         bool select_send;
         {
@@ -2020,16 +2107,22 @@ Sock::EventsPerSock CConnman::GenerateWaitSockets(Span<CNode* const> nodes)
             const auto& [to_send, more, _msg_type] = pnode->m_transport->GetBytesToSend(!pnode->vSendMsg.empty());
             select_send = !to_send.empty() || more;
         }
-        if (!select_recv && !select_send) continue;
+        const Sock::Event requested = (select_send ? Sock::SEND : 0) | (select_recv ? Sock::RECV : 0);
+        if (pnode->m_sock_events == requested) continue;
 
-        LOCK(pnode->m_sock_mutex);
-        if (pnode->m_sock) {
-            Sock::Event event = (select_send ? Sock::SEND : 0) | (select_recv ? Sock::RECV : 0);
-            events_per_sock.emplace(pnode->m_sock, Sock::Events{event});
+        bool registered{false};
+        {
+            LOCK(pnode->m_sock_mutex);
+            if (!pnode->m_sock) continue;
+            registered = m_sock_poller->Set(pnode->m_sock, requested);
+        }
+        if (registered) {
+            pnode->m_sock_events = requested;
+        } else {
+            LogPrint(BCLog::NET, "cannot wait on socket for peer=%d, disconnecting\n", pnode->GetId());
+            pnode->fDisconnect = true;
         }
     }
-
-    return events_per_sock;
 }
 
 void CConnman::SocketHandler()
@@ -2045,10 +2138,11 @@ void CConnman::SocketHandler()
 
         // Check for the readiness of the already connected sockets and the
         // listening sockets in one call ("readiness" as in poll(2) or
-        // select(2)). If none are ready, wait for a short while and return
-        // empty sets.
-        events_per_sock = GenerateWaitSockets(snap.Nodes());
-        if (events_per_sock.empty() || !events_per_sock.begin()->first->WaitMany(timeout, events_per_sock)) {
+        // select(2)). The sockets stay registered with the poller, so only
+        // those whose requested events changed are updated here. If none are
+        // ready, wait for a short while and return empty sets.
+        UpdateSockEvents(snap.Nodes());
+        if (!m_sock_poller->Wait(timeout, events_per_sock)) {
             interruptNet.sleep_for(timeout);
         }
 
@@ -2088,6 +2182,10 @@ void CConnman::SocketHandlerConnected(const std::vector<CNode*>& nodes,
             }
         }
 
+        // Sending or receiving below may drain the send queue, hand the
+        // transport bytes to send, or pause receiving.
+        if (recvSet || sendSet || errorSet) pnode->m_sock_events_changed = true;
+
         if (sendSet) {
             // Send data
             auto [bytes_sent, data_left] = WITH_LOCK(pnode->cs_vSend, return SocketSendData(*pnode));
@@ -2172,12 +2270,21 @@ void CConnman::ThreadSocketHandler()
 {
     AssertLockNotHeld(m_total_bytes_sent_mutex);
 
+    m_sock_poller = CreateSockPoller();
+    for (const ListenSocket& listen_socket : vhListenSocket) {
+        if (!m_sock_poller->Set(listen_socket.sock, Sock::RECV)) {
+            LogPrintf("Cannot wait on a listening socket, connections to it will not be accepted\n");
+        }
+    }
+
     while (!interruptNet)
     {
         DisconnectNodes();
         NotifyNumConnectionsChanged();
         SocketHandler();
     }
+
+    m_sock_poller.reset();
 }
 
 void CConnman::WakeMessageHandler()
@@ -2930,6 +3037,35 @@ void CConnman::ThreadMessageHandler()
     }
 }
 
+bool CConnman::PostNodeTask(CNode& node, std::function<void()> task)
+{
+    if (m_node_task_threads.empty() || flagInterruptMsgProc) return false;
+    node.AddRef();
+    {
+        LOCK(m_node_tasks_mutex);
+        m_node_tasks.emplace_back(&node, std::move(task));
+    }
+    m_node_tasks_cond.notify_one();
+    return true;
+}
+
+void CConnman::ThreadNodeTasks()
+{
+    while (true) {
+        std::pair<CNode*, std::function<void()>> task;
+        {
+            WAIT_LOCK(m_node_tasks_mutex, lock);
+            m_node_tasks_cond.wait(lock, [this]() EXCLUSIVE_LOCKS_REQUIRED(m_node_tasks_mutex) { return flagInterruptMsgProc || !m_node_tasks.empty(); });
+            if (flagInterruptMsgProc) return;
+            task = std::move(m_node_tasks.front());
+            m_node_tasks.pop_front();
+        }
+        task.second();
+        task.first->Release();
+        WakeMessageHandler();
+    }
+}
+
 void CConnman::ThreadI2PAcceptIncoming()
 {
     static constexpr auto err_wait_begin = 1s;
@@ -3264,7 +3400,11 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
             [this, connect = connOptions.m_specified_outgoing] { ThreadOpenConnections(connect); });
     }
 
-    // Process messages
+    // Process messages, with workers started first so that the message
+    // handler sees all of them
+    for (int i = 0; i < m_msghand_workers; ++i) {
+        m_node_task_threads.emplace_back(&util::TraceThread, strprintf("msgwork.%i", i), [this] { ThreadNodeTasks(); });
+    }
     threadMessageHandler = std::thread(&util::TraceThread, "msghand", [this] { ThreadMessageHandler(); });
 
     if (m_i2p_sam_session) {
@@ -3300,6 +3440,7 @@ void CConnman::Interrupt()
         flagInterruptMsgProc = true;
     }
     condMsgProc.notify_all();
+    WITH_LOCK(m_node_tasks_mutex, m_node_tasks_cond.notify_all());
 
     interruptNet();
     InterruptSocks5(true);
@@ -3324,6 +3465,15 @@ void CConnman::StopThreads()
     }
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
+    for (auto& thread : m_node_task_threads) {
+        if (thread.joinable()) thread.join();
+    }
+    m_node_task_threads.clear();
+    {
+        LOCK(m_node_tasks_mutex);
+        for (auto& [node, task] : m_node_tasks) node->Release();
+        m_node_tasks.clear();
+    }
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -3725,7 +3875,8 @@ std::optional<std::pair<CNetMessage, bool>> CNode::PollMessage()
     // Just take one message
     msgs.splice(msgs.begin(), m_msg_process_queue, m_msg_process_queue.begin());
     m_msg_process_queue_size -= msgs.front().m_raw_message_size;
-    fPauseRecv = m_msg_process_queue_size > m_recv_flood_size;
+    const bool pause_recv{m_msg_process_queue_size > m_recv_flood_size};
+    if (fPauseRecv.exchange(pause_recv) != pause_recv) m_sock_events_changed = true;
 
     return std::make_pair(std::move(msgs.front()), !m_msg_process_queue.empty());
 }
@@ -3738,10 +3889,10 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
     AssertLockNotHeld(m_total_bytes_sent_mutex);
-    size_t nMessageSize = msg.data.size();
-    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n", msg.m_type, nMessageSize, pnode->GetId());
+    const Span<const unsigned char> payload{msg.Payload()};
+    LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n", msg.m_type, payload.size(), pnode->GetId());
     if (gArgs.GetBoolArg("-capturemessages", false)) {
-        CaptureMessage(pnode->addr, msg.m_type, msg.data, /*is_incoming=*/false);
+        CaptureMessage(pnode->addr, msg.m_type, payload, /*is_incoming=*/false);
     }
 
     TRACE6(net, outbound_message,
@@ -3749,8 +3900,8 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         pnode->m_addr_name.c_str(),
         pnode->ConnectionTypeAsString().c_str(),
         msg.m_type.c_str(),
-        msg.data.size(),
-        msg.data.data()
+        payload.size(),
+        payload.data()
     );
 
     size_t nBytesSent = 0;
@@ -3779,6 +3930,7 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
             std::tie(nBytesSent, std::ignore) = SocketSendData(*pnode);
         }
     }
+    pnode->m_sock_events_changed = true;
     if (nBytesSent) RecordBytesSent(nBytesSent);
 }
 
@@ -95,6 +95,10 @@ static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
 static constexpr bool DEFAULT_V2_TRANSPORT{false};
+/** Default for -msghandworkers */
+static constexpr int DEFAULT_MSGHAND_WORKERS{2};
+/** Maximum for -msghandworkers */
+static constexpr int MAX_MSGHAND_WORKERS{16};
 
 typedef int64_t NodeId;
 
@@ -121,16 +125,38 @@ struct CSerializedNetMsg {
     CSerializedNetMsg(const CSerializedNetMsg& msg) = delete;
     CSerializedNetMsg& operator=(const CSerializedNetMsg&) = delete;
 
+    /** Copy the message. A shared payload is not copied, only referenced again. */
     CSerializedNetMsg Copy() const
     {
         CSerializedNetMsg copy;
         copy.data = data;
         copy.m_type = m_type;
+        copy.m_shared = m_shared;
         return copy;
     }
 
+    /** An immutable serialized payload, along with its double-SHA256 hash. */
+    struct SharedPayload {
+        std::vector<unsigned char> data;
+        uint256 hash;
+    };
+
+    /**
+     * Move the payload into a reference-counted immutable buffer, so that copies of this message
+     * made with Copy() (e.g. to relay it to many peers) do not duplicate or rehash it.
+     */
+    void Share();
+
+    /** The payload of the message, whether owned or shared. */
+    Span<const unsigned char> Payload() const noexcept
+    {
+        return m_shared ? Span<const unsigned char>{m_shared->data} : Span<const unsigned char>{data};
+    }
+
     std::vector<unsigned char> data;
     std::string m_type;
+    /** Payload shared with other messages. If set, data is empty. */
+    std::shared_ptr<const SharedPayload> m_shared;
 
     /** Compute total memory usage of this object (own memory + any dynamic memory). */
     size_t GetMemoryUsage() const noexcept;
@@ -352,9 +378,28 @@ public:
      */
     virtual BytesToSend GetBytesToSend(bool have_next_message) const noexcept = 0;
 
+    /** A span of bytes to send, and the message type it is sent on behalf of. */
+    struct SendSpan {
+        Span<const uint8_t> data;
+        const std::string* m_type;
+    };
+
+    /** Get all bytes that can be sent on the wire right now, as a sequence of spans.
+     *
+     * The first span is the to_send returned by GetBytesToSend(); the following ones continue
+     * the same stream, e.g. with the payload after a header, or with further messages queued in
+     * the transport, so that they can all be handed to the socket in a single call. Non-empty
+     * spans are appended to `spans`.
+     *
+     * @return the 'more' value that GetBytesToSend() would report once all of these spans are
+     *         sent. The default implementation returns just the span of GetBytesToSend().
+     */
+    virtual bool GetBytesToSendMany(bool have_next_message, std::vector<SendSpan>& spans) const noexcept;
+
     /** Report how many bytes returned by the last GetBytesToSend() have been sent.
      *
-     * bytes_sent cannot exceed to_send.size() of the last GetBytesToSend() result.
+     * bytes_sent cannot exceed to_send.size() of the last GetBytesToSend() result, or the total
+     * size of the spans returned by the last GetBytesToSendMany().
      *
      * If bytes_sent=0, this call has no effect.
      */
@@ -407,18 +452,26 @@ private:
         return hdr.nMessageSize == nDataPos;
     }
 
+    /** A message handed to SetMessageToSend, with its serialized header. */
+    struct MessageToSend {
+        std::vector<uint8_t> header;
+        CSerializedNetMsg msg;
+    };
+
     /** Lock for sending state. */
     mutable Mutex m_send_mutex;
-    /** The header of the message currently being sent. */
-    std::vector<uint8_t> m_header_to_send GUARDED_BY(m_send_mutex);
-    /** The data of the message currently being sent. */
-    CSerializedNetMsg m_message_to_send GUARDED_BY(m_send_mutex);
-    /** Whether we're currently sending header bytes or message bytes. */
+    /** Messages not yet completely sent, the one currently being sent first. At most
+     *  MAX_SEND_QUEUE long, so that GetBytesToSendMany() can batch them. */
+    std::deque<MessageToSend> m_send_queue GUARDED_BY(m_send_mutex);
+    /** Whether we're currently sending header bytes or message bytes of the first message. */
     bool m_sending_header GUARDED_BY(m_send_mutex) {false};
-    /** How many bytes have been sent so far (from m_header_to_send, or from m_message_to_send.data). */
+    /** How many bytes have been sent so far (from the header or payload of the first message). */
     size_t m_bytes_sent GUARDED_BY(m_send_mutex) {0};
 
 public:
+    /** Maximum number of messages V1Transport accepts before the first one is sent. */
+    static constexpr size_t MAX_SEND_QUEUE{32};
+
     V1Transport(const NodeId node_id, int nTypeIn, int nVersionIn) noexcept;
 
     bool ReceivedMessageComplete() const override EXCLUSIVE_LOCKS_REQUIRED(!m_recv_mutex)
@@ -446,6 +499,7 @@ public:
 
     bool SetMessageToSend(CSerializedNetMsg& msg) noexcept override EXCLUSIVE_LOCKS_REQUIRED(!m_send_mutex);
     BytesToSend GetBytesToSend(bool have_next_message) const noexcept override EXCLUSIVE_LOCKS_REQUIRED(!m_send_mutex);
+    bool GetBytesToSendMany(bool have_next_message, std::vector<SendSpan>& spans) const noexcept override EXCLUSIVE_LOCKS_REQUIRED(!m_send_mutex);
     void MarkBytesSent(size_t bytes_sent) noexcept override EXCLUSIVE_LOCKS_REQUIRED(!m_send_mutex);
     size_t GetSendMemoryUsage() const noexcept override EXCLUSIVE_LOCKS_REQUIRED(!m_send_mutex);
     bool ShouldReconnectV1() const noexcept override { return false; }
@@ -662,6 +716,7 @@ public:
     // Send side functions.
     bool SetMessageToSend(CSerializedNetMsg& msg) noexcept override EXCLUSIVE_LOCKS_REQUIRED(!m_send_mutex);
     BytesToSend GetBytesToSend(bool have_next_message) const noexcept override EXCLUSIVE_LOCKS_REQUIRED(!m_send_mutex);
+    bool GetBytesToSendMany(bool have_next_message, std::vector<SendSpan>& spans) const noexcept override EXCLUSIVE_LOCKS_REQUIRED(!m_send_mutex);
     void MarkBytesSent(size_t bytes_sent) noexcept override EXCLUSIVE_LOCKS_REQUIRED(!m_send_mutex);
     size_t GetSendMemoryUsage() const noexcept override EXCLUSIVE_LOCKS_REQUIRED(!m_send_mutex);
 
@@ -747,6 +802,12 @@ public:
     const uint64_t nKeyedNetGroup;
     std::atomic_bool fPauseRecv{false};
     std::atomic_bool fPauseSend{false};
+    /** Set when the events to wait for on m_sock may have changed, because a message
+     *  was queued or fPauseRecv flipped, so that the socket handler re-registers them. */
+    std::atomic_bool m_sock_events_changed{true};
+    /** Events m_sock is registered for with the socket handler's poller, if any.
+     *  Used only by SocketHandler thread. */
+    std::optional<Sock::Event> m_sock_events;
 
     const ConnectionType m_conn_type;
 
@@ -1069,6 +1130,7 @@ public:
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
         bool m_i2p_accept_incoming;
+        int m_msghand_workers = 0;
     };
 
     void Init(const Options& connOptions) EXCLUSIVE_LOCKS_REQUIRED(!m_added_nodes_mutex, !m_total_bytes_sent_mutex)
@@ -1103,6 +1165,7 @@ public:
             }
         }
         m_onion_binds = connOptions.onion_binds;
+        m_msghand_workers = connOptions.m_msghand_workers;
     }
 
     CConnman(uint64_t seed0, uint64_t seed1, AddrMan& addrman, const NetGroupManager& netgroupman,
@@ -1244,6 +1307,17 @@ public:
 
     void WakeMessageHandler() EXCLUSIVE_LOCKS_REQUIRED(!mutexMsgProc);
 
+    /**
+     * Run work on behalf of a single node, such as serving a block from disk, on
+     * a worker thread instead of the message handler thread. The node is not
+     * deleted before the task has run, and the message handler is woken up after
+     * it. Tasks that have not run when the worker threads are interrupted are
+     * dropped.
+     * @return false if there are no worker threads, in which case the caller
+     *         should do the work itself
+     */
+    bool PostNodeTask(CNode& node, std::function<void()> task) EXCLUSIVE_LOCKS_REQUIRED(!m_node_tasks_mutex);
+
     /** Return true if we should disconnect the peer for failing an inactivity check. */
     bool ShouldRunInactivityChecks(const CNode& node, std::chrono::seconds now) const;
 
@@ -1276,6 +1350,7 @@ private:
     void ProcessAddrFetch() EXCLUSIVE_LOCKS_REQUIRED(!m_addr_fetches_mutex, !m_unused_i2p_sessions_mutex);
     void ThreadOpenConnections(std::vector<std::string> connect) EXCLUSIVE_LOCKS_REQUIRED(!m_addr_fetches_mutex, !m_added_nodes_mutex, !m_nodes_mutex, !m_unused_i2p_sessions_mutex, !m_reconnections_mutex);
     void ThreadMessageHandler() EXCLUSIVE_LOCKS_REQUIRED(!mutexMsgProc);
+    void ThreadNodeTasks() EXCLUSIVE_LOCKS_REQUIRED(!m_node_tasks_mutex, !mutexMsgProc);
     void ThreadI2PAcceptIncoming();
     void AcceptConnection(const ListenSocket& hListenSocket);
 
@@ -1298,11 +1373,11 @@ private:
     bool InactivityCheck(const CNode& node) const;
 
     /**
-     * Generate a collection of sockets to check for IO readiness.
-     * @param[in] nodes Select from these nodes' sockets.
-     * @return sockets to check for readiness
+     * Update the events m_sock_poller waits for on the sockets of the nodes whose
+     * send queue or receive pause state changed since the last call.
+     * @param[in] nodes Update these nodes' sockets.
      */
-    Sock::EventsPerSock GenerateWaitSockets(Span<CNode* const> nodes);
+    void UpdateSockEvents(Span<CNode* const> nodes);
 
     /**
      * Check connected and listening sockets for IO readiness and process them accordingly.
@@ -1479,6 +1554,8 @@ private:
     int nMaxAddnode;
     int nMaxFeeler;
     int m_max_outbound;
+    /** Number of threads running PostNodeTask() tasks */
+    int m_msghand_workers{0};
     bool m_use_addrman_outgoing;
     CClientUIInterface* m_client_interface;
     NetEventsInterface* m_msgproc;
@@ -1516,12 +1593,24 @@ private:
      */
     std::unique_ptr<i2p::sam::Session> m_i2p_sam_session;
 
+    /**
+     * Sockets the socket handler thread waits on, registered once and updated
+     * when the events to wait for change. Used only by SocketHandler thread.
+     */
+    std::unique_ptr<SockPoller> m_sock_poller;
+
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
     std::thread threadI2PAcceptIncoming;
+    std::vector<std::thread> m_node_task_threads;
+
+    Mutex m_node_tasks_mutex;
+    std::condition_variable m_node_tasks_cond;
+    /** Tasks posted with PostNodeTask(), each holding a reference to its node */
+    std::deque<std::pair<CNode*, std::function<void()>>> m_node_tasks GUARDED_BY(m_node_tasks_mutex);
 
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of m_max_outbound_full_relay
@@ -22,11 +22,14 @@
 #include <merkleblock.h>
 #include <netbase.h>
 #include <netmessagemaker.h>
+#include <node/blockservecache.h>
 #include <node/blockstorage.h>
 #include <node/txreconciliation.h>
 #include <policy/fees.h>
+#include <policy/packages.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
+#include <pow.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <random.h>
@@ -47,7 +50,9 @@
 #include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <deque>
 #include <future>
+#include <map>
 #include <memory>
 #include <optional>
 #include <typeinfo>
@@ -92,6 +97,8 @@ static constexpr int32_t MAX_PEER_TX_REQUEST_IN_FLIGHT = 100;
  *  rate (by our own policy, see INVENTORY_BROADCAST_PER_SECOND) for several minutes, while not receiving
  *  the actual transaction (from any peer) in response to requests for them. */
 static constexpr int32_t MAX_PEER_TX_ANNOUNCEMENTS = 5000;
+/** Maximum number of getpkgtxns requests a peer may have outstanding with us. */
+static constexpr size_t MAX_PEER_PACKAGE_REQUESTS{100};
 /** How long to delay requesting transactions via txids, if we have wtxid-relaying peers */
 static constexpr auto TXID_RELAY_DELAY{2s};
 /** How long to delay requesting transactions from non-preferred peers */
@@ -102,8 +109,11 @@ static constexpr auto OVERLOADED_PEER_TX_DELAY{2s};
 static constexpr auto GETDATA_TX_INTERVAL{60s};
 /** Limit to avoid sending big packets. Not used in processing incoming GETDATA for compatibility */
 static const unsigned int MAX_GETDATA_SZ = 1000;
-/** Number of blocks that can be requested at any given time from a single peer. */
+/** Number of blocks that can be requested at any given time from a single peer, until we know how fast it is. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Bounds on the number of blocks in flight from a single peer, once sized from its measured download speed. */
+static constexpr int MIN_BLOCKS_IN_TRANSIT_PER_PEER{4};
+static constexpr int MAX_BLOCKS_IN_TRANSIT_PER_FAST_PEER{128};
 /** Default time during which a peer must stall block download progress before being disconnected.
  * the actual timeout is increased temporarily if peers are disconnected for hitting the timeout */
 static constexpr auto BLOCK_STALLING_TIMEOUT_DEFAULT{2s};
@@ -119,9 +129,12 @@ static const int MAX_CMPCTBLOCK_DEPTH = 5;
 static const int MAX_BLOCKTXN_DEPTH = 10;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
- *  degree of disordering of blocks on disk (which make reindexing and pruning harder). We'll probably
- *  want to make this a per-peer adaptive value at some point. */
+ *  degree of disordering of blocks on disk (which make reindexing and pruning harder). The window
+ *  grows with the number of blocks in flight, up to MAX_BLOCK_DOWNLOAD_WINDOW. */
 static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
+static constexpr unsigned int MAX_BLOCK_DOWNLOAD_WINDOW{4096};
+/** How many times the blocks in flight across all peers the download window spans. */
+static constexpr unsigned int BLOCK_DOWNLOAD_WINDOW_PER_IN_FLIGHT{8};
 /** Block download timeout base, expressed in multiples of the block interval (i.e. 10 min) */
 static constexpr double BLOCK_DOWNLOAD_TIMEOUT_BASE = 1;
 /** Additional block download timeout per parallel downloading peer (i.e. 5 min) */
@@ -184,6 +197,8 @@ struct QueuedBlock {
     const CBlockIndex* pindex;
     /** Optional, used for CMPCTBLOCK downloads */
     std::unique_ptr<PartiallyDownloadedBlock> partialBlock;
+    /** When the block was requested */
+    std::chrono::microseconds m_requested;
 };
 
 /**
@@ -254,6 +269,11 @@ struct Peer {
 
     /** Whether this peer relays txs via wtxid */
     std::atomic<bool> m_wtxid_relay{false};
+    /** Whether this peer relays transactions together with their unconfirmed parents */
+    std::atomic<bool> m_package_relay{false};
+    /** Wtxids of the transactions we asked this peer for with getpkgtxns, with
+     *  the time after which an answer is no longer expected. */
+    std::map<uint256, std::chrono::microseconds> m_package_requests GUARDED_BY(NetEventsInterface::g_msgproc_mutex);
     /** The feerate in the most recent BIP133 `feefilter` message sent to the peer.
      *  It is *not* a p2p protocol violation for the peer to send us
      *  transactions with a lower fee rate than this. See BIP133. */
@@ -365,6 +385,9 @@ struct Peer {
     Mutex m_getdata_requests_mutex;
     /** Work queue of items requested by this peer **/
     std::deque<CInv> m_getdata_requests GUARDED_BY(m_getdata_requests_mutex);
+    /** Whether the block at the front of m_getdata_requests is being served by a
+     *  CConnman worker thread. It is popped from the queue once it has been. */
+    bool m_getdata_block_in_flight GUARDED_BY(m_getdata_requests_mutex){false};
 
     /** Time of the last getheaders message to this peer */
     NodeClock::time_point m_last_getheaders_timestamp GUARDED_BY(NetEventsInterface::g_msgproc_mutex){};
@@ -423,6 +446,16 @@ struct CNodeState {
     std::list<QueuedBlock> vBlocksInFlight;
     //! When the first entry in vBlocksInFlight started downloading. Don't care when vBlocksInFlight is empty.
     std::chrono::microseconds m_downloading_since{0us};
+    //! Smoothed time from requesting a block while nothing else was on its way to receiving it, or 0 if unknown.
+    std::chrono::microseconds m_block_latency{0us};
+    //! Smoothed time between blocks received back to back, or 0 if unknown.
+    std::chrono::microseconds m_block_interval{0us};
+    //! When we last received a block we requested from this peer.
+    std::chrono::microseconds m_last_block_received{0us};
+    //! How many blocks may be in flight from this peer, enough to keep it busy for one latency.
+    int m_max_blocks_in_flight{MAX_BLOCKS_IN_TRANSIT_PER_PEER};
+    //! Number of blocks requested from this peer because the peer they were in flight from was holding up the download.
+    uint64_t m_blocks_taken_over{0};
     //! Whether we consider this a preferred download peer.
     bool fPreferredDownload{false};
     /** Whether this peer wants invs or cmpctblocks (when possible) for block announcements. */
@@ -576,16 +609,17 @@ private:
     /**
      * Reconsider orphan transactions after a parent has been accepted to the mempool.
      *
-     * @peer[in]  peer     The peer whose orphan transactions we will reconsider. Generally only
-     *                     one orphan will be reconsidered on each call of this function. If an
-     *                     accepted orphan has orphaned children, those will need to be
-     *                     reconsidered, creating more work, possibly for other peers.
+     * @peer[in]  peer     The peer whose orphan transactions we will reconsider. All orphans in
+     *                     the peer's work set are reconsidered as one batch, with their scripts
+     *                     verified together before cs_main is taken. An orphan failing them only
+     *                     affects itself. If an accepted orphan has orphaned children, those will
+     *                     need to be reconsidered, creating more work, possibly for other peers.
      * @return             True if meaningful work was done (an orphan was accepted/rejected).
      *                     If no meaningful work was done, then the work set for this peer
      *                     will be empty.
      */
     bool ProcessOrphanTx(Peer& peer)
-        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, g_msgproc_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, g_msgproc_mutex, !cs_main);
 
     /** Process a single headers message from a peer.
      *
@@ -609,6 +643,10 @@ private:
     void HandleFewUnconnectingHeaders(CNode& pfrom, Peer& peer, const std::vector<CBlockHeader>& headers) EXCLUSIVE_LOCKS_REQUIRED(g_msgproc_mutex);
     /** Return true if the headers connect to each other, false otherwise */
     bool CheckHeadersAreContinuous(const std::vector<CBlockHeader>& headers) const;
+    /** Run the checks of ContextualCheckBlockHeader() other than the proof of
+     *  work on a continuous sequence of headers building on chain_start. */
+    bool CheckHeadersContext(const std::vector<CBlockHeader>& headers, const CBlockIndex& chain_start, BlockValidationState& state)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Try to continue a low-work headers sync that has already begun.
      * Assumes the caller has already verified the headers connect, and has
      * checked that each header satisfies the proof-of-work target included in
@@ -718,6 +756,9 @@ private:
 
     const Options m_opts;
 
+    /** Serialized blocks recently served in block messages. */
+    node::BlockServeCache m_block_serve_cache;
+
     bool RejectIncomingTxs(const CNode& peer) const;
 
     /** Whether we've completed initial sync yet, for determining when to turn
@@ -890,6 +931,17 @@ private:
      */
     bool BlockRequested(NodeId nodeid, const CBlockIndex& block, std::list<QueuedBlock>::iterator** pit = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /** Update the download speed of a peer that sent a block we requested from it,
+     *  and size the number of blocks we keep in flight from it accordingly. */
+    void BlockReceived(NodeId nodeid, const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /** How far ahead of the last common block with a peer we download. */
+    int BlockDownloadWindow() const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /** Pick the oldest block in flight from a peer that is stalling the
+     *  download window, to be requested from a faster peer as well. */
+    const CBlockIndex* TakeOverBlockRequest(NodeId nodeid, NodeId staller, std::chrono::microseconds now) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     bool TipMayBeStale() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     /** Update pindexLastCommonBlock and add not-in-flight missing successors to vBlocks, until it has
@@ -944,6 +996,10 @@ private:
         EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex, peer.m_getdata_requests_mutex, NetEventsInterface::g_msgproc_mutex)
         LOCKS_EXCLUDED(::cs_main);
 
+    /** Announce the transactions a reconciliation found the peer to be missing. */
+    void AnnounceReconciledTxs(CNode& pfrom, Peer& peer, const std::vector<uint256>& wtxids)
+        EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex);
+
     /** Process a new block. Perform any post-processing housekeeping */
     void ProcessBlock(CNode& node, const std::shared_ptr<const CBlock>& block, bool force_processing, bool min_pow_checked);
 
@@ -962,6 +1018,20 @@ private:
     /** Stack of nodes which we have set to announce using compact blocks */
     std::list<NodeId> lNodesAnnouncingHeaderAndIDs GUARDED_BY(cs_main);
 
+    /**
+     * Whether a new compact block may be relayed to high-bandwidth peers before
+     * it is validated: it must extend our tip and its header must be valid in
+     * that context. Its proof of work is checked separately, outside cs_main.
+     */
+    bool CanFastRelayCompactBlock(const CBlockHeader& header, const CBlockIndex& prev) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /**
+     * Forward a compact block that extends our tip to the high-bandwidth peers
+     * which have its parent, other than the peer it came from. Returns the peers
+     * it was sent to.
+     */
+    std::vector<NodeId> FastRelayCompactBlock(const CBlockHeaderAndShortTxIDs& cmpctblock, const CBlockIndex& prev, NodeId from) EXCLUSIVE_LOCKS_REQUIRED(!cs_main);
+
     /** Number of peers from which we're downloading blocks. */
     int m_peers_downloading_from GUARDED_BY(cs_main) = 0;
 
@@ -992,7 +1062,7 @@ private:
     bool BlockRequestAllowed(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool AlreadyHaveBlock(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     void ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv& inv)
-        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex, !cs_main);
 
     /**
      * Validation logic for compact filters request handling.
@@ -1221,7 +1291,7 @@ bool PeerManagerImpl::BlockRequested(NodeId nodeid, const CBlockIndex& block, st
     RemoveBlockRequest(hash, nodeid);
 
     std::list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(),
-            {&block, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&m_mempool) : nullptr)});
+            {&block, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&m_mempool) : nullptr), GetTime<std::chrono::microseconds>()});
     if (state->vBlocksInFlight.size() == 1) {
         // We're starting a block download (batch) from this peer.
         state->m_downloading_since = GetTime<std::chrono::microseconds>();
@@ -1234,6 +1304,61 @@ bool PeerManagerImpl::BlockRequested(NodeId nodeid, const CBlockIndex& block, st
     return true;
 }
 
+void PeerManagerImpl::BlockReceived(NodeId nodeid, const uint256& hash)
+{
+    for (auto range = mapBlocksInFlight.equal_range(hash); range.first != range.second; range.first++) {
+        const auto& [node_id, list_it] = range.first->second;
+        if (node_id != nodeid) continue;
+
+        CNodeState& state = *Assert(State(nodeid));
+        const auto now{GetTime<std::chrono::microseconds>()};
+        const auto smooth = [](std::chrono::microseconds avg, std::chrono::microseconds sample) {
+            return avg == 0us ? sample : (avg * 7 + sample) / 8;
+        };
+        if (list_it->m_requested >= state.m_last_block_received) {
+            // Nothing else was on its way when we asked: the peer waited for
+            // our request, so this took a round trip plus one transfer.
+            state.m_block_latency = smooth(state.m_block_latency, now - list_it->m_requested);
+        } else {
+            // The request was queued behind an earlier block, so the peer
+            // was sending all along, and this took one transfer.
+            state.m_block_interval = smooth(state.m_block_interval, now - state.m_last_block_received);
+        }
+        state.m_last_block_received = now;
+
+        if (state.m_block_latency > 0us && state.m_block_interval > 0us) {
+            // Keep twice as many blocks in flight as the peer can send during
+            // one latency, so it never waits for our next request.
+            const auto interval{std::max<std::chrono::microseconds>(state.m_block_interval, 1ms)};
+            state.m_max_blocks_in_flight = std::clamp<int64_t>(2 * state.m_block_latency / interval,
+                                                               MIN_BLOCKS_IN_TRANSIT_PER_PEER, MAX_BLOCKS_IN_TRANSIT_PER_FAST_PEER);
+        }
+        return;
+    }
+}
+
+int PeerManagerImpl::BlockDownloadWindow() const
+{
+    return std::clamp<size_t>(mapBlocksInFlight.size() * BLOCK_DOWNLOAD_WINDOW_PER_IN_FLIGHT, BLOCK_DOWNLOAD_WINDOW, MAX_BLOCK_DOWNLOAD_WINDOW);
+}
+
+const CBlockIndex* PeerManagerImpl::TakeOverBlockRequest(NodeId nodeid, NodeId staller, std::chrono::microseconds now)
+{
+    const CNodeState& state = *Assert(State(nodeid));
+    const CNodeState* staller_state = State(staller);
+    if (staller == nodeid || !staller_state || staller_state->m_stalling_since == 0us || staller_state->vBlocksInFlight.empty()) return nullptr;
+    // Only a peer whose speed we know can be expected to do better.
+    if (state.m_block_latency == 0us) return nullptr;
+
+    const QueuedBlock& queued = staller_state->vBlocksInFlight.front();
+    const CBlockIndex* pindex{queued.pindex};
+    if (now - queued.m_requested < 2 * state.m_block_latency) return nullptr;
+    // Don't pile up requests for the same block.
+    if (mapBlocksInFlight.count(pindex->GetBlockHash()) > 1) return nullptr;
+    if (!state.pindexBestKnownBlock || state.pindexBestKnownBlock->GetAncestor(pindex->nHeight) != pindex) return nullptr;
+    return pindex;
+}
+
 void PeerManagerImpl::MaybeSetPeerAsAnnouncingHeaderAndIDs(NodeId nodeid)
 {
     AssertLockHeld(cs_main);
@@ -1383,7 +1508,7 @@ void PeerManagerImpl::FindNextBlocksToDownload(const Peer& peer, unsigned int co
     // Never fetch further than the best block we know the peer has, or more than BLOCK_DOWNLOAD_WINDOW + 1 beyond the last
     // linked block we have in common with this peer. The +1 is so we can detect stalling, namely if we would be able to
     // download that next block if the window were 1 larger.
-    int nWindowEnd = state->pindexLastCommonBlock->nHeight + BLOCK_DOWNLOAD_WINDOW;
+    int nWindowEnd = state->pindexLastCommonBlock->nHeight + BlockDownloadWindow();
 
     FindNextBlocks(vBlocks, peer, state, pindexWalk, count, nWindowEnd, &m_chainman.ActiveChain(), &nodeStaller);
 }
@@ -1414,7 +1539,7 @@ void PeerManagerImpl::TryDownloadingHistoricalBlocks(const Peer& peer, unsigned
         return;
     }
 
-    FindNextBlocks(vBlocks, peer, state, from_tip, count, std::min<int>(from_tip->nHeight + BLOCK_DOWNLOAD_WINDOW, target_block->nHeight));
+    FindNextBlocks(vBlocks, peer, state, from_tip, count, std::min<int>(from_tip->nHeight + BlockDownloadWindow(), target_block->nHeight));
 }
 
 void PeerManagerImpl::FindNextBlocks(std::vector<const CBlockIndex*>& vBlocks, const Peer& peer, CNodeState *state, const CBlockIndex *pindexWalk, unsigned int count, int nWindowEnd, const CChain* activeChain, NodeId* nodeStaller)
@@ -1674,6 +1799,10 @@ bool PeerManagerImpl::GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats) c
             if (queue.pindex)
                 stats.vHeightInFlight.push_back(queue.pindex->nHeight);
         }
+        stats.m_max_blocks_in_flight = state->m_max_blocks_in_flight;
+        stats.m_block_latency = state->m_block_latency;
+        stats.m_block_interval = state->m_block_interval;
+        stats.m_blocks_taken_over = state->m_blocks_taken_over;
     }
 
     PeerRef peer = GetPeerRef(nodeid);
@@ -1889,10 +2018,11 @@ PeerManagerImpl::PeerManagerImpl(CConnman& connman, AddrMan& addrman,
       m_banman(banman),
       m_chainman(chainman),
       m_mempool(pool),
-      m_opts{opts}
+      m_opts{opts},
+      m_block_serve_cache{opts.block_serve_cache_bytes}
 {
-    // While Erlay support is incomplete, it must be enabled explicitly via -txreconciliation.
-    // This argument can go away after Erlay support is complete.
+    // Erlay replaces most of the transaction flooding to the peers that support it, so it stays
+    // opt-in via -txreconciliation until it has seen wider use.
     if (opts.reconcile_txs) {
         m_txreconciliation = std::make_unique<TxReconciliationTracker>(TXRECONCILIATION_VERSION);
     }
@@ -1976,6 +2106,47 @@ void PeerManagerImpl::BlockDisconnected(const std::shared_ptr<const CBlock> &blo
     m_recent_confirmed_transactions.reset();
 }
 
+bool PeerManagerImpl::CanFastRelayCompactBlock(const CBlockHeader& header, const CBlockIndex& prev)
+{
+    AssertLockHeld(cs_main);
+    if (!m_opts.fast_cmpctblock_relay || m_chainman.IsInitialBlockDownload()) return false;
+    if (&prev != m_chainman.ActiveChain().Tip()) return false;
+    if (!DeploymentActiveAfter(&prev, m_chainman, Consensus::DEPLOYMENT_SEGWIT)) return false;
+    // Peers punish invalid headers even when they come in a compact block.
+    BlockValidationState state;
+    return ContextualCheckBlockHeader(header, state, m_chainman, &prev);
+}
+
+std::vector<NodeId> PeerManagerImpl::FastRelayCompactBlock(const CBlockHeaderAndShortTxIDs& cmpctblock, const CBlockIndex& prev, NodeId from)
+{
+    const uint256 hash{cmpctblock.header.GetHash()};
+    std::optional<CSerializedNetMsg> msg;
+    std::vector<NodeId> relayed;
+
+    LOCK(cs_main);
+    // The tip may have moved while the proof of work was checked.
+    if (&prev != m_chainman.ActiveChain().Tip()) return relayed;
+
+    m_connman.ForEachNode([&](CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+        AssertLockHeld(::cs_main);
+
+        if (pnode->GetId() == from || pnode->GetCommonVersion() < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
+            return;
+        ProcessBlockAvailability(pnode->GetId());
+        CNodeState& state = *State(pnode->GetId());
+        if (!state.m_requested_hb_cmpctblocks || !PeerHasHeader(&state, &prev)) return;
+
+        LogPrint(BCLog::NET, "fast-relaying header-and-ids %s to peer=%d\n", hash.ToString(), pnode->GetId());
+        if (!msg) {
+            msg = CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::CMPCTBLOCK, cmpctblock);
+            msg->Share();
+        }
+        m_connman.PushMessage(pnode, msg->Copy());
+        relayed.push_back(pnode->GetId());
+    });
+    return relayed;
+}
+
 /**
  * Maintain state about the best-seen block and fast-announce a compact block
  * to compatible peers.
@@ -1995,7 +2166,12 @@ void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::sha
 
     uint256 hashBlock(pblock->GetHash());
     const std::shared_future<CSerializedNetMsg> lazy_ser{
-        std::async(std::launch::deferred, [&] { return msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock); })};
+        std::async(std::launch::deferred, [&] {
+            // Serialize and checksum once; every peer's copy references the same payload.
+            CSerializedNetMsg msg{msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock)};
+            msg.Share();
+            return msg;
+        })};
 
     {
         auto most_recent_block_txs = std::make_unique<std::map<uint256, CTransactionRef>>();
@@ -2044,6 +2220,10 @@ void PeerManagerImpl::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlock
     // Don't relay inventory during initial block download.
     if (fInitialDownload) return;
 
+    // The next block most likely uses the same RandomX key. Initializing the
+    // relay verifier now keeps that off the path of relaying it.
+    if (m_opts.fast_cmpctblock_relay) WarmUpProofOfWorkRelay(pindexNew->GetBlockHeader());
+
     // Find the hashes of all blocks that weren't previously in the best chain.
     std::vector<uint256> vHashes;
     const CBlockIndex *pindexToAnnounce = pindexNew;
@@ -2251,65 +2431,106 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
         }
     }
 
-    LOCK(cs_main);
-    const CBlockIndex* pindex = m_chainman.m_blockman.LookupBlockIndex(inv.hash);
-    if (!pindex) {
-        return;
-    }
-    if (!BlockRequestAllowed(pindex)) {
-        LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom.GetId());
-        return;
+    const CBlockIndex* pindex{nullptr};
+    const CBlockIndex* tip{nullptr};
+    bool can_direct_fetch{false};
+    FlatFilePos block_pos{};
+    {
+        LOCK(cs_main);
+        pindex = m_chainman.m_blockman.LookupBlockIndex(inv.hash);
+        if (!pindex) {
+            return;
+        }
+        if (!BlockRequestAllowed(pindex)) {
+            LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom.GetId());
+            return;
+        }
+        // disconnect node in case we have reached the outbound limit for serving historical blocks
+        if (m_connman.OutboundTargetReached(true) &&
+            (((m_chainman.m_best_header != nullptr) && (m_chainman.m_best_header->GetBlockTime() - pindex->GetBlockTime() > HISTORICAL_BLOCK_AGE)) || inv.IsMsgFilteredBlk()) &&
+            !pfrom.HasPermission(NetPermissionFlags::Download) // nodes with the download permission may exceed target
+        ) {
+            LogPrint(BCLog::NET, "historical block serving limit reached, disconnect peer=%d\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+        // Avoid leaking prune-height by never sending blocks below the NODE_NETWORK_LIMITED threshold
+        if (!pfrom.HasPermission(NetPermissionFlags::NoBan) && (
+                (((peer.m_our_services & NODE_NETWORK_LIMITED) == NODE_NETWORK_LIMITED) && ((peer.m_our_services & NODE_NETWORK) != NODE_NETWORK) && (m_chainman.ActiveChain().Tip()->nHeight - pindex->nHeight > (int)NODE_NETWORK_LIMITED_MIN_BLOCKS + 2 /* add two blocks buffer extension for possible races */) )
+           )) {
+            LogPrint(BCLog::NET, "Ignore block request below NODE_NETWORK_LIMITED threshold, disconnect peer=%d\n", pfrom.GetId());
+            //disconnect node and prevent it from stalling (would otherwise wait for the missing block)
+            pfrom.fDisconnect = true;
+            return;
+        }
+        // Pruned nodes may have deleted the block, so check whether
+        // it's available before trying to send.
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
+            return;
+        }
+        tip = m_chainman.ActiveChain().Tip();
+        can_direct_fetch = CanDirectFetch();
+        block_pos = pindex->GetBlockPos();
     }
+    // The block is read and serialized without cs_main, only the immutable
+    // parts of the index entry and the copies above are used from here on.
+
     const CNetMsgMaker msgMaker(pfrom.GetCommonVersion());
-    // disconnect node in case we have reached the outbound limit for serving historical blocks
-    if (m_connman.OutboundTargetReached(true) &&
-        (((m_chainman.m_best_header != nullptr) && (m_chainman.m_best_header->GetBlockTime() - pindex->GetBlockTime() > HISTORICAL_BLOCK_AGE)) || inv.IsMsgFilteredBlk()) &&
-        !pfrom.HasPermission(NetPermissionFlags::Download) // nodes with the download permission may exceed target
-    ) {
-        LogPrint(BCLog::NET, "historical block serving limit reached, disconnect peer=%d\n", pfrom.GetId());
-        pfrom.fDisconnect = true;
-        return;
-    }
-    // Avoid leaking prune-height by never sending blocks below the NODE_NETWORK_LIMITED threshold
-    if (!pfrom.HasPermission(NetPermissionFlags::NoBan) && (
-            (((peer.m_our_services & NODE_NETWORK_LIMITED) == NODE_NETWORK_LIMITED) && ((peer.m_our_services & NODE_NETWORK) != NODE_NETWORK) && (m_chainman.ActiveChain().Tip()->nHeight - pindex->nHeight > (int)NODE_NETWORK_LIMITED_MIN_BLOCKS + 2 /* add two blocks buffer extension for possible races */) )
-       )) {
-        LogPrint(BCLog::NET, "Ignore block request below NODE_NETWORK_LIMITED threshold, disconnect peer=%d\n", pfrom.GetId());
-        //disconnect node and prevent it from stalling (would otherwise wait for the missing block)
-        pfrom.fDisconnect = true;
-        return;
-    }
-    // Pruned nodes may have deleted the block, so check whether
-    // it's available before trying to send.
-    if (!(pindex->nStatus & BLOCK_HAVE_DATA)) {
-        return;
-    }
     std::shared_ptr<const CBlock> pblock;
     if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
         pblock = a_recent_block;
-    } else if (inv.IsMsgWitnessBlk()) {
-        // Fast-path: in this case it is possible to serve the block directly from disk,
-        // as the network format matches the format on disk
-        std::vector<uint8_t> block_data;
-        if (!m_chainman.m_blockman.ReadRawBlockFromDisk(block_data, pindex->GetBlockPos())) {
-            assert(!"cannot load block from disk");
-        }
-        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, Span{block_data}));
-        // Don't set pblock as we've sent the block
+    }
+    if (inv.IsMsgBlk() || inv.IsMsgWitnessBlk()) {
+        const bool witness{inv.IsMsgWitnessBlk()};
+        CSerializedNetMsg msg;
+        if (auto payload{m_block_serve_cache.Get(pindex->GetBlockHash(), witness)}) {
+            msg.m_type = NetMsgType::BLOCK;
+            msg.m_shared = std::move(payload);
+        } else if (pblock) {
+            msg = witness ? msgMaker.Make(NetMsgType::BLOCK, *pblock) :
+                            msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock);
+        } else if (witness) {
+            // Fast-path: in this case it is possible to serve the block directly from disk,
+            // as the network format matches the format on disk. Prefer copying it straight
+            // out of the mapped block file.
+            if (node::MappedBlock mapped; m_chainman.m_blockman.ReadRawBlockFromDisk(mapped, block_pos)) {
+                msg = msgMaker.Make(NetMsgType::BLOCK, mapped.data);
+            } else {
+                std::vector<uint8_t> block_data;
+                if (!m_chainman.m_blockman.ReadRawBlockFromDisk(block_data, block_pos)) {
+                    LogPrint(BCLog::NET, "Cannot load block from disk, disconnect peer=%d\n", pfrom.GetId());
+                    pfrom.fDisconnect = true;
+                    return;
+                }
+                msg = msgMaker.Make(NetMsgType::BLOCK, Span{block_data});
+            }
+        } else {
+            CBlock block;
+            if (!m_chainman.m_blockman.ReadBlockFromDisk(block, block_pos)) {
+                LogPrint(BCLog::NET, "Cannot load block from disk, disconnect peer=%d\n", pfrom.GetId());
+                pfrom.fDisconnect = true;
+                return;
+            }
+            msg = msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, block);
+        }
+        if (!msg.m_shared && m_block_serve_cache.Enabled()) {
+            // Keep the serialization (and its checksum) for the next peer asking for this block.
+            msg.Share();
+            m_block_serve_cache.Insert(pindex->GetBlockHash(), witness, msg.m_shared);
+        }
+        m_connman.PushMessage(&pfrom, std::move(msg));
     } else {
-        // Send block from disk
-        std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
-        if (!m_chainman.m_blockman.ReadBlockFromDisk(*pblockRead, *pindex)) {
-            assert(!"cannot load block from disk");
-        }
-        pblock = pblockRead;
-    }
-    if (pblock) {
-        if (inv.IsMsgBlk()) {
-            m_connman.PushMessage(&pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
-        } else if (inv.IsMsgWitnessBlk()) {
-            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
-        } else if (inv.IsMsgFilteredBlk()) {
+        if (!pblock) {
+            // Send block from disk
+            std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+            if (!m_chainman.m_blockman.ReadBlockFromDisk(*pblockRead, block_pos)) {
+                LogPrint(BCLog::NET, "Cannot load block from disk, disconnect peer=%d\n", pfrom.GetId());
+                pfrom.fDisconnect = true;
+                return;
+            }
+            pblock = pblockRead;
+        }
+        if (inv.IsMsgFilteredBlk()) {
             bool sendMerkleBlock = false;
             CMerkleBlock merkleBlock;
             if (auto tx_relay = peer.GetTxRelay(); tx_relay != nullptr) {
@@ -2338,7 +2559,7 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
             // they won't have a useful mempool to match against a compact block,
             // and we don't feel like constructing the object for them, so
             // instead we respond with the full, non-compact block.
-            if (CanDirectFetch() && pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_CMPCTBLOCK_DEPTH) {
+            if (can_direct_fetch && pindex->nHeight >= tip->nHeight - MAX_CMPCTBLOCK_DEPTH) {
                 if (a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
                     m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
                 } else {
@@ -2359,7 +2580,7 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
             // and we want it right after the last block so they don't
             // wait for other stuff first.
             std::vector<CInv> vInv;
-            vInv.emplace_back(MSG_BLOCK, m_chainman.ActiveChain().Tip()->GetBlockHash());
+            vInv.emplace_back(MSG_BLOCK, tip->GetBlockHash());
             m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::INV, vInv));
             peer.m_continuation_block.SetNull();
         }
@@ -2386,10 +2607,43 @@ CTransactionRef PeerManagerImpl::FindTxForGetData(const Peer::TxRelay& tx_relay,
     return {};
 }
 
+void PeerManagerImpl::AnnounceReconciledTxs(CNode& pfrom, Peer& peer, const std::vector<uint256>& wtxids)
+{
+    auto tx_relay = peer.GetTxRelay();
+    if (tx_relay == nullptr) return;
+
+    const CFeeRate filterrate{tx_relay->m_fee_filter_received.load()};
+    std::vector<CInv> vInv;
+    {
+        LOCK(tx_relay->m_tx_inventory_mutex);
+        for (const uint256& wtxid : wtxids) {
+            if (tx_relay->m_tx_inventory_known_filter.contains(wtxid)) continue;
+            // Same checks as for transactions announced by INV in SendMessages
+            auto txinfo = m_mempool.info(GenTxid::Wtxid(wtxid));
+            if (!txinfo.tx) continue;
+            if (txinfo.fee < filterrate.GetFee(txinfo.vsize)) continue;
+            tx_relay->m_tx_inventory_known_filter.insert(wtxid);
+            vInv.emplace_back(MSG_WTX, wtxid);
+        }
+    }
+    if (vInv.empty()) return;
+
+    const CNetMsgMaker msgMaker(pfrom.GetCommonVersion());
+    for (size_t i = 0; i < vInv.size(); i += MAX_INV_SZ) {
+        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::INV, std::vector<CInv>(vInv.begin() + i, vInv.begin() + std::min(vInv.size(), i + MAX_INV_SZ))));
+    }
+    // Ensure we'll respond to GETDATA requests for anything we've just announced
+    LOCK(m_mempool.cs);
+    tx_relay->m_last_inv_sequence = m_mempool.GetSequence();
+}
+
 void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic<bool>& interruptMsgProc)
 {
     AssertLockNotHeld(cs_main);
 
+    // Keep responses in order: nothing else is served while a block is.
+    if (peer.m_getdata_block_in_flight) return;
+
     auto tx_relay = peer.GetTxRelay();
 
     std::deque<CInv>::iterator it = peer.m_getdata_requests.begin();
@@ -2425,14 +2679,30 @@ void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic
     }
 
     // Only process one BLOCK item per call, since they're uncommon and can be
-    // expensive to process.
+    // expensive to process. Hand it to a worker thread if there is one, so that
+    // reading (and checking) a block from disk does not hold up other peers.
+    // It then stays at the front of the queue until it has been served.
     if (it != peer.m_getdata_requests.end() && !pfrom.fPauseSend) {
-        const CInv &inv = *it++;
+        const CInv inv = *it;
+        peer.m_getdata_requests.erase(peer.m_getdata_requests.begin(), it);
+        it = peer.m_getdata_requests.begin();
         if (inv.IsGenBlkMsg()) {
-            ProcessGetBlockData(pfrom, peer, inv);
+            peer.m_getdata_block_in_flight = m_connman.PostNodeTask(pfrom, [this, &pfrom, peer = GetPeerRef(peer.m_id), inv] {
+                ProcessGetBlockData(pfrom, *peer, inv);
+                LOCK(peer->m_getdata_requests_mutex);
+                Assume(peer->m_getdata_requests.front().hash == inv.hash);
+                peer->m_getdata_requests.pop_front();
+                peer->m_getdata_block_in_flight = false;
+            });
+            if (!peer.m_getdata_block_in_flight) {
+                ProcessGetBlockData(pfrom, peer, inv);
+                ++it;
+            }
+        } else {
+            // If the first item on the queue is an unknown type, we erase it
+            // and continue processing the queue on the next call.
+            ++it;
         }
-        // else: If the first item on the queue is an unknown type, we erase it
-        // and continue processing the queue on the next call.
     }
 
     peer.m_getdata_requests.erase(peer.m_getdata_requests.begin(), it);
@@ -2559,6 +2829,24 @@ bool PeerManagerImpl::CheckHeadersAreContinuous(const std::vector<CBlockHeader>&
     return true;
 }
 
+bool PeerManagerImpl::CheckHeadersContext(const std::vector<CBlockHeader>& headers, const CBlockIndex& chain_start, BlockValidationState& state)
+{
+    AssertLockHeld(cs_main);
+    // Headers that are not in the block index yet are checked against
+    // temporary entries for the headers before them.
+    std::deque<CBlockIndex> pending;
+    const CBlockIndex* prev{&chain_start};
+    for (const CBlockHeader& header : headers) {
+        if (!ContextualCheckBlockHeader(header, state, m_chainman, prev)) return false;
+        CBlockIndex& index{pending.emplace_back(header)};
+        index.pprev = const_cast<CBlockIndex*>(prev);
+        index.nHeight = prev->nHeight + 1;
+        index.BuildSkip();
+        prev = &index;
+    }
+    return true;
+}
+
 bool PeerManagerImpl::IsContinuationOfLowWorkHeadersSync(Peer& peer, CNode& pfrom, std::vector<CBlockHeader>& headers)
 {
     if (peer.m_headers_sync) {
@@ -2756,7 +3044,7 @@ void PeerManagerImpl::HeadersDirectFetchBlocks(CNode& pfrom, const Peer& peer, c
             std::vector<CInv> vGetData;
             // Download as much as possible, from earliest to latest.
             for (const CBlockIndex *pindex : reverse_iterate(vToFetch)) {
-                if (nodestate->vBlocksInFlight.size() >= MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+                if (nodestate->vBlocksInFlight.size() >= static_cast<size_t>(nodestate->m_max_blocks_in_flight)) {
                     // Can't download any more from this peer
                     break;
                 }
@@ -2966,6 +3254,21 @@ void PeerManagerImpl::ProcessHeadersMessage(CNode& pfrom, Peer& peer,
     // something new (if these headers are valid).
     bool received_new_header{last_received_header == nullptr};
 
+    // Validation checks the proof of work of every header one after another.
+    // Check everything else about new headers first, as that is cheap, and
+    // then compute their proof of work at once.
+    if (received_new_header && headers.size() > 1) {
+        BlockValidationState state;
+        if (!WITH_LOCK(cs_main, return CheckHeadersContext(headers, *chain_start_header, state))) {
+            MaybePunishNodeForBlock(pfrom.GetId(), state, via_compact_block, "invalid header received");
+            return;
+        }
+        if (!CheckProofOfWorkParallel(headers, m_chainparams.GetConsensus())) {
+            Misbehaving(peer, 100, "header with invalid proof of work");
+            return;
+        }
+    }
+
     // Now process all the headers.
     BlockValidationState state;
     if (!m_chainman.ProcessNewBlockHeaders(headers, /*min_pow_checked=*/true, state, &pindexLast)) {
@@ -2996,12 +3299,24 @@ void PeerManagerImpl::ProcessHeadersMessage(CNode& pfrom, Peer& peer,
 bool PeerManagerImpl::ProcessOrphanTx(Peer& peer)
 {
     AssertLockHeld(g_msgproc_mutex);
-    LOCK(cs_main);
 
-    CTransactionRef porphanTx = nullptr;
+    std::vector<PreCheckedTransaction> orphans;
+    for (const CTransactionRef& tx : m_orphanage.GetTxsToReconsider(peer.m_id)) {
+        orphans.emplace_back(tx, GetTime());
+    }
+    if (orphans.empty()) return false;
+    // Orphans that became ready together are usually valid together, so
+    // verify their scripts in one pass over the script check threads.
+    m_chainman.PreCheckTransactions(orphans);
+
+    LOCK(cs_main);
 
-    while (CTransactionRef porphanTx = m_orphanage.GetTxToReconsider(peer.m_id)) {
-        const MempoolAcceptResult result = m_chainman.ProcessTransaction(porphanTx);
+    bool processed{false};
+    for (PreCheckedTransaction& precheck : orphans) {
+        const CTransactionRef porphanTx{precheck.GetTx()};
+        // It may have been erased meanwhile, e.g. as a conflict of an earlier one.
+        if (!m_orphanage.HaveTx(GenTxid::Txid(porphanTx->GetHash()))) continue;
+        const MempoolAcceptResult result = m_chainman.ProcessTransaction(std::move(precheck));
         const TxValidationState& state = result.m_state;
         const uint256& orphanHash = porphanTx->GetHash();
         const uint256& orphan_wtxid = porphanTx->GetWitnessHash();
@@ -3019,7 +3334,7 @@ bool PeerManagerImpl::ProcessOrphanTx(Peer& peer)
             for (const CTransactionRef& removedTx : result.m_replaced_transactions.value()) {
                 AddToCompactExtraTransactions(removedTx);
             }
-            return true;
+            processed = true;
         } else if (state.GetResult() != TxValidationResult::TX_MISSING_INPUTS) {
             if (state.IsInvalid()) {
                 LogPrint(BCLog::TXPACKAGES, "   invalid orphan tx %s (wtxid=%s) from peer=%d. %s\n",
@@ -3068,11 +3383,11 @@ bool PeerManagerImpl::ProcessOrphanTx(Peer& peer)
                 }
             }
             m_orphanage.EraseTx(orphanHash);
-            return true;
+            processed = true;
         }
     }
 
-    return false;
+    return processed;
 }
 
 bool PeerManagerImpl::PrepareBlockFilterRequest(CNode& node, Peer& peer,
@@ -3443,6 +3758,9 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
 
         if (greatest_common_version >= WTXID_RELAY_VERSION) {
             m_connman.PushMessage(&pfrom, msg_maker.Make(NetMsgType::WTXIDRELAY));
+            if (m_opts.package_relay && !m_opts.ignore_incoming_txs) {
+                m_connman.PushMessage(&pfrom, msg_maker.Make(NetMsgType::SENDPACKAGES));
+            }
         }
 
         // Signal ADDRv2 support (BIP155).
@@ -3685,6 +4003,24 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         return;
     }
 
+    // Package relay builds on wtxid relay and is negotiated the same way, between
+    // VERSION and VERACK.
+    if (msg_type == NetMsgType::SENDPACKAGES) {
+        if (pfrom.fSuccessfullyConnected) {
+            LogPrint(BCLog::NET, "sendpackages received after verack from peer=%d; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+        if (!m_opts.package_relay || m_opts.ignore_incoming_txs) {
+            LogPrint(BCLog::NET, "ignoring sendpackages from peer=%d, as package relay is disabled\n", pfrom.GetId());
+        } else if (!peer->m_wtxid_relay) {
+            LogPrint(BCLog::NET, "ignoring sendpackages without wtxidrelay from peer=%d\n", pfrom.GetId());
+        } else {
+            peer->m_package_relay = true;
+        }
+        return;
+    }
+
     // BIP155 defines feature negotiation of addrv2 and sendaddrv2, which must happen
     // between VERSION and VERACK.
     if (msg_type == NetMsgType::SENDADDRV2) {
@@ -3909,6 +4245,8 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 LogPrint(BCLog::NET, "got inv: %s  %s peer=%d\n", inv.ToString(), fAlreadyHave ? "have" : "new", pfrom.GetId());
 
                 AddKnownTx(*peer, inv.hash);
+                // No need to reconcile a transaction the peer already has.
+                if (m_txreconciliation && inv.IsMsgWtx()) m_txreconciliation->TryRemovingFromSet(pfrom.GetId(), inv.hash);
                 if (!fAlreadyHave && !m_chainman.IsInitialBlockDownload()) {
                     AddTxAnnouncement(pfrom, gtxid, current_time);
                 }
@@ -4193,7 +4531,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         const uint256& hash = peer->m_wtxid_relay ? wtxid : txid;
         AddKnownTx(*peer, hash);
 
-        LOCK(cs_main);
+        WAIT_LOCK(cs_main, lock_main);
 
         m_txrequest.ReceivedResponse(pfrom.GetId(), txid);
         if (tx.HasWitness()) m_txrequest.ReceivedResponse(pfrom.GetId(), wtxid);
@@ -4242,7 +4580,17 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             return;
         }
 
-        const MempoolAcceptResult result = m_chainman.ProcessTransaction(ptx);
+        // Verify the scripts without holding cs_main, so that block validation
+        // and other peers are not held up meanwhile. Only transactions that pass
+        // the cheap mempool checks get that far. ProcessTransaction() carries on
+        // from those checks and finds the scripts cached.
+        PreCheckedTransaction precheck{ptx, GetTime()};
+        {
+            REVERSE_LOCK(lock_main);
+            m_chainman.PreCheckTransaction(precheck);
+        }
+
+        const MempoolAcceptResult result = m_chainman.ProcessTransaction(std::move(precheck));
         const TxValidationState& state = result.m_state;
 
         if (result.m_result_type == MempoolAcceptResult::ResultType::VALID) {
@@ -4268,6 +4616,17 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         else if (state.GetResult() == TxValidationResult::TX_MISSING_INPUTS)
         {
             bool fRejectedParents = false; // It may be the case that the orphans parents have all been rejected
+            // Ask a package relay peer for the transaction together with its parents, so that
+            // they are validated as a package. This also covers parents that were rejected
+            // on their own because their feerate is too low.
+            const auto current_time{GetTime<std::chrono::microseconds>()};
+            // Forget the package requests the peer did not answer in time, like
+            // TxRequestTracker does for transaction requests.
+            for (auto it{peer->m_package_requests.begin()}; it != peer->m_package_requests.end();) {
+                it = it->second <= current_time ? peer->m_package_requests.erase(it) : std::next(it);
+            }
+            const bool request_package{peer->m_package_relay &&
+                                       peer->m_package_requests.size() < MAX_PEER_PACKAGE_REQUESTS};
 
             // Deduplicate parent txids, so that we don't have to loop over
             // the same parent txid more than once down below.
@@ -4285,18 +4644,22 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                     break;
                 }
             }
-            if (!fRejectedParents) {
-                const auto current_time{GetTime<std::chrono::microseconds>()};
-
-                for (const uint256& parent_txid : unique_parents) {
-                    // Here, we only have the txid (and not wtxid) of the
-                    // inputs, so we only request in txid mode, even for
-                    // wtxidrelay peers.
-                    // Eventually we should replace this with an improved
-                    // protocol for getting all unconfirmed parents.
-                    const auto gtxid{GenTxid::Txid(parent_txid)};
-                    AddKnownTx(*peer, parent_txid);
-                    if (!AlreadyHaveTx(gtxid)) AddTxAnnouncement(pfrom, gtxid, current_time);
+            if (!fRejectedParents || request_package) {
+                if (!fRejectedParents) {
+                    for (const uint256& parent_txid : unique_parents) {
+                        // Here, we only have the txid (and not wtxid) of the
+                        // inputs, so we only request in txid mode, even for
+                        // wtxidrelay peers. These requests are delayed by
+                        // TXID_RELAY_DELAY, so for package relay peers they are
+                        // only sent if the package does not arrive first.
+                        const auto gtxid{GenTxid::Txid(parent_txid)};
+                        AddKnownTx(*peer, parent_txid);
+                        if (!AlreadyHaveTx(gtxid)) AddTxAnnouncement(pfrom, gtxid, current_time);
+                    }
+                }
+
+                if (request_package && peer->m_package_requests.emplace(wtxid, current_time + GETDATA_TX_INTERVAL).second) {
+                    m_connman.PushMessage(&pfrom, CNetMsgMaker(pfrom.GetCommonVersion()).Make(NetMsgType::GETPKGTXNS, wtxid));
                 }
 
                 if (m_orphanage.AddTx(ptx, pfrom.GetId())) {
@@ -4370,6 +4733,175 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         return;
     }
 
+    if (msg_type == NetMsgType::REQTXRCNCL) {
+        if (!m_txreconciliation) return;
+        uint16_t peer_set_size, peer_q;
+        vRecv >> peer_set_size >> peer_q;
+        const auto sketch{m_txreconciliation->HandleReconciliationRequest(pfrom.GetId(), peer_set_size, peer_q, GetTime<std::chrono::microseconds>())};
+        if (!sketch) {
+            LogPrintLevel(BCLog::NET, BCLog::Level::Debug, "txreconciliation protocol violation from peer=%d (unexpected reqtxrcncl); disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+        m_connman.PushMessage(&pfrom, CNetMsgMaker(pfrom.GetCommonVersion()).Make(NetMsgType::SKETCH, *sketch));
+        return;
+    }
+
+    if (msg_type == NetMsgType::SKETCH) {
+        if (!m_txreconciliation) return;
+        std::vector<uint8_t> sketch;
+        vRecv >> sketch;
+        const auto result{m_txreconciliation->HandleSketch(pfrom.GetId(), sketch, GetTime<std::chrono::microseconds>())};
+        const CNetMsgMaker msgMaker(pfrom.GetCommonVersion());
+        switch (result.action) {
+        case TxReconciliationTracker::SketchResult::Action::PROTOCOL_VIOLATION:
+            LogPrintLevel(BCLog::NET, BCLog::Level::Debug, "txreconciliation protocol violation from peer=%d (unexpected sketch); disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        case TxReconciliationTracker::SketchResult::Action::REQUEST_EXTENSION:
+            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::REQSKETCHEXT));
+            return;
+        case TxReconciliationTracker::SketchResult::Action::FINISH:
+            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::RECONCILDIFF, uint8_t{result.success}, result.ask_short_ids));
+            AnnounceReconciledTxs(pfrom, *peer, result.announce);
+            return;
+        }
+        return;
+    }
+
+    if (msg_type == NetMsgType::REQSKETCHEXT) {
+        if (!m_txreconciliation) return;
+        const auto extension{m_txreconciliation->HandleExtensionRequest(pfrom.GetId())};
+        if (!extension) {
+            LogPrintLevel(BCLog::NET, BCLog::Level::Debug, "txreconciliation protocol violation from peer=%d (unexpected reqsketchext); disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+        m_connman.PushMessage(&pfrom, CNetMsgMaker(pfrom.GetCommonVersion()).Make(NetMsgType::SKETCH, *extension));
+        return;
+    }
+
+    if (msg_type == NetMsgType::RECONCILDIFF) {
+        if (!m_txreconciliation) return;
+        uint8_t success;
+        std::vector<uint32_t> ask_short_ids;
+        vRecv >> success >> ask_short_ids;
+        const auto announce{m_txreconciliation->HandleReconciliationDifference(pfrom.GetId(), success, ask_short_ids)};
+        if (!announce) {
+            LogPrintLevel(BCLog::NET, BCLog::Level::Debug, "txreconciliation protocol violation from peer=%d (unexpected reconcildiff); disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+        AnnounceReconciledTxs(pfrom, *peer, *announce);
+        return;
+    }
+
+    if (msg_type == NetMsgType::GETPKGTXNS) {
+        if (!peer->m_package_relay) {
+            LogPrint(BCLog::NET, "getpkgtxns from peer=%d without package relay; ignoring\n", pfrom.GetId());
+            return;
+        }
+        uint256 wtxid;
+        vRecv >> wtxid;
+
+        auto tx_relay = peer->GetTxRelay();
+        if (tx_relay == nullptr) return;
+
+        // Reply with the transaction and the parents it has in our mempool, sorted
+        // topologically, which is the child-with-parents form AcceptPackage() takes.
+        Package package;
+        if (CTransactionRef tx = FindTxForGetData(*tx_relay, GenTxid::Wtxid(wtxid))) {
+            LOCK(m_mempool.cs);
+            if (const auto it{m_mempool.GetIter(tx->GetHash())}) {
+                std::vector<const CTxMemPoolEntry*> parents;
+                for (const CTxMemPoolEntry& parent : (*it)->GetMemPoolParentsConst()) parents.push_back(&parent);
+                std::sort(parents.begin(), parents.end(), [](const CTxMemPoolEntry* a, const CTxMemPoolEntry* b) {
+                    return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+                });
+                for (const CTxMemPoolEntry* parent : parents) package.push_back(parent->GetSharedTx());
+                if (!package.empty()) package.push_back(tx);
+            }
+        }
+        const CNetMsgMaker msgMaker(pfrom.GetCommonVersion());
+        if (package.empty()) {
+            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::NOTFOUND, std::vector<CInv>{CInv{MSG_WTX, wtxid}}));
+        } else {
+            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::PKGTXNS, package));
+            m_mempool.RemoveUnbroadcastTx(package.back()->GetHash());
+        }
+        return;
+    }
+
+    if (msg_type == NetMsgType::PKGTXNS) {
+        if (RejectIncomingTxs(pfrom)) {
+            LogPrint(BCLog::NET, "pkgtxns sent in violation of protocol peer=%d\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+
+        Package package;
+        vRecv >> package;
+        if (package.size() < 2 || package.size() > MAX_PACKAGE_COUNT) {
+            Misbehaving(*peer, 20, strprintf("pkgtxns message size = %u", package.size()));
+            return;
+        }
+        const uint256& child_wtxid{package.back()->GetWitnessHash()};
+        const auto request_it{peer->m_package_requests.find(child_wtxid)};
+        if (request_it == peer->m_package_requests.end() || request_it->second <= GetTime<std::chrono::microseconds>()) {
+            LogPrint(BCLog::NET, "unrequested pkgtxns for %s from peer=%d; ignoring\n", child_wtxid.ToString(), pfrom.GetId());
+            if (request_it != peer->m_package_requests.end()) peer->m_package_requests.erase(request_it);
+            return;
+        }
+        peer->m_package_requests.erase(request_it);
+        for (const CTransactionRef& tx : package) AddKnownTx(*peer, tx->GetWitnessHash());
+
+        if (m_chainman.IsInitialBlockDownload()) return;
+
+        LOCK(cs_main);
+        const PackageMempoolAcceptResult result{ProcessNewPackage(m_chainman.ActiveChainstate(), m_mempool, package, /*test_accept=*/false)};
+        for (const CTransactionRef& tx : package) {
+            const auto it{result.m_tx_results.find(tx->GetWitnessHash())};
+            if (it == result.m_tx_results.end()) continue;
+            const MempoolAcceptResult& tx_result{it->second};
+            if (tx_result.m_result_type == MempoolAcceptResult::ResultType::VALID) {
+                m_txrequest.ForgetTxHash(tx->GetHash());
+                m_txrequest.ForgetTxHash(tx->GetWitnessHash());
+                RelayTransaction(tx->GetHash(), tx->GetWitnessHash());
+                m_orphanage.AddChildrenToWorkSet(*tx);
+                m_orphanage.EraseTx(tx->GetHash());
+                pfrom.m_last_tx_time = GetTime<std::chrono::seconds>();
+
+                LogPrint(BCLog::MEMPOOL, "AcceptPackage: peer=%d: accepted %s (wtxid=%s) (poolsz %u txn, %u kB)\n",
+                    pfrom.GetId(),
+                    tx->GetHash().ToString(),
+                    tx->GetWitnessHash().ToString(),
+                    m_mempool.size(), m_mempool.DynamicMemoryUsage() / 1000);
+
+                for (const CTransactionRef& removedTx : tx_result.m_replaced_transactions.value()) {
+                    AddToCompactExtraTransactions(removedTx);
+                }
+            } else if (tx_result.m_result_type == MempoolAcceptResult::ResultType::INVALID) {
+                const TxValidationState& state{tx_result.m_state};
+                // Feerate failures may be resolved by a different package, so only
+                // remember transactions that are invalid regardless of their package.
+                if (state.GetResult() != TxValidationResult::TX_MEMPOOL_POLICY &&
+                    state.GetResult() != TxValidationResult::TX_MISSING_INPUTS &&
+                    state.GetResult() != TxValidationResult::TX_WITNESS_STRIPPED) {
+                    m_recent_rejects.insert(tx->GetWitnessHash());
+                    m_txrequest.ForgetTxHash(tx->GetWitnessHash());
+                }
+                MaybePunishNodeForTx(pfrom.GetId(), state);
+            }
+        }
+        if (result.m_state.IsInvalid()) {
+            LogPrint(BCLog::MEMPOOLREJ, "package with child %s from peer=%d was not accepted: %s\n",
+                child_wtxid.ToString(),
+                pfrom.GetId(),
+                result.m_state.ToString());
+        }
+        return;
+    }
+
     if (msg_type == NetMsgType::CMPCTBLOCK)
     {
         // Ignore cmpctblock received while importing
@@ -4382,12 +4914,14 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         vRecv >> cmpctblock;
 
         bool received_new_header = false;
+        bool fast_relay = false;
         const auto blockhash = cmpctblock.header.GetHash();
+        const CBlockIndex* prev_block{nullptr};
 
         {
         LOCK(cs_main);
 
-        const CBlockIndex* prev_block = m_chainman.m_blockman.LookupBlockIndex(cmpctblock.header.hashPrevBlock);
+        prev_block = m_chainman.m_blockman.LookupBlockIndex(cmpctblock.header.hashPrevBlock);
         if (!prev_block) {
             // Doesn't connect (or is genesis), instead of DoSing in AcceptBlockHeader, request deeper headers
             if (!m_chainman.IsInitialBlockDownload()) {
@@ -4402,9 +4936,26 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
 
         if (!m_chainman.m_blockman.LookupBlockIndex(blockhash)) {
             received_new_header = true;
+            fast_relay = CanFastRelayCompactBlock(cmpctblock.header, *prev_block);
         }
         }
 
+        // Forward a new block extending our tip to high-bandwidth peers as soon
+        // as its header is valid. The block itself is validated afterwards.
+        // This is skipped if the relay verifier isn't ready for the header's
+        // RandomX key, as initializing it here would hold up the message.
+        std::vector<NodeId> fast_relayed;
+        if (fast_relay) {
+            const std::optional<bool> pow_valid{CheckProofOfWorkRelay(cmpctblock.header, m_chainparams.GetConsensus())};
+            if (pow_valid == false) {
+                BlockValidationState state;
+                state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "high-hash", "proof of work failed");
+                MaybePunishNodeForBlock(pfrom.GetId(), state, /*via_compact_block=*/true, "invalid header via cmpctblock");
+                return;
+            }
+            if (pow_valid.value_or(false)) fast_relayed = FastRelayCompactBlock(cmpctblock, *prev_block, pfrom.GetId());
+        }
+
         const CBlockIndex *pindex = nullptr;
         BlockValidationState state;
         if (!m_chainman.ProcessNewBlockHeaders({cmpctblock.header}, /*min_pow_checked=*/true, state, &pindex)) {
@@ -4436,6 +4987,11 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         assert(pindex);
         UpdateBlockAvailability(pfrom.GetId(), pindex->GetBlockHash());
 
+        // Don't announce the block again to the peers it was relayed to.
+        for (const NodeId id : fast_relayed) {
+            if (CNodeState* state = State(id)) state->pindexBestHeaderSent = pindex;
+        }
+
         CNodeState *nodestate = State(pfrom.GetId());
 
         // If this was a new header with more work than our tip, update the
@@ -4708,6 +5264,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             // Always process the block if we requested it, since we may
             // need it even when it's not a candidate for a new best tip.
             forceProcessing = IsBlockRequested(hash);
+            BlockReceived(pfrom.GetId(), hash);
             RemoveBlockRequest(hash, pfrom.GetId());
             // mapBlockSource is only used for punishing peers and setting
             // which peers send us compact blocks, so the race between here and
@@ -4973,6 +5530,8 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                     // If we receive a NOTFOUND message for a tx we requested, mark the announcement for it as
                     // completed in TxRequestTracker.
                     m_txrequest.ReceivedResponse(pfrom.GetId(), inv.hash);
+                    // The same goes for a package we asked for with getpkgtxns.
+                    if (inv.IsMsgWtx()) peer->m_package_requests.erase(inv.hash);
                 }
             }
         }
@@ -5048,7 +5607,8 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
     // and prevents m_getdata_requests to grow unbounded
     {
         LOCK(peer->m_getdata_requests_mutex);
-        if (!peer->m_getdata_requests.empty()) return true;
+        // A worker thread serving a block wakes us up when it is done.
+        if (!peer->m_getdata_requests.empty()) return !peer->m_getdata_block_in_flight;
     }
 
     // Don't bother if send buffer is too full to respond anyway
@@ -5851,6 +6411,12 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                             continue;
                         }
                         if (tx_relay->m_bloom_filter && !tx_relay->m_bloom_filter->IsRelevantAndUpdate(*txinfo.tx)) continue;
+                        // Peers we reconcile with learn about most transactions in the next reconciliation
+                        // round instead; only a few of them are flooded each transaction.
+                        if (m_txreconciliation && !m_txreconciliation->ShouldFanoutTo(hash, pto->GetId()) &&
+                            m_txreconciliation->AddToSet(pto->GetId(), hash)) {
+                            continue;
+                        }
                         // Send
                         vInv.push_back(inv);
                         nRelayedTransactions++;
@@ -5869,6 +6435,15 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
         if (!vInv.empty())
             m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
 
+        //
+        // Message: reqtxrcncl
+        //
+        if (m_txreconciliation) {
+            if (const auto request{m_txreconciliation->InitiateReconciliationRequest(pto->GetId(), current_time)}) {
+                m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::REQTXRCNCL, request->first, request->second));
+            }
+        }
+
         // Detect whether we're stalling
         auto stalling_timeout = m_block_stalling_timeout.load();
         if (state.m_stalling_since.count() && state.m_stalling_since < current_time - stalling_timeout) {
@@ -5940,11 +6515,11 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
         // Message: getdata (blocks)
         //
         std::vector<CInv> vGetData;
-        if (CanServeBlocks(*peer) && ((sync_blocks_and_headers_from_peer && !IsLimitedPeer(*peer)) || !m_chainman.IsInitialBlockDownload()) && state.vBlocksInFlight.size() < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        if (CanServeBlocks(*peer) && ((sync_blocks_and_headers_from_peer && !IsLimitedPeer(*peer)) || !m_chainman.IsInitialBlockDownload()) && state.vBlocksInFlight.size() < static_cast<size_t>(state.m_max_blocks_in_flight)) {
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
             auto get_inflight_budget = [&state]() {
-                return std::max(0, MAX_BLOCKS_IN_TRANSIT_PER_PEER - static_cast<int>(state.vBlocksInFlight.size()));
+                return std::max(0, state.m_max_blocks_in_flight - static_cast<int>(state.vBlocksInFlight.size()));
             };
 
             // If a snapshot chainstate is in use, we want to find its next blocks
@@ -5970,6 +6545,18 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                     LogPrint(BCLog::NET, "Stall started peer=%d\n", staller);
                 }
             }
+            if (vToDownload.empty() && staller != -1) {
+                // Until the stalling timeout, ask this peer for the block
+                // holding up the window too, so that a merely slow staller
+                // is not disconnected if this one delivers it first.
+                if (const CBlockIndex* pindex{TakeOverBlockRequest(pto->GetId(), staller, current_time)}) {
+                    vGetData.emplace_back(MSG_BLOCK | GetFetchFlags(*peer), pindex->GetBlockHash());
+                    BlockRequested(pto->GetId(), *pindex);
+                    ++state.m_blocks_taken_over;
+                    LogPrint(BCLog::NET, "Requesting block %s (%d) peer=%d, taking over from stalling peer=%d\n", pindex->GetBlockHash().ToString(),
+                        pindex->nHeight, pto->GetId(), staller);
+                }
+            }
         }
 
         //
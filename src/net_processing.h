@@ -16,11 +16,17 @@ class ChainstateManager;
 
 /** Whether transaction reconciliation protocol should be enabled by default. */
 static constexpr bool DEFAULT_TXRECONCILIATION_ENABLE{false};
+/** Whether transactions are relayed together with their unconfirmed parents by default. */
+static constexpr bool DEFAULT_PACKAGE_RELAY{false};
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const uint32_t DEFAULT_MAX_ORPHAN_TRANSACTIONS{100};
 /** Default number of non-mempool transactions to keep around for block reconstruction. Includes
     orphan, replaced, and rejected transactions. */
 static const uint32_t DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN{100};
+/** Default for -blockservecache, in MiB */
+static constexpr size_t DEFAULT_BLOCK_SERVE_CACHE_MB{32};
+/** Whether compact blocks extending our tip are relayed to high-bandwidth peers before they are validated, by default. */
+static constexpr bool DEFAULT_FAST_CMPCTBLOCK_RELAY{false};
 static const bool DEFAULT_PEERBLOOMFILTERS = false;
 static const bool DEFAULT_PEERBLOCKFILTERS = false;
 /** Threshold for marking a node to be discouraged, e.g. disconnected and added to the discouragement filter. */
@@ -34,6 +40,10 @@ struct CNodeStateStats {
     int m_starting_height = -1;
     std::chrono::microseconds m_ping_wait;
     std::vector<int> vHeightInFlight;
+    int m_max_blocks_in_flight{0};
+    std::chrono::microseconds m_block_latency{0};
+    std::chrono::microseconds m_block_interval{0};
+    uint64_t m_blocks_taken_over{0};
     bool m_relay_txs;
     CAmount m_fee_filter_received;
     uint64_t m_addr_processed = 0;
@@ -51,11 +61,17 @@ public:
         bool ignore_incoming_txs{DEFAULT_BLOCKSONLY};
         //! Whether transaction reconciliation protocol is enabled
         bool reconcile_txs{DEFAULT_TXRECONCILIATION_ENABLE};
+        //! Whether transactions are relayed together with their unconfirmed parents
+        bool package_relay{DEFAULT_PACKAGE_RELAY};
         //! Maximum number of orphan transactions kept in memory
         uint32_t max_orphan_txs{DEFAULT_MAX_ORPHAN_TRANSACTIONS};
         //! Number of non-mempool transactions to keep around for block reconstruction. Includes
         //! orphan, replaced, and rejected transactions.
         uint32_t max_extra_txs{DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN};
+        //! Byte budget of the cache of serialized blocks served to peers
+        size_t block_serve_cache_bytes{DEFAULT_BLOCK_SERVE_CACHE_MB << 20};
+        //! Whether compact blocks are relayed to high-bandwidth peers once their header is valid
+        bool fast_cmpctblock_relay{DEFAULT_FAST_CMPCTBLOCK_RELAY};
         //! Whether all P2P messages are captured to disk
         bool capture_messages{false};
         //! Whether or not the internal RNG behaves deterministically (this is
@@ -0,0 +1,100 @@
+// Copyright (c) 2024 The Bitbi Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include <config/bitbi-config.h>
+#endif
+
+#include <node/blockfilemap.h>
+
+#include <logging.h>
+#include <util/fs.h>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace node {
+
+std::shared_ptr<const MappedFlatFile> MappedFlatFile::Open(const fs::path& path)
+{
+#ifdef WIN32
+    return nullptr;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return nullptr;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed.
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        LogPrint(BCLog::BLOCKSTORAGE, "Failed to map %s: %s\n", fs::PathToString(path), std::strerror(errno));
+        return nullptr;
+    }
+    return std::shared_ptr<const MappedFlatFile>{new MappedFlatFile{static_cast<const std::byte*>(data), size}};
+#endif
+}
+
+MappedFlatFile::~MappedFlatFile()
+{
+#ifndef WIN32
+    if (m_data) ::munmap(const_cast<std::byte*>(m_data), m_size);
+#endif
+}
+
+std::shared_ptr<const MappedFlatFile> FlatFileMapCache::Get(int file, uint64_t min_size)
+{
+    if (m_max_files == 0) return nullptr;
+
+    LOCK(m_mutex);
+    const fs::path path{m_seq.FileName(FlatFilePos{file, 0})};
+    std::error_code ec;
+    const uintmax_t file_size{fs::file_size(path, ec)};
+    if (ec || file_size < min_size) return nullptr;
+
+    auto it = std::find_if(m_maps.begin(), m_maps.end(), [&](const auto& entry) { return entry.first == file; });
+    if (it != m_maps.end()) {
+        // Remap if the file has grown past the mapping, or has been truncated,
+        // e.g. when it was finalized, so that no page past its end stays mapped.
+        if (it->second->Data().size() >= min_size && it->second->Data().size() <= file_size) {
+            m_maps.splice(m_maps.begin(), m_maps, it);
+            return it->second;
+        }
+        m_maps.erase(it);
+    }
+
+    auto mapped = MappedFlatFile::Open(path);
+    if (!mapped || mapped->Data().size() < min_size) return nullptr;
+    m_maps.emplace_front(file, mapped);
+    if (m_maps.size() > m_max_files) m_maps.pop_back();
+    return mapped;
+}
+
+bool FlatFileMapCache::Remove(int file)
+{
+    LOCK(m_mutex);
+    m_maps.remove_if([&](const auto& entry) { return entry.first == file; });
+    std::error_code ec;
+    return fs::remove(m_seq.FileName(FlatFilePos{file, 0}), ec);
+}
+
+void FlatFileMapCache::Clear()
+{
+    LOCK(m_mutex);
+    m_maps.clear();
+}
+} // namespace node
@@ -0,0 +1,93 @@
+// Copyright (c) 2024 The Bitbi Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKFILEMAP_H
+#define BITCOIN_NODE_BLOCKFILEMAP_H
+
+#include <flatfile.h>
+#include <span.h>
+#include <sync.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <utility>
+
+namespace node {
+/**
+ * Number of block files kept mapped by default. Only address space is reserved, but a 32-bit
+ * address space cannot fit many block files, so mapping is disabled there.
+ */
+static constexpr size_t DEFAULT_MAX_MAPPED_BLOCK_FILES{sizeof(void*) >= 8 ? 32 : 0};
+
+/**
+ * A read-only memory mapping of a whole flat file, as it was sized when mapped.
+ * The mapping is released when the last reference to it goes away, so readers
+ * holding a reference are unaffected by eviction or by the file being unlinked.
+ */
+class MappedFlatFile
+{
+private:
+    const std::byte* m_data{nullptr};
+    size_t m_size{0};
+
+    MappedFlatFile(const std::byte* data, size_t size) : m_data{data}, m_size{size} {}
+
+public:
+    /** Map the given file. Returns nullptr if mapping is unsupported or fails. */
+    static std::shared_ptr<const MappedFlatFile> Open(const fs::path& path);
+
+    ~MappedFlatFile();
+    MappedFlatFile(const MappedFlatFile&) = delete;
+    MappedFlatFile& operator=(const MappedFlatFile&) = delete;
+
+    Span<const std::byte> Data() const { return {m_data, m_size}; }
+};
+
+/**
+ * Least-recently-used set of read-only mappings of the files of a FlatFileSeq,
+ * used to serve data that has already been written without going through
+ * stdio. Files that are appended to are remapped when a read goes past the end
+ * of the current mapping.
+ *
+ * Reading a mapping past the end of a file that was truncated behind our back
+ * raises SIGBUS instead of a read error, so every Get() checks the size of the
+ * file on disk first, and the mappings are only used to serve blocks to peers,
+ * never to read blocks for validation.
+ */
+class FlatFileMapCache
+{
+private:
+    const FlatFileSeq m_seq;
+    const size_t m_max_files;
+
+    Mutex m_mutex;
+    /** Most recently used file first. */
+    std::list<std::pair<int, std::shared_ptr<const MappedFlatFile>>> m_maps GUARDED_BY(m_mutex);
+
+public:
+    FlatFileMapCache(FlatFileSeq seq, size_t max_files) : m_seq{std::move(seq)}, m_max_files{max_files} {}
+
+    /**
+     * Return a mapping of file `file` that covers at least its first `min_size`
+     * bytes, or nullptr if mapping is disabled, the file cannot be mapped, or
+     * the file is currently smaller than that.
+     */
+    std::shared_ptr<const MappedFlatFile> Get(int file, uint64_t min_size) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * Drop the mapping of a file and delete the file. Both happen under the
+     * lock, so that a concurrent Get() cannot map the file in between.
+     *
+     * @returns whether the file was deleted
+     */
+    bool Remove(int file) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Drop all mappings. */
+    void Clear() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+} // namespace node
+
+#endif // BITCOIN_NODE_BLOCKFILEMAP_H
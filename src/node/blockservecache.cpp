@@ -0,0 +1,40 @@
+// Copyright (c) 2024 The Bitbi Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockservecache.h>
+
+namespace node {
+
+BlockServeCache::Payload BlockServeCache::Get(const uint256& hash, bool witness)
+{
+    LOCK(m_mutex);
+    auto it = m_index.find(Key{hash, witness});
+    if (it == m_index.end()) return nullptr;
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->second;
+}
+
+void BlockServeCache::Insert(const uint256& hash, bool witness, Payload payload)
+{
+    if (!payload || payload->data.size() > m_max_bytes) return;
+    LOCK(m_mutex);
+    const Key key{hash, witness};
+    if (m_index.count(key)) return;
+    m_bytes += payload->data.size();
+    m_entries.emplace_front(key, std::move(payload));
+    m_index.emplace(key, m_entries.begin());
+    while (m_bytes > m_max_bytes) {
+        const auto& [evict_key, evict_payload] = m_entries.back();
+        m_bytes -= evict_payload->data.size();
+        m_index.erase(evict_key);
+        m_entries.pop_back();
+    }
+}
+
+size_t BlockServeCache::Bytes() const
+{
+    LOCK(m_mutex);
+    return m_bytes;
+}
+} // namespace node
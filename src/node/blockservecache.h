@@ -0,0 +1,58 @@
+// Copyright (c) 2024 The Bitbi Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKSERVECACHE_H
+#define BITCOIN_NODE_BLOCKSERVECACHE_H
+
+#include <net.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+
+namespace node {
+/**
+ * Least-recently-used cache of serialized blocks, as sent in block messages, so
+ * that blocks requested by several peers (e.g. recent blocks fetched in parallel
+ * by peers doing IBD from us) are read and serialized only once. Witness and
+ * non-witness serializations are cached separately. The total payload size is
+ * kept within a byte budget; a budget of 0 disables the cache.
+ */
+class BlockServeCache
+{
+public:
+    using Payload = std::shared_ptr<const CSerializedNetMsg::SharedPayload>;
+
+private:
+    using Key = std::pair<uint256, bool>;
+
+    const size_t m_max_bytes;
+
+    mutable Mutex m_mutex;
+    /** Most recently used block first. */
+    std::list<std::pair<Key, Payload>> m_entries GUARDED_BY(m_mutex);
+    std::map<Key, decltype(m_entries)::iterator> m_index GUARDED_BY(m_mutex);
+    size_t m_bytes GUARDED_BY(m_mutex){0};
+
+public:
+    explicit BlockServeCache(size_t max_bytes) : m_max_bytes{max_bytes} {}
+
+    bool Enabled() const { return m_max_bytes > 0; }
+
+    /** Return the cached serialization of a block, or nullptr. */
+    Payload Get(const uint256& hash, bool witness) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Add the serialization of a block, evicting the least recently used ones beyond the budget. */
+    void Insert(const uint256& hash, bool witness, Payload payload) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Total size of the cached payloads. */
+    size_t Bytes() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+} // namespace node
+
+#endif // BITCOIN_NODE_BLOCKSERVECACHE_H
@@ -7,6 +7,7 @@
 #include <chain.h>
 #include <clientversion.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
 #include <dbwrapper.h>
 #include <flatfile.h>
 #include <hash.h>
@@ -27,6 +28,7 @@
 #include <util/translation.h>
 #include <validation.h>
 
+#include <algorithm>
 #include <map>
 #include <unordered_map>
 #include <future> 
@@ -648,6 +650,9 @@ void BlockManager::CleanupBlockRevFiles() const
 {
     std::map<std::string, fs::path> mapBlockFiles;
 
+    // Block files may be removed and later rewritten under the same name.
+    m_block_file_maps.Clear();
+
     // Glob all blk?????.dat and rev?????.dat files from the blocks directory.
     // Remove the rev files immediately and insert the blk file paths into an
     // ordered map keyed by block file index.
@@ -676,7 +681,7 @@ void BlockManager::CleanupBlockRevFiles() const
             nContigCounter++;
             continue;
         }
-        remove(item.second);
+        m_block_file_maps.Remove(LocaleIndependentAtoi<int>(item.first));
     }
 }
 
@@ -826,7 +831,7 @@ void BlockManager::UnlinkPrunedFiles(const std::set<int>& setFilesToPrune) const
     std::error_code ec;
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
-        const bool removed_blockfile{fs::remove(BlockFileSeq().FileName(pos), ec)};
+        const bool removed_blockfile{m_block_file_maps.Remove(*it)};
         const bool removed_undofile{fs::remove(UndoFileSeq().FileName(pos), ec)};
         if (removed_blockfile || removed_undofile) {
             LogPrint(BCLog::BLOCKSTORAGE, "Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -1089,6 +1094,28 @@ bool BlockManager::ReadBlockFromDisk(CBlock& block, const CBlockIndex& index) co
     return true;
 }
 
+bool BlockManager::ReadRawBlockFromDisk(MappedBlock& block, const FlatFilePos& pos) const
+{
+    if (pos.IsNull() || pos.nPos < BLOCK_SERIALIZATION_HEADER_SIZE) return false;
+
+    auto file{m_block_file_maps.Get(pos.nFile, pos.nPos)};
+    if (!file) return false;
+
+    const auto header{file->Data().subspan(pos.nPos - BLOCK_SERIALIZATION_HEADER_SIZE, BLOCK_SERIALIZATION_HEADER_SIZE)};
+    if (!std::equal(GetParams().MessageStart().begin(), GetParams().MessageStart().end(), UCharCast(header.data()))) {
+        return false;
+    }
+    const uint32_t blk_size{ReadLE32(UCharCast(header.data()) + std::tuple_size_v<MessageStartChars>)};
+    if (blk_size > MAX_SIZE) return false;
+
+    // Check again that the file on disk still covers the whole block.
+    file = m_block_file_maps.Get(pos.nFile, uint64_t{pos.nPos} + blk_size);
+    if (!file) return false;
+    block.data = file->Data().subspan(pos.nPos, blk_size);
+    block.file = std::move(file);
+    return true;
+}
+
 bool BlockManager::ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos) const
 {
     FlatFilePos hpos = pos;
@@ -13,6 +13,8 @@
 #include <kernel/chainparams.h>
 #include <kernel/cs_main.h>
 #include <kernel/messagestartchars.h>
+#include <node/blockfilemap.h>
+#include <span.h>
 #include <sync.h>
 #include <util/fs.h>
 #include <util/hasher.h>
@@ -126,6 +128,12 @@ struct BlockfileCursor {
 std::ostream& operator<<(std::ostream& os, const BlockfileCursor& cursor);
 
 
+/** A serialized block inside a block file mapping, which it keeps alive. */
+struct MappedBlock {
+    std::shared_ptr<const MappedFlatFile> file;
+    Span<const std::byte> data;
+};
+
 /**
  * Maintains a tree of blocks (stored in `m_block_index`) which is consulted
  * to determine where the most-work tip is.
@@ -248,12 +256,16 @@ private:
 
     const kernel::BlockManagerOpts m_opts;
 
+    /** Read-only mappings of recently read block files. */
+    mutable FlatFileMapCache m_block_file_maps;
+
 public:
     using Options = kernel::BlockManagerOpts;
 
     explicit BlockManager(const util::SignalInterrupt& interrupt, Options opts)
         : m_prune_mode{opts.prune_target > 0},
           m_opts{std::move(opts)},
+          m_block_file_maps{BlockFileSeq(), DEFAULT_MAX_MAPPED_BLOCK_FILES},
           m_interrupt{interrupt} {};
 
     const util::SignalInterrupt& m_interrupt;
@@ -364,6 +376,14 @@ public:
     bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos) const;
     bool ReadBlockFromDisk(CBlock& block, const CBlockIndex& index) const;
     bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos) const;
+    /**
+     * Locate a serialized block in a memory-mapped block file, without copying it.
+     * Returns false without logging if the file cannot be mapped or the block
+     * does not check out, in which case callers fall back to the variants above.
+     * Only used to serve blocks to peers: validation reads through stdio, so
+     * that a damaged block file is a read error rather than a SIGBUS.
+     */
+    bool ReadRawBlockFromDisk(MappedBlock& block, const FlatFilePos& pos) const;
 
     bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex& index) const;
 
@@ -25,7 +25,9 @@
 #include <validation.h>
 
 #include <algorithm>
+#include <queue>
 #include <utility>
+#include <vector>
 
 namespace node {
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
@@ -140,7 +142,9 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     int nDescendantsUpdated = 0;
     if (m_mempool) {
         LOCK(m_mempool->cs);
-        addPackageTxs(*m_mempool, nPackagesSelected, nDescendantsUpdated);
+        if (!m_mempool->m_cluster_mempool || !addChunkTxs(*m_mempool, nPackagesSelected)) {
+            addPackageTxs(*m_mempool, nPackagesSelected, nDescendantsUpdated);
+        }
     }
 
     const auto time_1{SteadyClock::now()};
@@ -300,7 +304,8 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
     // Keep track of entries that failed inclusion, to avoid duplicate work
     CTxMemPool::setEntries failedTx;
 
-    CTxMemPool::indexed_transaction_set::index<ancestor_score>::type::iterator mi = mempool.mapTx.get<ancestor_score>().begin();
+    const std::vector<CTxMemPool::txiter> sorted_by_ancestor_score{mempool.GetSortedByAncestorScore()};
+    auto mi = sorted_by_ancestor_score.begin();
     CTxMemPool::txiter iter;
 
     // Limit the number of attempts to add transactions to the block when it is
@@ -309,7 +314,7 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
     const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
     int64_t nConsecutiveFailed = 0;
 
-    while (mi != mempool.mapTx.get<ancestor_score>().end() || !mapModifiedTx.empty()) {
+    while (mi != sorted_by_ancestor_score.end() || !mapModifiedTx.empty()) {
         // First try to find a new transaction in mapTx to evaluate.
         //
         // Skip entries in mapTx that are already in a block or are present
@@ -323,8 +328,8 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
         // cached size/sigops/fee values that are not actually correct.
         /** Return true if given transaction from mapTx has already been evaluated,
          * or if the transaction's cached data in mapTx is incorrect. */
-        if (mi != mempool.mapTx.get<ancestor_score>().end()) {
-            auto it = mempool.mapTx.project<0>(mi);
+        if (mi != sorted_by_ancestor_score.end()) {
+            auto it = *mi;
             assert(it != mempool.mapTx.end());
             if (mapModifiedTx.count(it) || inBlock.count(it) || failedTx.count(it)) {
                 ++mi;
@@ -337,13 +342,13 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
         bool fUsingModified = false;
 
         modtxscoreiter modit = mapModifiedTx.get<ancestor_score>().begin();
-        if (mi == mempool.mapTx.get<ancestor_score>().end()) {
+        if (mi == sorted_by_ancestor_score.end()) {
             // We're out of entries in mapTx; use the entry from mapModifiedTx
             iter = modit->iter;
             fUsingModified = true;
         } else {
             // Try to compare the mapTx entry to the mapModifiedTx entry
-            iter = mempool.mapTx.project<0>(mi);
+            iter = *mi;
             if (modit != mapModifiedTx.get<ancestor_score>().end() &&
                     CompareTxMemPoolEntryByAncestorFee()(*modit, CTxMemPoolModifiedEntry(iter))) {
                 // The best entry in mapModifiedTx has higher score
@@ -428,4 +433,75 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
         nDescendantsUpdated += UpdatePackagesForAdded(mempool, ancestors, mapModifiedTx);
     }
 }
+
+bool BlockAssembler::addChunkTxs(const CTxMemPool& mempool, int& nPackagesSelected)
+{
+    AssertLockHeld(mempool.cs);
+
+    // Collect the linearization of every cluster. These are cached by the mempool
+    // and only recomputed for clusters that changed since the last template.
+    std::vector<const std::vector<CTxMemPool::Chunk>*> clusters;
+    CTxMemPool::setEntries clustered;
+    for (auto it{mempool.mapTx.begin()}; it != mempool.mapTx.end(); ++it) {
+        if (clustered.count(it)) continue;
+        const std::vector<CTxMemPool::Chunk>& chunks{mempool.LinearizeCluster(it)};
+        if (chunks.empty()) return false;
+        for (const auto& chunk : chunks) clustered.insert(chunk.txs.begin(), chunk.txs.end());
+        clusters.push_back(&chunks);
+    }
+
+    // The next chunk of each cluster, ordered by feerate. Later chunks of a cluster
+    // never have a higher feerate than earlier ones.
+    using ChunkRef = std::pair<size_t, size_t>;
+    const auto worse_chunk{[&](const ChunkRef& a, const ChunkRef& b) {
+        const CTxMemPool::Chunk& ca{(*clusters[a.first])[a.second]};
+        const CTxMemPool::Chunk& cb{(*clusters[b.first])[b.second]};
+        return FeeRateHigher(cb.fee, cb.vsize, ca.fee, ca.vsize);
+    }};
+    std::priority_queue<ChunkRef, std::vector<ChunkRef>, decltype(worse_chunk)> queue{worse_chunk};
+    for (size_t i{0}; i < clusters.size(); ++i) queue.emplace(i, 0);
+
+    // Same heuristic as in addPackageTxs().
+    const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
+    int64_t nConsecutiveFailed = 0;
+
+    while (!queue.empty()) {
+        const auto [cluster, index] = queue.top();
+        queue.pop();
+        const CTxMemPool::Chunk& chunk{(*clusters[cluster])[index]};
+
+        if (chunk.fee < m_options.blockMinFeeRate.GetFee(chunk.vsize)) {
+            // Everything else we might consider has a lower fee rate
+            break;
+        }
+
+        int64_t sigops_cost{0};
+        for (const auto& it : chunk.txs) sigops_cost += it->GetSigOpCost();
+        // Later chunks of a cluster may depend on this one, so skip the rest of
+        // the cluster if it does not make it in.
+        if (!TestPackage(chunk.vsize, sigops_cost)) {
+            ++nConsecutiveFailed;
+            if (nConsecutiveFailed > MAX_CONSECUTIVE_FAILURES && nBlockWeight >
+                    m_options.nBlockMaxWeight - 4000) {
+                // Give up if we're close to full and haven't succeeded in a while
+                break;
+            }
+            continue;
+        }
+        if (!TestPackageTransactions(CTxMemPool::setEntries(chunk.txs.begin(), chunk.txs.end()))) {
+            continue;
+        }
+
+        // This chunk will make it in; reset the failed counter.
+        nConsecutiveFailed = 0;
+
+        for (const auto& it : chunk.txs) {
+            AddToBlock(it);
+        }
+        ++nPackagesSelected;
+
+        if (index + 1 < clusters[cluster]->size()) queue.emplace(cluster, index + 1);
+    }
+    return true;
+}
 } // namespace node
@@ -187,6 +187,11 @@ private:
       * statistics from the package selection (for logging statistics). */
     void addPackageTxs(const CTxMemPool& mempool, int& nPackagesSelected, int& nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
 
+    /** Add transactions chunk by chunk from the linearizations of all mempool clusters, picking
+      * the highest feerate chunk whose predecessors are all included. Returns false without adding
+      * anything if a cluster is too large to linearize. */
+    bool addChunkTxs(const CTxMemPool& mempool, int& nPackagesSelected) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+
     // helper functions for addPackageTxs()
     /** Remove confirmed (inBlock) entries from given set */
     void onlyUnconfirmed(CTxMemPool::setEntries& testSet);
@@ -12,6 +12,8 @@ void ApplyArgsManOptions(const ArgsManager& argsman, PeerManager::Options& optio
 {
     if (auto value{argsman.GetBoolArg("-txreconciliation")}) options.reconcile_txs = *value;
 
+    if (auto value{argsman.GetBoolArg("-packagerelay")}) options.package_relay = *value;
+
     if (auto value{argsman.GetIntArg("-maxorphantx")}) {
         options.max_orphan_txs = uint32_t((std::clamp<int64_t>(*value, 0, std::numeric_limits<uint32_t>::max())));
     }
@@ -20,6 +22,12 @@ void ApplyArgsManOptions(const ArgsManager& argsman, PeerManager::Options& optio
         options.max_extra_txs = uint32_t((std::clamp<int64_t>(*value, 0, std::numeric_limits<uint32_t>::max())));
     }
 
+    if (auto value{argsman.GetIntArg("-blockservecache")}) {
+        options.block_serve_cache_bytes = size_t(std::clamp<int64_t>(*value, 0, std::numeric_limits<int32_t>::max() >> 20)) << 20;
+    }
+
+    if (auto value{argsman.GetBoolArg("-fastcmpctrelay")}) options.fast_cmpctblock_relay = *value;
+
     if (auto value{argsman.GetBoolArg("-capturemessages")}) options.capture_messages = *value;
 
     if (auto value{argsman.GetBoolArg("-blocksonly")}) options.ignore_incoming_txs = *value;
@@ -5,9 +5,13 @@
 #include <node/txreconciliation.h>
 
 #include <common/system.h>
+#include <crypto/siphash.h>
 #include <logging.h>
+#include <node/minisketchwrapper.h>
 #include <util/check.h>
 
+#include <algorithm>
+#include <cmath>
 #include <unordered_map>
 #include <variant>
 
@@ -29,6 +33,22 @@ uint256 ComputeSalt(uint64_t salt1, uint64_t salt2)
     return (HashWriter(RECON_SALT_HASHER) << std::min(salt1, salt2) << std::max(salt1, salt2)).GetSHA256();
 }
 
+/** Size of one element of a sketch, see BIP-330. */
+constexpr size_t BYTES_PER_SKETCH_CAPACITY{4};
+
+/** Where a reconciliation round with a peer stands. */
+enum class ReconciliationPhase {
+    NONE,
+    /** Initiator: sent REQTXRCNCL, waiting for the sketch. */
+    INIT_REQUESTED,
+    /** Initiator: sent REQSKETCHEXT, waiting for the extension. */
+    EXT_REQUESTED,
+    /** Responder: sent the sketch, waiting for REQSKETCHEXT or RECONCILDIFF. */
+    INIT_RESPONDED,
+    /** Responder: sent the extension, waiting for RECONCILDIFF. */
+    EXT_RESPONDED,
+};
+
 /**
  * Keeps track of txreconciliation-related per-peer state.
  */
@@ -36,9 +56,6 @@ class TxReconciliationState
 {
 public:
     /**
-     * TODO: This field is public to ignore -Wunused-private-field. Make private once used in
-     * the following commits.
-     *
      * Reconciliation protocol assumes using one role consistently: either a reconciliation
      * initiator (requesting sketches), or responder (sending sketches). This defines our role,
      * based on the direction of the p2p connection.
@@ -47,16 +64,97 @@ public:
     bool m_we_initiate;
 
     /**
-     * TODO: These fields are public to ignore -Wunused-private-field. Make private once used in
-     * the following commits.
-     *
      * These values are used to salt short IDs, which is necessary for transaction reconciliations.
      */
     uint64_t m_k0, m_k1;
 
+    /** Transactions to reconcile in the next round, by short ID. */
+    std::unordered_map<uint32_t, uint256> m_local_set;
+
+    /**
+     * The set being reconciled in the current round. Transactions added meanwhile go to
+     * m_local_set, for the next round.
+     */
+    std::unordered_map<uint32_t, uint256> m_snapshot;
+
+    ReconciliationPhase m_phase{ReconciliationPhase::NONE};
+
+    /** Responder: capacity of the sketch sent in the current round, 0 if it was empty. */
+    size_t m_capacity{0};
+
+    /** Initiator: the sketch received in the current round, to be completed by an extension. */
+    std::vector<uint8_t> m_remote_sketch;
+
+    /**
+     * Initiator: when the current round started, and when to start the next one. The next round
+     * is timed from the end of the previous one, so that the peer never sees two requests less
+     * than RECON_REQUEST_INTERVAL apart.
+     */
+    std::chrono::microseconds m_round_started{0};
+    std::chrono::microseconds m_next_round{0};
+
+    /** Responder: when the peer last requested a sketch. */
+    std::optional<std::chrono::microseconds> m_last_request;
+
     TxReconciliationState(bool we_initiate, uint64_t k0, uint64_t k1) : m_we_initiate(we_initiate), m_k0(k0), m_k1(k1) {}
+
+    /** Short ID of a transaction for sketches, see BIP-330. Never 0, which minisketch cannot hold. */
+    uint32_t ComputeShortID(const uint256& wtxid) const
+    {
+        const uint64_t s = SipHashUint256(m_k0, m_k1, wtxid);
+        return 1 + (s % 0xFFFFFFFF);
+    }
+
+    /** Set the current set aside to reconcile it. */
+    void StartRound()
+    {
+        m_snapshot = std::move(m_local_set);
+        m_local_set.clear();
+        m_cached_capacity = 0;
+    }
+
+    /** End the current round. Transactions of an abandoned round are kept for the next one. */
+    void EndRound(bool abandoned)
+    {
+        if (abandoned) m_local_set.merge(m_snapshot);
+        m_snapshot.clear();
+        m_remote_sketch.clear();
+        m_capacity = 0;
+        m_cached_capacity = 0;
+        m_phase = ReconciliationPhase::NONE;
+    }
+
+    /**
+     * Serialized sketch of the snapshot. A sketch of some capacity is a prefix of any sketch of
+     * the same set with a larger capacity, so the largest one built in this round is kept.
+     */
+    std::vector<uint8_t> SnapshotSketch(size_t capacity)
+    {
+        if (m_cached_capacity < capacity) {
+            Minisketch sketch = node::MakeMinisketch32(capacity);
+            for (const auto& [short_id, _] : m_snapshot) sketch.Add(short_id);
+            m_cached_sketch = sketch.Serialize();
+            m_cached_capacity = capacity;
+        }
+        return {m_cached_sketch.begin(), m_cached_sketch.begin() + capacity * BYTES_PER_SKETCH_CAPACITY};
+    }
+
+private:
+    size_t m_cached_capacity{0};
+    std::vector<uint8_t> m_cached_sketch;
 };
 
+/**
+ * Estimate the capacity needed to reconcile two sets from their sizes, see BIP-330: the
+ * difference is at least the difference of the sizes, plus a share q of the smaller set.
+ */
+size_t EstimateSketchCapacity(size_t local_set_size, size_t remote_set_size, double q)
+{
+    const size_t set_size_diff = std::max(local_set_size, remote_set_size) - std::min(local_set_size, remote_set_size);
+    const size_t min_size = std::min(local_set_size, remote_set_size);
+    return set_size_diff + std::ceil(q * min_size) + 1;
+}
+
 } // namespace
 
 /** Actual implementation for TxReconciliationTracker's data structure. */
@@ -76,6 +174,19 @@ private:
      */
     std::unordered_map<NodeId, std::variant<uint64_t, TxReconciliationState>> m_states GUARDED_BY(m_txreconciliation_mutex);
 
+    /** Number of registered peers we initiate reconciliations with. */
+    size_t m_outbound_registered GUARDED_BY(m_txreconciliation_mutex){0};
+
+    /** Salt to pick the peers each transaction is flooded to. */
+    const uint64_t m_fanout_k0{GetRand<uint64_t>()}, m_fanout_k1{GetRand<uint64_t>()};
+
+    TxReconciliationState* GetRegisteredState(NodeId peer_id) EXCLUSIVE_LOCKS_REQUIRED(m_txreconciliation_mutex)
+    {
+        auto it = m_states.find(peer_id);
+        if (it == m_states.end()) return nullptr;
+        return std::get_if<TxReconciliationState>(&it->second);
+    }
+
 public:
     explicit Impl(uint32_t recon_version) : m_recon_version(recon_version) {}
 
@@ -122,6 +233,7 @@ public:
 
         const uint256 full_salt{ComputeSalt(local_salt, remote_salt)};
         recon_state->second = TxReconciliationState(!is_peer_inbound, full_salt.GetUint64(0), full_salt.GetUint64(1));
+        if (!is_peer_inbound) ++m_outbound_registered;
         return ReconciliationRegisterResult::SUCCESS;
     }
 
@@ -129,6 +241,7 @@ public:
     {
         AssertLockNotHeld(m_txreconciliation_mutex);
         LOCK(m_txreconciliation_mutex);
+        if (const auto* state = GetRegisteredState(peer_id); state && state->m_we_initiate) --m_outbound_registered;
         if (m_states.erase(peer_id)) {
             LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Forget txreconciliation state of peer=%d\n", peer_id);
         }
@@ -142,6 +255,191 @@ public:
         return (recon_state != m_states.end() &&
                 std::holds_alternative<TxReconciliationState>(recon_state->second));
     }
+
+    bool ShouldFanoutTo(const uint256& wtxid, NodeId peer_id) const EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        auto it = m_states.find(peer_id);
+        if (it == m_states.end()) return true;
+        const auto* state = std::get_if<TxReconciliationState>(&it->second);
+        if (!state) return true;
+
+        // Pick the peers independently of each other, but the same ones every time we are asked.
+        const uint64_t h = CSipHasher(m_fanout_k0, m_fanout_k1).Write(wtxid).Write(peer_id).Finalize();
+        if (state->m_we_initiate) return h % m_outbound_registered < OUTBOUND_FANOUT_DESTINATIONS;
+        return h % 100 < INBOUND_FANOUT_DESTINATIONS_PERCENT;
+    }
+
+    bool AddToSet(NodeId peer_id, const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        auto* state = GetRegisteredState(peer_id);
+        if (!state || state->m_local_set.size() >= MAX_RECONSET_SIZE) return false;
+
+        // A transaction whose short ID collides with another one's is flooded instead.
+        const auto [it, inserted] = state->m_local_set.emplace(state->ComputeShortID(wtxid), wtxid);
+        return inserted || it->second == wtxid;
+    }
+
+    void TryRemovingFromSet(NodeId peer_id, const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        auto* state = GetRegisteredState(peer_id);
+        if (!state) return;
+        auto it = state->m_local_set.find(state->ComputeShortID(wtxid));
+        if (it != state->m_local_set.end() && it->second == wtxid) state->m_local_set.erase(it);
+    }
+
+    std::optional<std::pair<uint16_t, uint16_t>> InitiateReconciliationRequest(NodeId peer_id, std::chrono::microseconds now) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        auto* state = GetRegisteredState(peer_id);
+        if (!state || !state->m_we_initiate) return std::nullopt;
+
+        if (state->m_phase != ReconciliationPhase::NONE) {
+            if (now < state->m_round_started + RECON_RESPONSE_TIMEOUT) return std::nullopt;
+            LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Reconciliation with peer=%d timed out\n", peer_id);
+            state->EndRound(/*abandoned=*/true);
+        }
+        if (now < state->m_next_round) return std::nullopt;
+
+        state->StartRound();
+        state->m_phase = ReconciliationPhase::INIT_REQUESTED;
+        state->m_round_started = now;
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Initiate reconciliation with peer=%d, set size=%d\n",
+                      peer_id, state->m_snapshot.size());
+        return std::make_pair(static_cast<uint16_t>(std::min<size_t>(state->m_snapshot.size(), UINT16_MAX)),
+                              static_cast<uint16_t>(RECON_Q * Q_PRECISION));
+    }
+
+    std::optional<std::vector<uint8_t>> HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q, std::chrono::microseconds now) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        auto* state = GetRegisteredState(peer_id);
+        if (!state || state->m_we_initiate) return std::nullopt;
+
+        // Building a sketch costs up to MAX_RECONSET_SIZE * MAX_SKETCH_CAPACITY field operations,
+        // so a peer may not ask for one too often.
+        if (state->m_last_request && now < *state->m_last_request + RECON_REQUEST_INTERVAL) return std::nullopt;
+        state->m_last_request = now;
+        if (state->m_phase != ReconciliationPhase::NONE) {
+            // The peer gave up on the previous round (see RECON_RESPONSE_TIMEOUT), so its
+            // transactions are reconciled again in this one.
+            LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Reconciliation with peer=%d restarted\n", peer_id);
+            state->EndRound(/*abandoned=*/true);
+        }
+
+        state->StartRound();
+        state->m_phase = ReconciliationPhase::INIT_RESPONDED;
+        const size_t capacity{EstimateSketchCapacity(state->m_snapshot.size(), peer_set_size, double(peer_q) / Q_PRECISION)};
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Reconciliation requested by peer=%d, set sizes=%d/%d, capacity=%d\n",
+                      peer_id, state->m_snapshot.size(), peer_set_size, capacity);
+        // An empty sketch tells the peer to fall back to flooding.
+        if (capacity > MAX_SKETCH_CAPACITY) return std::vector<uint8_t>{};
+        state->m_capacity = capacity;
+        return state->SnapshotSketch(capacity);
+    }
+
+    SketchResult HandleSketch(NodeId peer_id, Span<const uint8_t> sketch, std::chrono::microseconds now) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        SketchResult result;
+        auto* state = GetRegisteredState(peer_id);
+        if (!state || !state->m_we_initiate) return result;
+
+        if (state->m_phase == ReconciliationPhase::INIT_REQUESTED) {
+            if (sketch.size() % BYTES_PER_SKETCH_CAPACITY != 0 || sketch.size() > MAX_SKETCH_CAPACITY * BYTES_PER_SKETCH_CAPACITY) return result;
+        } else if (state->m_phase == ReconciliationPhase::EXT_REQUESTED) {
+            // The extension holds as many elements as the sketch it extends.
+            if (sketch.size() != state->m_remote_sketch.size()) return result;
+        } else {
+            return result;
+        }
+        state->m_remote_sketch.insert(state->m_remote_sketch.end(), sketch.begin(), sketch.end());
+        const size_t capacity{state->m_remote_sketch.size() / BYTES_PER_SKETCH_CAPACITY};
+
+        std::optional<std::vector<uint64_t>> difference;
+        if (capacity > 0) {
+            Minisketch remote_sketch = node::MakeMinisketch32(capacity);
+            remote_sketch.Deserialize(state->m_remote_sketch);
+            Minisketch local_sketch = node::MakeMinisketch32(capacity);
+            local_sketch.Deserialize(state->SnapshotSketch(capacity));
+            difference = remote_sketch.Merge(local_sketch).Decode(capacity);
+        }
+
+        if (!difference && capacity > 0 && state->m_phase == ReconciliationPhase::INIT_REQUESTED &&
+            capacity * 2 <= MAX_SKETCH_CAPACITY) {
+            LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Reconciliation with peer=%d needs a sketch extension\n", peer_id);
+            state->m_phase = ReconciliationPhase::EXT_REQUESTED;
+            result.action = SketchResult::Action::REQUEST_EXTENSION;
+            return result;
+        }
+
+        result.action = SketchResult::Action::FINISH;
+        result.success = difference.has_value();
+        if (difference) {
+            for (const uint64_t short_id : *difference) {
+                const auto it = state->m_snapshot.find(short_id);
+                if (it != state->m_snapshot.end()) {
+                    result.announce.push_back(it->second);
+                } else {
+                    result.ask_short_ids.push_back(short_id);
+                }
+            }
+        } else {
+            for (const auto& [_, wtxid] : state->m_snapshot) result.announce.push_back(wtxid);
+        }
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Reconciliation with peer=%d %s, announcing %d, asking for %d\n",
+                      peer_id, result.success ? "succeeded" : "failed", result.announce.size(), result.ask_short_ids.size());
+        state->EndRound(/*abandoned=*/false);
+        state->m_next_round = now + RECON_REQUEST_INTERVAL;
+        return result;
+    }
+
+    std::optional<std::vector<uint8_t>> HandleExtensionRequest(NodeId peer_id) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        auto* state = GetRegisteredState(peer_id);
+        if (!state || state->m_we_initiate || state->m_phase != ReconciliationPhase::INIT_RESPONDED ||
+            state->m_capacity == 0 || state->m_capacity * 2 > MAX_SKETCH_CAPACITY) {
+            return std::nullopt;
+        }
+
+        state->m_phase = ReconciliationPhase::EXT_RESPONDED;
+        std::vector<uint8_t> sketch{state->SnapshotSketch(state->m_capacity * 2)};
+        sketch.erase(sketch.begin(), sketch.begin() + state->m_capacity * BYTES_PER_SKETCH_CAPACITY);
+        return sketch;
+    }
+
+    std::optional<std::vector<uint256>> HandleReconciliationDifference(NodeId peer_id, bool success, const std::vector<uint32_t>& ask_short_ids) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        auto* state = GetRegisteredState(peer_id);
+        if (!state || state->m_we_initiate ||
+            (state->m_phase != ReconciliationPhase::INIT_RESPONDED && state->m_phase != ReconciliationPhase::EXT_RESPONDED)) {
+            return std::nullopt;
+        }
+
+        std::vector<uint256> announce;
+        if (success) {
+            for (const uint32_t short_id : ask_short_ids) {
+                const auto it = state->m_snapshot.find(short_id);
+                if (it != state->m_snapshot.end()) announce.push_back(it->second);
+            }
+        } else {
+            for (const auto& [_, wtxid] : state->m_snapshot) announce.push_back(wtxid);
+        }
+        state->EndRound(/*abandoned=*/false);
+        return announce;
+    }
 };
 
 TxReconciliationTracker::TxReconciliationTracker(uint32_t recon_version) : m_impl{std::make_unique<TxReconciliationTracker::Impl>(recon_version)} {}
@@ -168,3 +466,43 @@ bool TxReconciliationTracker::IsPeerRegistered(NodeId peer_id) const
 {
     return m_impl->IsPeerRegistered(peer_id);
 }
+
+bool TxReconciliationTracker::ShouldFanoutTo(const uint256& wtxid, NodeId peer_id) const
+{
+    return m_impl->ShouldFanoutTo(wtxid, peer_id);
+}
+
+bool TxReconciliationTracker::AddToSet(NodeId peer_id, const uint256& wtxid)
+{
+    return m_impl->AddToSet(peer_id, wtxid);
+}
+
+void TxReconciliationTracker::TryRemovingFromSet(NodeId peer_id, const uint256& wtxid)
+{
+    m_impl->TryRemovingFromSet(peer_id, wtxid);
+}
+
+std::optional<std::pair<uint16_t, uint16_t>> TxReconciliationTracker::InitiateReconciliationRequest(NodeId peer_id, std::chrono::microseconds now)
+{
+    return m_impl->InitiateReconciliationRequest(peer_id, now);
+}
+
+std::optional<std::vector<uint8_t>> TxReconciliationTracker::HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q, std::chrono::microseconds now)
+{
+    return m_impl->HandleReconciliationRequest(peer_id, peer_set_size, peer_q, now);
+}
+
+TxReconciliationTracker::SketchResult TxReconciliationTracker::HandleSketch(NodeId peer_id, Span<const uint8_t> sketch, std::chrono::microseconds now)
+{
+    return m_impl->HandleSketch(peer_id, sketch, now);
+}
+
+std::optional<std::vector<uint8_t>> TxReconciliationTracker::HandleExtensionRequest(NodeId peer_id)
+{
+    return m_impl->HandleExtensionRequest(peer_id);
+}
+
+std::optional<std::vector<uint256>> TxReconciliationTracker::HandleReconciliationDifference(NodeId peer_id, bool success, const std::vector<uint32_t>& ask_short_ids)
+{
+    return m_impl->HandleReconciliationDifference(peer_id, success, ask_short_ids);
+}
@@ -6,13 +6,36 @@
 #define BITCOIN_NODE_TXRECONCILIATION_H
 
 #include <net.h>
+#include <span.h>
 #include <sync.h>
+#include <uint256.h>
 
+#include <chrono>
 #include <memory>
+#include <optional>
 #include <tuple>
+#include <vector>
 
 /** Supported transaction reconciliation protocol version */
 static constexpr uint32_t TXRECONCILIATION_VERSION{1};
+/** How often we ask a peer for a sketch when we are the initiator. */
+static constexpr std::chrono::seconds RECON_REQUEST_INTERVAL{8};
+/** How long we wait for a peer to answer a reconciliation request before starting over. */
+static constexpr std::chrono::seconds RECON_RESPONSE_TIMEOUT{60};
+/**
+ * Coefficient used to estimate the set difference from the set sizes, see BIP-330,
+ * and the precision with which it is sent.
+ */
+static constexpr double RECON_Q{0.25};
+static constexpr uint16_t Q_PRECISION{(2 << 14) - 1};
+/** Above this size, transactions are flooded instead of added to a reconciliation set. */
+static constexpr size_t MAX_RECONSET_SIZE{3000};
+/** Largest sketch we build. A larger difference is better handled by flooding. */
+static constexpr uint32_t MAX_SKETCH_CAPACITY{2 << 12};
+/** Expected number of outbound reconciling peers we flood each transaction to. */
+static constexpr size_t OUTBOUND_FANOUT_DESTINATIONS{1};
+/** Share of inbound reconciling peers we flood each transaction to, in percent. */
+static constexpr size_t INBOUND_FANOUT_DESTINATIONS_PERCENT{10};
 
 enum class ReconciliationRegisterResult {
     NOT_FOUND,
@@ -50,6 +73,26 @@ enum class ReconciliationRegisterResult {
  */
 class TxReconciliationTracker
 {
+public:
+    /** What to do after receiving a sketch as the initiator. */
+    struct SketchResult {
+        enum class Action {
+            /** We did not expect a sketch from this peer. */
+            PROTOCOL_VIOLATION,
+            /** The sketch was too small: ask for an extension with REQSKETCHEXT. */
+            REQUEST_EXTENSION,
+            /** Send RECONCILDIFF and announce our transactions. */
+            FINISH,
+        };
+        Action action{Action::PROTOCOL_VIOLATION};
+        /** With FINISH, whether the set difference was found. */
+        bool success{false};
+        /** With FINISH, short ids of the peer's transactions we are missing. */
+        std::vector<uint32_t> ask_short_ids;
+        /** With FINISH, our transactions to announce: those the peer is missing, or all of them on failure. */
+        std::vector<uint256> announce;
+    };
+
 private:
     class Impl;
     const std::unique_ptr<Impl> m_impl;
@@ -84,6 +127,58 @@ public:
      * Check if a peer is registered to reconcile transactions with us.
      */
     bool IsPeerRegistered(NodeId peer_id) const;
+
+    /**
+     * Whether to announce a transaction to a registered peer right away rather than adding it
+     * to the peer's reconciliation set. A few peers are picked per transaction, so that it still
+     * spreads quickly. Always true for peers that are not registered.
+     */
+    bool ShouldFanoutTo(const uint256& wtxid, NodeId peer_id) const;
+
+    /**
+     * Step 1. Add a transaction to the set to reconcile with the peer. Returns false if the peer is
+     * not registered or its set is full, in which case the transaction should be flooded.
+     */
+    bool AddToSet(NodeId peer_id, const uint256& wtxid);
+
+    /**
+     * Forget a transaction the peer already knows about, e.g. because it announced it to us.
+     */
+    void TryRemovingFromSet(NodeId peer_id, const uint256& wtxid);
+
+    /**
+     * Step 2. If we are the initiator and it is time, start a reconciliation round. Returns the
+     * size of our set and the q coefficient to send with REQTXRCNCL.
+     */
+    std::optional<std::pair<uint16_t, uint16_t>> InitiateReconciliationRequest(NodeId peer_id, std::chrono::microseconds now);
+
+    /**
+     * Step 2. As the responder, answer a REQTXRCNCL with the sketch to send. The sketch is empty
+     * if the difference is expected to be too large to reconcile. A request before the previous
+     * round is finished abandons that round. Returns nothing if the request was not expected:
+     * the peer is not the initiator, or the previous request came less than
+     * RECON_REQUEST_INTERVAL ago.
+     */
+    std::optional<std::vector<uint8_t>> HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q, std::chrono::microseconds now);
+
+    /**
+     * Step 3-4. As the initiator, find the set difference from a sketch, or from the extension
+     * of the sketch received before.
+     */
+    SketchResult HandleSketch(NodeId peer_id, Span<const uint8_t> sketch, std::chrono::microseconds now);
+
+    /**
+     * Step 4b. As the responder, answer a REQSKETCHEXT with the part of a sketch of twice the
+     * capacity that the peer does not have yet. Returns nothing if the request was not expected.
+     */
+    std::optional<std::vector<uint8_t>> HandleExtensionRequest(NodeId peer_id);
+
+    /**
+     * As the responder, finish a round on RECONCILDIFF. Returns the transactions to announce:
+     * those asked for, or the whole set if the reconciliation failed. Returns nothing if the
+     * message was not expected.
+     */
+    std::optional<std::vector<uint256>> HandleReconciliationDifference(NodeId peer_id, bool success, const std::vector<uint32_t>& ask_short_ids);
 };
 
 #endif // BITCOIN_NODE_TXRECONCILIATION_H
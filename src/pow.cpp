@@ -11,7 +11,17 @@
 #include <uint256.h>
 #include "hash.h"
 #include "util/syncstack.h"
+#include "util/threadpool.h"
 #include "common/stopwatch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <optional>
+
 #ifdef __linux__ 
     #include <sys/sysinfo.h>
 #elif _WIN32
@@ -346,6 +356,9 @@ public:
         }
     }
 
+    /** Number of verifier contexts, i.e. of hashes that can be computed at once. */
+    int Size() const { return m_nCaches; }
+
     uint256 PowHash(uint256 key,  unsigned char* input, size_t inputSize)
     {
         VerifierCtx *cache = mCacheStack.pop();
@@ -370,27 +383,192 @@ void bin2hex(char *s, const unsigned char *p, size_t len)
 }
 
 static RxWorkVerifier3 g_RxWorkVerifier{};
-bool CheckProofOfWorkX(const CBlockHeader& block, const Consensus::Params& params) {
+
+/**
+ * A single verifier context for relaying new blocks, allocated on first use and
+ * kept initialized for the key of the current tip. Only warming it up for a new
+ * tip initializes it, hashing never does.
+ */
+class RxRelayVerifier
+{
+private:
+    Mutex m_ctx_mutex;
+    std::unique_ptr<VerifierCtx> m_ctx GUARDED_BY(m_ctx_mutex);
+    uint256 m_key GUARDED_BY(m_ctx_mutex);
+
+public:
+    void WarmUp(const uint256& key) EXCLUSIVE_LOCKS_REQUIRED(!m_ctx_mutex)
+    {
+        LOCK(m_ctx_mutex);
+        if (m_ctx && m_key == key) return;
+        if (!m_ctx) m_ctx = std::make_unique<VerifierCtx>(uint256());
+        m_ctx->reinitialize(key);
+        m_key = key;
+    }
+
+    /** Returns std::nullopt if the context is not initialized for this key. */
+    std::optional<uint256> PowHash(const uint256& key, unsigned char* input, size_t inputSize) EXCLUSIVE_LOCKS_REQUIRED(!m_ctx_mutex)
+    {
+        LOCK(m_ctx_mutex);
+        if (!m_ctx || m_key != key) return std::nullopt;
+        uint8_t result[WIDTH];
+        randomx_calculate_hash(m_ctx->m_vm, input, inputSize, result);
+        return HashBytesToUnit256(result);
+    }
+};
+
+static RxRelayVerifier g_relay_verifier{};
+
+/**
+ * RandomX hashes of headers computed ahead of their validation, when relaying
+ * a new block or checking a batch of headers in parallel, so that validation
+ * does not compute them again. The oldest entries are dropped first.
+ */
+class PowHashCache
+{
+private:
+    /** Enough for two full headers messages. */
+    static constexpr size_t MAX_ENTRIES{4096};
+
+    Mutex m_mutex;
+    std::map<uint256, uint256> m_hashes GUARDED_BY(m_mutex);
+    std::deque<uint256> m_order GUARDED_BY(m_mutex);
+
+public:
+    void Add(const uint256& header_hash, const uint256& pow_hash) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (!m_hashes.emplace(header_hash, pow_hash).second) return;
+        m_order.push_back(header_hash);
+        if (m_order.size() > MAX_ENTRIES) {
+            m_hashes.erase(m_order.front());
+            m_order.pop_front();
+        }
+    }
+
+    std::optional<uint256> Get(const uint256& header_hash) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        const auto it{m_hashes.find(header_hash)};
+        if (it == m_hashes.end()) return std::nullopt;
+        return it->second;
+    }
+};
+
+static PowHashCache g_pow_hashes{};
+
+static uint256 PowKey(const CBlockHeader& block)
+{
     // serialize header without the nonce field
     CHashWriter keyss(PROTOCOL_VERSION);
     //change the key approximately every 345678 seconds(~4days)
     keyss << block.nVersion << block.nTime/345678 << block.nBits << uint32_t(0);
-    uint256 key256 = keyss.GetHash();
+    return keyss.GetHash();
+}
 
-    //double check for sure
-    unsigned char input[80] = {0};
+static void PowInput(const CBlockHeader& block, unsigned char (&input)[80])
+{
     WriteLE32(&input[0], block.nVersion);
     memcpy(&input[4], block.hashPrevBlock.begin(), 32);
     memcpy(&input[36], block.hashMerkleRoot.begin(), 32);
     WriteLE32(&input[68], block.nTime);
     WriteLE32(&input[72], block.nBits);
     WriteLE32(&input[76], block.nNonce);
+}
+
+static uint256 PowHash(const CBlockHeader& block)
+{
+    uint256 key256 = PowKey(block);
+
+    //double check for sure
+    unsigned char input[80] = {0};
+    PowInput(block, input);
 
     // char input_hex[161] = {0};
 	// bin2hex(input_hex, (unsigned char *)input, 80);
     // LogPrintf("CheckProofOfWorkX key=%s, input=%s\n", key256.ToString().c_str(), input_hex);
-    uint256 result = g_RxWorkVerifier.PowHash(key256, input, 80);
-    return CheckProofOfWork(result, block.nBits, params);
+    return g_RxWorkVerifier.PowHash(key256, input, 80);
+}
+
+bool CheckProofOfWorkX(const CBlockHeader& block, const Consensus::Params& params) {
+    const auto cached{g_pow_hashes.Get(block.GetHash())};
+    return CheckProofOfWork(cached ? *cached : PowHash(block), block.nBits, params);
+}
+
+std::optional<bool> CheckProofOfWorkRelay(const CBlockHeader& block, const Consensus::Params& params)
+{
+    const uint256 hash{block.GetHash()};
+    auto result{g_pow_hashes.Get(hash)};
+    if (!result) {
+        unsigned char input[80] = {0};
+        PowInput(block, input);
+        result = g_relay_verifier.PowHash(PowKey(block), input, 80);
+        if (!result) return std::nullopt;
+        // Also when the check fails, so that the header is not hashed again.
+        g_pow_hashes.Add(hash, *result);
+    }
+    return CheckProofOfWork(*result, block.nBits, params);
+}
+
+void WarmUpProofOfWorkRelay(const CBlockHeader& block)
+{
+    g_relay_verifier.WarmUp(PowKey(block));
+}
+
+/** Headers hashed by one worker at a time, so that a failure stops the others soon. */
+static constexpr size_t POW_CHECK_CHUNK_SIZE{16};
+
+/**
+ * Threads that help the caller of CheckProofOfWorkParallel, started on first
+ * use and kept for the lifetime of the process.
+ */
+static ThreadPool& PowCheckPool()
+{
+    static ThreadPool pool{static_cast<size_t>(std::max(g_RxWorkVerifier.Size() - 1, 1))};
+    return pool;
+}
+
+bool CheckProofOfWorkParallel(const std::vector<CBlockHeader>& headers, const Consensus::Params& params)
+{
+    std::atomic<bool> all_valid{true};
+    std::atomic<size_t> next_chunk{0};
+    const auto check_chunks = [&] {
+        size_t begin;
+        while (all_valid && (begin = next_chunk.fetch_add(POW_CHECK_CHUNK_SIZE)) < headers.size()) {
+            const size_t end{std::min(begin + POW_CHECK_CHUNK_SIZE, headers.size())};
+            for (size_t i = begin; i < end; ++i) {
+                const uint256 hash{headers[i].GetHash()};
+                auto result{g_pow_hashes.Get(hash)};
+                if (!result) {
+                    result = PowHash(headers[i]);
+                    g_pow_hashes.Add(hash, *result);
+                }
+                if (!CheckProofOfWork(*result, headers[i].nBits, params)) {
+                    all_valid = false;
+                    return;
+                }
+            }
+        }
+    };
+
+    // Using more threads than verifiers would only wait for a free one.
+    const size_t chunks{(headers.size() + POW_CHECK_CHUNK_SIZE - 1) / POW_CHECK_CHUNK_SIZE};
+    const size_t helpers{std::min<size_t>(chunks, g_RxWorkVerifier.Size()) - (chunks > 0)};
+    Mutex mutex;
+    std::condition_variable cond;
+    size_t running{helpers};
+    for (size_t t = 0; t < helpers; ++t) {
+        PowCheckPool().enqueue([&] {
+            check_chunks();
+            LOCK(mutex);
+            --running;
+            cond.notify_all();
+        });
+    }
+    check_chunks();
+    WAIT_LOCK(mutex, lock);
+    while (running > 0) cond.wait(lock);
+    return all_valid;
 }
 
 std::string doubleSHA256(const std::string& data) {
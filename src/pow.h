@@ -8,6 +8,7 @@
 
 #include <consensus/params.h>
 
+#include <optional>
 #include <stdint.h>
 #include "sync.h"
 #include "crypto/sha256.h"
@@ -47,6 +48,29 @@ void JustCheck();
 
 bool CheckProofOfWorkX(const CBlockHeader& block, const Consensus::Params& params);
 
+/**
+ * Check the proof of work of a header on a verifier reserved for block relay,
+ * which never waits for the verifiers shared with header and block validation.
+ * The RandomX hash is remembered, whether the check passes or not, so
+ * CheckProofOfWorkX does not compute it again for the same header.
+ *
+ * @returns std::nullopt, without hashing, if the relay verifier has not been
+ *          warmed up for the RandomX key of the header.
+ */
+std::optional<bool> CheckProofOfWorkRelay(const CBlockHeader& block, const Consensus::Params& params);
+
+/**
+ * Check the proof of work of many headers at once, in chunks spread over all
+ * shared verifiers, stopping at the first failure. Returns whether all of them
+ * pass. As with CheckProofOfWorkRelay, the RandomX hashes are remembered for
+ * their validation. Only worth calling for headers that passed the other
+ * header checks, as hashing is the expensive part.
+ */
+bool CheckProofOfWorkParallel(const std::vector<CBlockHeader>& headers, const Consensus::Params& params);
+
+/** Initialize the relay verifier for the key of blocks built on top of `block`. */
+void WarmUpProofOfWorkRelay(const CBlockHeader& block);
+
 static inline uint256 HashBytesToUnit256(unsigned char *hashBytes) {
     uint256 hVal;
     memcpy(hVal.begin(), hashBytes, 32);
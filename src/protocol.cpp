@@ -47,6 +47,13 @@ const char* GETCFCHECKPT = "getcfcheckpt";
 const char* CFCHECKPT = "cfcheckpt";
 const char* WTXIDRELAY = "wtxidrelay";
 const char* SENDTXRCNCL = "sendtxrcncl";
+const char* REQTXRCNCL = "reqtxrcncl";
+const char* SKETCH = "sketch";
+const char* REQSKETCHEXT = "reqsketchext";
+const char* RECONCILDIFF = "reconcildiff";
+const char* SENDPACKAGES = "sendpackages";
+const char* GETPKGTXNS = "getpkgtxns";
+const char* PKGTXNS = "pkgtxns";
 } // namespace NetMsgType
 
 /** All known message types. Keep this in the same order as the list of
@@ -88,6 +95,13 @@ const static std::vector<std::string> g_all_net_message_types{
     NetMsgType::CFCHECKPT,
     NetMsgType::WTXIDRELAY,
     NetMsgType::SENDTXRCNCL,
+    NetMsgType::REQTXRCNCL,
+    NetMsgType::SKETCH,
+    NetMsgType::REQSKETCHEXT,
+    NetMsgType::RECONCILDIFF,
+    NetMsgType::SENDPACKAGES,
+    NetMsgType::GETPKGTXNS,
+    NetMsgType::PKGTXNS,
 };
 
 CMessageHeader::CMessageHeader(const MessageStartChars& pchMessageStartIn, const char* pszCommand, unsigned int nMessageSizeIn)
@@ -265,6 +265,43 @@ extern const char* WTXIDRELAY;
  * txreconciliation, as described by BIP 330.
  */
 extern const char* SENDTXRCNCL;
+/**
+ * Contains the size of the sender's reconciliation set and the coefficient q
+ * used to estimate the set difference. Asks the peer for a sketch of its set,
+ * as described by BIP 330.
+ */
+extern const char* REQTXRCNCL;
+/**
+ * Contains a sketch of the sender's reconciliation set, or an extension of a
+ * sketch sent earlier, as described by BIP 330.
+ */
+extern const char* SKETCH;
+/**
+ * Asks for an extension of the sketch just received, after failing to find
+ * the set difference from it, as described by BIP 330.
+ */
+extern const char* REQSKETCHEXT;
+/**
+ * Contains whether a reconciliation succeeded and the short ids of the
+ * transactions the sender is missing, as described by BIP 330.
+ */
+extern const char* RECONCILDIFF;
+/**
+ * Indicates that a node can relay transactions together with their unconfirmed
+ * parents, using getpkgtxns and pkgtxns. Must be sent between VERSION and
+ * VERACK, after WTXIDRELAY.
+ */
+extern const char* SENDPACKAGES;
+/**
+ * Contains the wtxid of a transaction. Asks for it together with all of its
+ * unconfirmed parents, as the sender could not validate it alone.
+ */
+extern const char* GETPKGTXNS;
+/**
+ * Contains the unconfirmed parents of a transaction requested with getpkgtxns,
+ * sorted topologically, followed by the transaction itself.
+ */
+extern const char* PKGTXNS;
 }; // namespace NetMsgType
 
 /* Get a vector of all valid message types (see above) */
@@ -682,7 +682,25 @@ static bool rest_mempool(const std::any& context, HTTPRequest* req, const std::s
             if (verbose && mempool_sequence) {
                 return RESTERR(req, HTTP_BAD_REQUEST, "Verbose results cannot contain mempool sequence values. (hint: set \"verbose=false\")");
             }
-            str_json = MempoolToJSON(*mempool, verbose, mempool_sequence).write() + "\n";
+            std::optional<std::string> raw_since_sequence;
+            try {
+                raw_since_sequence = req->GetQueryParameter("since_sequence");
+            } catch (const std::runtime_error& e) {
+                return RESTERR(req, HTTP_BAD_REQUEST, e.what());
+            }
+            if (raw_since_sequence) {
+                if (verbose || mempool_sequence) {
+                    return RESTERR(req, HTTP_BAD_REQUEST, "The \"since_sequence\" query parameter requires verbose=false and mempool_sequence=false.");
+                }
+                const auto since_sequence{ToIntegral<uint64_t>(*raw_since_sequence)};
+                const auto changes{since_sequence ? MempoolChangesToJSON(*mempool, *since_sequence) : std::nullopt};
+                if (!changes) {
+                    return RESTERR(req, HTTP_BAD_REQUEST, "The \"since_sequence\" query parameter is unknown or too old, fetch the full contents with mempool_sequence=true instead.");
+                }
+                str_json = changes->write() + "\n";
+            } else {
+                str_json = MempoolToJSON(*mempool, verbose, mempool_sequence).write() + "\n";
+            }
         } else {
             str_json = MempoolInfoToJSON(*mempool).write() + "\n";
         }
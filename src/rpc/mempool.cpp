@@ -23,6 +23,7 @@
 #include <util/moneystr.h>
 #include <util/time.h>
 
+#include <optional>
 #include <utility>
 
 using kernel::DumpMempool;
@@ -277,33 +278,98 @@ static std::vector<RPCResult> MempoolEntryDescription()
     };
 }
 
-static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPoolEntry& e) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+namespace {
+/** The fields of a mempool entry reported by entryToJSON(), copied out of the mempool. */
+struct MempoolEntryFields {
+    uint256 txid;
+    uint256 wtxid;
+    int32_t vsize;
+    int32_t weight;
+    std::chrono::seconds time;
+    unsigned int height;
+    uint64_t descendant_count;
+    int64_t descendant_size;
+    uint64_t ancestor_count;
+    int64_t ancestor_size;
+    CAmount fee;
+    CAmount modified_fee;
+    CAmount ancestor_fees;
+    CAmount descendant_fees;
+    std::vector<uint256> depends;
+    std::vector<uint256> spent_by;
+    bool replaceable;
+    bool unbroadcast;
+};
+} // namespace
+
+static MempoolEntryFields GetEntryFields(const CTxMemPool& pool, const CTxMemPoolEntry& e) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
 {
     AssertLockHeld(pool.cs);
 
-    info.pushKV("vsize", (int)e.GetTxSize());
-    info.pushKV("weight", (int)e.GetTxWeight());
-    info.pushKV("time", count_seconds(e.GetTime()));
-    info.pushKV("height", (int)e.GetHeight());
-    info.pushKV("descendantcount", e.GetCountWithDescendants());
-    info.pushKV("descendantsize", e.GetSizeWithDescendants());
-    info.pushKV("ancestorcount", e.GetCountWithAncestors());
-    info.pushKV("ancestorsize", e.GetSizeWithAncestors());
-    info.pushKV("wtxid", pool.vTxHashes[e.vTxHashesIdx].first.ToString());
+    const CTransaction& tx = e.GetTx();
+    MempoolEntryFields fields{
+        .txid = tx.GetHash(),
+        .wtxid = pool.vTxHashes[e.vTxHashesIdx].first,
+        .vsize = e.GetTxSize(),
+        .weight = e.GetTxWeight(),
+        .time = e.GetTime(),
+        .height = e.GetHeight(),
+        .descendant_count = e.GetCountWithDescendants(),
+        .descendant_size = e.GetSizeWithDescendants(),
+        .ancestor_count = e.GetCountWithAncestors(),
+        .ancestor_size = e.GetSizeWithAncestors(),
+        .fee = e.GetFee(),
+        .modified_fee = e.GetModifiedFee(),
+        .ancestor_fees = e.GetModFeesWithAncestors(),
+        .descendant_fees = e.GetModFeesWithDescendants(),
+        .depends = {},
+        .spent_by = {},
+        .replaceable = false,
+        .unbroadcast = pool.IsUnbroadcastTx(tx.GetHash()),
+    };
+
+    for (const CTxIn& txin : tx.vin) {
+        if (pool.exists(GenTxid::Txid(txin.prevout.hash))) fields.depends.push_back(txin.prevout.hash);
+    }
+
+    const CTxMemPool::txiter& it = pool.mapTx.find(tx.GetHash());
+    const CTxMemPoolEntry::Children& children = it->GetMemPoolChildrenConst();
+    for (const CTxMemPoolEntry& child : children) {
+        fields.spent_by.push_back(child.GetTx().GetHash());
+    }
+
+    // Add opt-in RBF status
+    RBFTransactionState rbfState = IsRBFOptIn(tx, pool);
+    if (rbfState == RBFTransactionState::UNKNOWN) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Transaction is not in mempool");
+    } else if (rbfState == RBFTransactionState::REPLACEABLE_BIP125) {
+        fields.replaceable = true;
+    }
+    return fields;
+}
+
+static void entryToJSON(UniValue& info, const MempoolEntryFields& e)
+{
+    info.pushKV("vsize", (int)e.vsize);
+    info.pushKV("weight", (int)e.weight);
+    info.pushKV("time", count_seconds(e.time));
+    info.pushKV("height", (int)e.height);
+    info.pushKV("descendantcount", e.descendant_count);
+    info.pushKV("descendantsize", e.descendant_size);
+    info.pushKV("ancestorcount", e.ancestor_count);
+    info.pushKV("ancestorsize", e.ancestor_size);
+    info.pushKV("wtxid", e.wtxid.ToString());
 
     UniValue fees(UniValue::VOBJ);
-    fees.pushKV("base", ValueFromAmount(e.GetFee()));
-    fees.pushKV("modified", ValueFromAmount(e.GetModifiedFee()));
-    fees.pushKV("ancestor", ValueFromAmount(e.GetModFeesWithAncestors()));
-    fees.pushKV("descendant", ValueFromAmount(e.GetModFeesWithDescendants()));
+    fees.pushKV("base", ValueFromAmount(e.fee));
+    fees.pushKV("modified", ValueFromAmount(e.modified_fee));
+    fees.pushKV("ancestor", ValueFromAmount(e.ancestor_fees));
+    fees.pushKV("descendant", ValueFromAmount(e.descendant_fees));
     info.pushKV("fees", fees);
 
-    const CTransaction& tx = e.GetTx();
     std::set<std::string> setDepends;
-    for (const CTxIn& txin : tx.vin)
-    {
-        if (pool.exists(GenTxid::Txid(txin.prevout.hash)))
-            setDepends.insert(txin.prevout.hash.ToString());
+    for (const uint256& parent : e.depends) {
+        setDepends.insert(parent.ToString());
     }
 
     UniValue depends(UniValue::VARR);
@@ -315,25 +381,18 @@ static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPool
     info.pushKV("depends", depends);
 
     UniValue spent(UniValue::VARR);
-    const CTxMemPool::txiter& it = pool.mapTx.find(tx.GetHash());
-    const CTxMemPoolEntry::Children& children = it->GetMemPoolChildrenConst();
-    for (const CTxMemPoolEntry& child : children) {
-        spent.push_back(child.GetTx().GetHash().ToString());
+    for (const uint256& child : e.spent_by) {
+        spent.push_back(child.ToString());
     }
 
     info.pushKV("spentby", spent);
+    info.pushKV("bip125-replaceable", e.replaceable);
+    info.pushKV("unbroadcast", e.unbroadcast);
+}
 
-    // Add opt-in RBF status
-    bool rbfStatus = false;
-    RBFTransactionState rbfState = IsRBFOptIn(tx, pool);
-    if (rbfState == RBFTransactionState::UNKNOWN) {
-        throw JSONRPCError(RPC_MISC_ERROR, "Transaction is not in mempool");
-    } else if (rbfState == RBFTransactionState::REPLACEABLE_BIP125) {
-        rbfStatus = true;
-    }
-
-    info.pushKV("bip125-replaceable", rbfStatus);
-    info.pushKV("unbroadcast", pool.IsUnbroadcastTx(tx.GetHash()));
+static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPoolEntry& e) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    entryToJSON(info, GetEntryFields(pool, e));
 }
 
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempool_sequence)
@@ -342,15 +401,24 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempoo
         if (include_mempool_sequence) {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Verbose results cannot contain mempool sequence values.");
         }
-        LOCK(pool.cs);
+        // Only copy the entries while holding the lock, rendering them takes
+        // far longer and must not hold up transaction acceptance.
+        std::vector<MempoolEntryFields> entries;
+        {
+            LOCK(pool.cs);
+            entries.reserve(pool.size());
+            for (const CTxMemPoolEntry& e : pool.entryAll()) {
+                entries.push_back(GetEntryFields(pool, e));
+            }
+        }
         UniValue o(UniValue::VOBJ);
-        for (const CTxMemPoolEntry& e : pool.entryAll()) {
+        for (const MempoolEntryFields& e : entries) {
             UniValue info(UniValue::VOBJ);
-            entryToJSON(pool, info, e);
+            entryToJSON(info, e);
             // Mempool has unique entries so there is no advantage in using
             // UniValue::pushKV, which checks if the key already exists in O(N).
             // UniValue::pushKVEnd is used instead which currently is O(1).
-            o.pushKVEnd(e.GetTx().GetHash().ToString(), info);
+            o.pushKVEnd(e.txid.ToString(), info);
         }
         return o;
     } else {
@@ -376,6 +444,23 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempoo
     }
 }
 
+std::optional<UniValue> MempoolChangesToJSON(const CTxMemPool& pool, uint64_t since_sequence)
+{
+    const auto delta{WITH_LOCK(pool.cs, return pool.GetChangesSince(since_sequence))};
+    if (!delta) return std::nullopt;
+
+    UniValue added(UniValue::VARR);
+    for (const uint256& txid : delta->added) added.push_back(txid.ToString());
+    UniValue removed(UniValue::VARR);
+    for (const uint256& txid : delta->removed) removed.push_back(txid.ToString());
+
+    UniValue o(UniValue::VOBJ);
+    o.pushKV("added", added);
+    o.pushKV("removed", removed);
+    o.pushKV("mempool_sequence", delta->sequence);
+    return o;
+}
+
 static RPCHelpMan getrawmempool()
 {
     return RPCHelpMan{"getrawmempool",
@@ -384,6 +469,7 @@ static RPCHelpMan getrawmempool()
         {
             {"verbose", RPCArg::Type::BOOL, RPCArg::Default{false}, "True for a json object, false for array of transaction ids"},
             {"mempool_sequence", RPCArg::Type::BOOL, RPCArg::Default{false}, "If verbose=false, returns a json object with transaction list and mempool sequence number attached."},
+            {"since_sequence", RPCArg::Type::NUM, RPCArg::Optional::OMITTED, "If verbose=false, only return the transactions added and removed since this mempool sequence number, e.g. one returned by an earlier call with mempool_sequence=true."},
         },
         {
             RPCResult{"for verbose = false",
@@ -405,9 +491,23 @@ static RPCHelpMan getrawmempool()
                     }},
                     {RPCResult::Type::NUM, "mempool_sequence", "The mempool sequence value."},
                 }},
+            RPCResult{"for verbose = false and since_sequence set",
+                RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::ARR, "added", "",
+                    {
+                        {RPCResult::Type::STR_HEX, "", "The id of a transaction added since since_sequence that is still in the mempool"},
+                    }},
+                    {RPCResult::Type::ARR, "removed", "",
+                    {
+                        {RPCResult::Type::STR_HEX, "", "The id of a transaction that was in the mempool at since_sequence and has been removed"},
+                    }},
+                    {RPCResult::Type::NUM, "mempool_sequence", "The mempool sequence value, to pass as since_sequence next time."},
+                }},
         },
         RPCExamples{
             HelpExampleCli("getrawmempool", "true")
+            + HelpExampleCli("getrawmempool", "false false 1234")
             + HelpExampleRpc("getrawmempool", "true")
         },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
@@ -421,6 +521,19 @@ static RPCHelpMan getrawmempool()
         include_mempool_sequence = request.params[1].get_bool();
     }
 
+    if (!request.params[2].isNull()) {
+        if (fVerbose || include_mempool_sequence) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "since_sequence cannot be combined with verbose or mempool_sequence.");
+        }
+        const int64_t since_sequence{request.params[2].getInt<int64_t>()};
+        std::optional<UniValue> changes;
+        if (since_sequence >= 0) changes = MempoolChangesToJSON(EnsureAnyMemPool(request.context), since_sequence);
+        if (!changes) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "since_sequence is unknown or too old, fetch the full mempool with mempool_sequence=true instead.");
+        }
+        return *changes;
+    }
+
     return MempoolToJSON(EnsureAnyMemPool(request.context), fVerbose, include_mempool_sequence);
 },
     };
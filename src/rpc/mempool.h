@@ -5,6 +5,9 @@
 #ifndef BITCOIN_RPC_MEMPOOL_H
 #define BITCOIN_RPC_MEMPOOL_H
 
+#include <cstdint>
+#include <optional>
+
 class CTxMemPool;
 class UniValue;
 
@@ -14,4 +17,7 @@ UniValue MempoolInfoToJSON(const CTxMemPool& pool);
 /** Mempool to JSON */
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose = false, bool include_mempool_sequence = false);
 
+/** Transactions added to and removed from the mempool since a sequence number to JSON, std::nullopt if that is unknown or too old */
+std::optional<UniValue> MempoolChangesToJSON(const CTxMemPool& pool, uint64_t since_sequence);
+
 #endif // BITCOIN_RPC_MEMPOOL_H
@@ -147,6 +147,10 @@ static RPCHelpMan getpeerinfo()
                     {
                         {RPCResult::Type::NUM, "n", "The heights of blocks we're currently asking from this peer"},
                     }},
+                    {RPCResult::Type::NUM, "inflight_limit", "How many blocks we ask from this peer at once, sized from its measured download speed"},
+                    {RPCResult::Type::NUM, "block_latency", /*optional=*/true, "The smoothed time in seconds from requesting a block from this peer while nothing else was on its way to receiving it, if measured"},
+                    {RPCResult::Type::NUM, "block_interval", /*optional=*/true, "The smoothed time in seconds between blocks received from this peer back to back, if measured"},
+                    {RPCResult::Type::NUM, "blocks_taken_over", "The number of blocks requested from this peer because a slower peer was holding up the download"},
                     {RPCResult::Type::BOOL, "addr_relay_enabled", "Whether we participate in address relay with this peer"},
                     {RPCResult::Type::NUM, "addr_processed", "The total number of addresses processed, excluding those dropped due to rate limiting"},
                     {RPCResult::Type::NUM, "addr_rate_limited", "The total number of addresses dropped due to rate limiting"},
@@ -253,6 +257,14 @@ static RPCHelpMan getpeerinfo()
             heights.push_back(height);
         }
         obj.pushKV("inflight", heights);
+        obj.pushKV("inflight_limit", statestats.m_max_blocks_in_flight);
+        if (statestats.m_block_latency > 0us) {
+            obj.pushKV("block_latency", Ticks<SecondsDouble>(statestats.m_block_latency));
+        }
+        if (statestats.m_block_interval > 0us) {
+            obj.pushKV("block_interval", Ticks<SecondsDouble>(statestats.m_block_interval));
+        }
+        obj.pushKV("blocks_taken_over", statestats.m_blocks_taken_over);
         obj.pushKV("addr_relay_enabled", statestats.m_addr_relay_enabled);
         obj.pushKV("addr_processed", statestats.m_addr_processed);
         obj.pushKV("addr_rate_limited", statestats.m_addr_rate_limited);
@@ -184,6 +184,59 @@ public:
     }
 };
 
+/** Minimal stream for reading from an existing, XOR-obfuscated byte array.
+ *
+ * Bytes are de-obfuscated as they are copied into the destination, so the
+ * referenced data is never copied into (or modified in) an intermediate buffer.
+ */
+class XorSpanReader
+{
+private:
+    Span<const std::byte> m_data;
+    Span<const std::byte> m_xor;
+    size_t m_xor_pos{0};
+
+public:
+    /**
+     * @param[in]  data Referenced obfuscated bytes
+     * @param[in]  xor_key Key the data was obfuscated with (may be empty)
+     */
+    XorSpanReader(Span<const std::byte> data, Span<const std::byte> xor_key)
+        : m_data{data}, m_xor{xor_key} {}
+
+    template<typename T>
+    XorSpanReader& operator>>(T&& obj)
+    {
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    size_t size() const { return m_data.size(); }
+    bool empty() const { return m_data.empty(); }
+
+    void read(Span<std::byte> dst)
+    {
+        if (dst.size() == 0) {
+            return;
+        }
+        if (dst.size() > m_data.size()) {
+            throw std::ios_base::failure("XorSpanReader::read(): end of data");
+        }
+        memcpy(dst.data(), m_data.data(), dst.size());
+        util::Xor(dst, m_xor, m_xor_pos);
+        ignore(dst.size());
+    }
+
+    void ignore(size_t num_ignore)
+    {
+        if (num_ignore > m_data.size()) {
+            throw std::ios_base::failure("XorSpanReader::ignore(): end of data");
+        }
+        m_data = m_data.subspan(num_ignore);
+        m_xor_pos += num_ignore;
+    }
+};
+
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
@@ -0,0 +1,278 @@
+// Copyright (c) 2024 The Bitbi Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Unit tests for how blocks are requested from peers during initial block download
+
+#include <arith_uint256.h>
+#include <chainparams.h>
+#include <consensus/merkle.h>
+#include <net.h>
+#include <net_processing.h>
+#include <pow.h>
+#include <protocol.h>
+#include <streams.h>
+#include <test/util/logging.h>
+#include <test/util/net.h>
+#include <test/util/script.h>
+#include <test/util/setup_common.h>
+#include <timedata.h>
+#include <util/time.h>
+#include <validation.h>
+#include <versionbits.h>
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std::chrono_literals;
+
+static CService ip(uint32_t i)
+{
+    struct in_addr s;
+    s.s_addr = i;
+    return CService(CNetAddr(s), Params().GetDefaultPort());
+}
+
+/** Mine a chain of empty blocks on top of genesis, the last one a few hours before now. */
+static std::vector<CBlock> MineChain(int length, const Consensus::Params& params)
+{
+    // More than twice the target spacing apart, so that all are at the minimum difficulty.
+    const auto spacing{2 * params.nPowTargetSpacing + 1};
+    int64_t time{GetTime() - 6 * 60 * 60 - length * spacing};
+    std::vector<CBlock> blocks;
+    uint256 prev_hash{Params().GenesisBlock().GetHash()};
+    for (int height = 1; height <= length; ++height) {
+        CMutableTransaction coinbase_tx;
+        coinbase_tx.vin.resize(1);
+        coinbase_tx.vin[0].prevout.SetNull();
+        coinbase_tx.vin[0].scriptSig = CScript() << height << OP_0;
+        coinbase_tx.vout.resize(1);
+        coinbase_tx.vout[0].scriptPubKey = P2WSH_OP_TRUE;
+        coinbase_tx.vout[0].nValue = GetBlockSubsidy(height, params);
+
+        CBlock& block{blocks.emplace_back()};
+        block.vtx = {MakeTransactionRef(std::move(coinbase_tx))};
+        block.nVersion = VERSIONBITS_LAST_OLD_BLOCK_VERSION;
+        block.hashPrevBlock = prev_hash;
+        block.hashMerkleRoot = BlockMerkleRoot(block);
+        block.nTime = time += spacing;
+        block.nBits = UintToArith256(params.powLimit).GetCompact();
+        while (!CheckProofOfWorkX(block, params)) ++block.nNonce;
+        prev_hash = block.GetHash();
+    }
+    return blocks;
+}
+
+struct BlockDownloadSetup : public RegTestingSetup {
+    ConnmanTestMsg& connman{static_cast<ConnmanTestMsg&>(*m_node.connman)};
+    PeerManager& peerman{*m_node.peerman};
+    std::atomic<bool> interrupt{false};
+    NodeId next_id{0};
+
+    std::unique_ptr<CNode> ConnectPeer() EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex)
+    {
+        const NodeId id{next_id++};
+        auto node{std::make_unique<CNode>(id,
+                                          /*sock=*/nullptr,
+                                          CAddress{ip(0xa0b0c001 + id), NODE_NONE},
+                                          /*nKeyedNetGroupIn=*/id,
+                                          /*nLocalHostNonceIn=*/0,
+                                          CAddress(),
+                                          /*addrNameIn=*/"",
+                                          ConnectionType::OUTBOUND_FULL_RELAY,
+                                          /*inbound_onion=*/false)};
+        connman.Handshake(
+            /*node=*/*node,
+            /*successfully_connected=*/true,
+            /*remote_services=*/ServiceFlags(NODE_NETWORK | NODE_WITNESS),
+            /*local_services=*/ServiceFlags(NODE_NETWORK | NODE_WITNESS),
+            /*version=*/PROTOCOL_VERSION,
+            /*relay_txs=*/true);
+        return node;
+    }
+
+    void Receive(CNode& node, const std::string& msg_type, CDataStream&& stream) EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex)
+    {
+        peerman.ProcessMessage(node, msg_type, stream, GetTime<std::chrono::microseconds>(), interrupt);
+        connman.FlushSendBuffer(node);
+    }
+
+    void ReceiveHeaders(CNode& node, const std::vector<CBlock>& blocks) EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex)
+    {
+        std::vector<CBlock> headers;
+        for (const CBlock& block : blocks) headers.emplace_back(block.GetBlockHeader());
+        CDataStream stream{SER_NETWORK, PROTOCOL_VERSION};
+        stream << headers;
+        Receive(node, NetMsgType::HEADERS, std::move(stream));
+    }
+
+    void ReceiveBlock(CNode& node, const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex)
+    {
+        CDataStream stream{SER_NETWORK, PROTOCOL_VERSION};
+        stream << block;
+        Receive(node, NetMsgType::BLOCK, std::move(stream));
+    }
+
+    void SendMessages(CNode& node) EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex)
+    {
+        BOOST_CHECK(peerman.SendMessages(&node));
+        connman.FlushSendBuffer(node);
+    }
+
+    CNodeStateStats Stats(const CNode& node)
+    {
+        CNodeStateStats stats;
+        BOOST_REQUIRE(peerman.GetNodeStateStats(node.GetId(), stats));
+        return stats;
+    }
+
+    /** Let a peer send the blocks in flight from it, the first one latency after the
+     *  request and the others interval apart, and ask it for more. */
+    void DeliverInFlight(CNode& node, const std::vector<CBlock>& blocks, std::chrono::seconds latency, std::chrono::seconds interval)
+        EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex)
+    {
+        SetMockTime(GetTime<std::chrono::seconds>() + latency);
+        for (const int height : Stats(node).vHeightInFlight) {
+            ReceiveBlock(node, blocks.at(height - 1));
+            SetMockTime(GetTime<std::chrono::seconds>() + interval);
+        }
+        SendMessages(node);
+    }
+
+    /**
+     * Connect a staller, which is asked for the first blocks and never sends them,
+     * and a fast peer, which then gets through the rest of the download window and
+     * is asked for the first block too.
+     */
+    void StallWindow(const std::vector<CBlock>& blocks, CNode& staller, CNode& fast)
+        EXCLUSIVE_LOCKS_REQUIRED(NetEventsInterface::g_msgproc_mutex)
+    {
+        // Until its speed is known, a peer gets the default number of blocks in flight.
+        ReceiveHeaders(staller, blocks);
+        SendMessages(staller);
+        CNodeStateStats stats{Stats(staller)};
+        BOOST_CHECK_EQUAL(stats.m_max_blocks_in_flight, 16);
+        BOOST_REQUIRE_EQUAL(stats.vHeightInFlight.size(), 16U);
+        BOOST_CHECK_EQUAL(stats.vHeightInFlight.front(), 1);
+
+        ReceiveHeaders(fast, blocks);
+        SendMessages(fast);
+        stats = Stats(fast);
+        BOOST_REQUIRE_EQUAL(stats.vHeightInFlight.size(), 16U);
+        BOOST_CHECK_EQUAL(stats.vHeightInFlight.front(), 17);
+
+        // The fast peer sends the first block 20s after the request, and the others
+        // back to back, one a second. It can send 20 blocks while a request is on its
+        // way, so twice that many are kept in flight.
+        DeliverInFlight(fast, blocks, 20s, 1s);
+        stats = Stats(fast);
+        BOOST_CHECK(stats.m_block_latency == 20s);
+        BOOST_CHECK(stats.m_block_interval == 1s);
+        BOOST_CHECK_EQUAL(stats.m_max_blocks_in_flight, 40);
+        BOOST_REQUIRE_EQUAL(stats.vHeightInFlight.size(), 40U);
+        BOOST_CHECK_EQUAL(stats.vHeightInFlight.front(), 33);
+
+        do {
+            DeliverInFlight(fast, blocks, 20s, 1s);
+            stats = Stats(fast);
+            BOOST_REQUIRE(!stats.vHeightInFlight.empty());
+        } while (stats.vHeightInFlight.front() != 1);
+        BOOST_CHECK_EQUAL(stats.m_max_blocks_in_flight, 40);
+        BOOST_CHECK(stats.vHeightInFlight == std::vector<int>{1});
+        BOOST_CHECK_EQUAL(stats.m_blocks_taken_over, 1U);
+        BOOST_CHECK_EQUAL(Stats(staller).vHeightInFlight.size(), 16U);
+
+        // The block is not requested from it again.
+        SendMessages(fast);
+        BOOST_CHECK_EQUAL(Stats(fast).m_blocks_taken_over, 1U);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(blockdownload_tests, BlockDownloadSetup)
+
+// A peer that is slow to start sending blocks, compared to how fast it sends
+// them, gets fewer of them in flight, but never fewer than 4.
+BOOST_AUTO_TEST_CASE(inflight_limit_lower_bound)
+{
+    LOCK(NetEventsInterface::g_msgproc_mutex);
+    connman.SetPeerConnectTimeout(99999s);
+    SetMockTime(GetTime());
+
+    const std::vector<CBlock> blocks{MineChain(30, m_node.chainman->GetConsensus())};
+    const auto peer{ConnectPeer()};
+    TestOnlyResetTimeData();
+
+    ReceiveHeaders(*peer, blocks);
+    SendMessages(*peer);
+    BOOST_REQUIRE_EQUAL(Stats(*peer).vHeightInFlight.size(), 16U);
+
+    DeliverInFlight(*peer, blocks, 1s, 10s);
+    const CNodeStateStats stats{Stats(*peer)};
+    BOOST_CHECK(stats.m_block_latency == 1s);
+    BOOST_CHECK(stats.m_block_interval == 10s);
+    BOOST_CHECK_EQUAL(stats.m_max_blocks_in_flight, 4);
+    BOOST_CHECK(stats.vHeightInFlight == std::vector<int>({17, 18, 19, 20}));
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return m_node.chainman->ActiveHeight()), 16);
+
+    peerman.FinalizeNode(*peer);
+}
+
+// A peer that sends blocks quickly takes over the block holding up the download
+// window from a stalling peer. Whichever sends it first ends the stall.
+BOOST_AUTO_TEST_CASE(stall_takeover)
+{
+    LOCK(NetEventsInterface::g_msgproc_mutex);
+    connman.SetPeerConnectTimeout(99999s);
+    SetMockTime(GetTime());
+
+    // A few blocks past the download window, so that the window can be stalled.
+    const std::vector<CBlock> blocks{MineChain(1030, m_node.chainman->GetConsensus())};
+    const auto staller{ConnectPeer()};
+    const auto fast{ConnectPeer()};
+    TestOnlyResetTimeData();
+    StallWindow(blocks, *staller, *fast);
+
+    // Once the fast peer delivers it, the staller is no longer asked for it and
+    // is not disconnected for stalling.
+    ReceiveBlock(*fast, blocks.at(0));
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return m_node.chainman->ActiveHeight()), 1);
+    const CNodeStateStats stats{Stats(*staller)};
+    BOOST_REQUIRE_EQUAL(stats.vHeightInFlight.size(), 15U);
+    BOOST_CHECK_EQUAL(stats.vHeightInFlight.front(), 2);
+    SetMockTime(GetTime<std::chrono::seconds>() + 10s);
+    SendMessages(*staller);
+    BOOST_CHECK(!staller->fDisconnect);
+
+    peerman.FinalizeNode(*staller);
+    peerman.FinalizeNode(*fast);
+}
+
+// A staller is still disconnected at the stalling timeout if the block it holds
+// up the download window with doesn't arrive from anyone.
+BOOST_AUTO_TEST_CASE(stall_takeover_timeout)
+{
+    LOCK(NetEventsInterface::g_msgproc_mutex);
+    connman.SetPeerConnectTimeout(99999s);
+    SetMockTime(GetTime());
+
+    const std::vector<CBlock> blocks{MineChain(1030, m_node.chainman->GetConsensus())};
+    const auto staller{ConnectPeer()};
+    const auto fast{ConnectPeer()};
+    TestOnlyResetTimeData();
+    StallWindow(blocks, *staller, *fast);
+
+    SetMockTime(GetTime<std::chrono::seconds>() + 3s);
+    {
+        ASSERT_DEBUG_LOG("is stalling block download, disconnecting");
+        SendMessages(*staller);
+    }
+    BOOST_CHECK(staller->fDisconnect);
+
+    peerman.FinalizeNode(*staller);
+    peerman.FinalizeNode(*fast);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
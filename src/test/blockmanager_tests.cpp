@@ -4,12 +4,14 @@
 
 #include <chainparams.h>
 #include <clientversion.h>
+#include <node/blockfilemap.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
 #include <node/kernel_notifications.h>
 #include <script/solver.h>
 #include <primitives/block.h>
 #include <util/chaintype.h>
+#include <util/fs_helpers.h>
 #include <validation.h>
 
 #include <boost/test/unit_test.hpp>
@@ -132,6 +134,80 @@ BOOST_FIXTURE_TEST_CASE(blockmanager_block_data_availability, TestChain100Setup)
     BOOST_CHECK(!blockman.CheckBlockDataAvailability(tip, *last_pruned_block));
 }
 
+BOOST_FIXTURE_TEST_CASE(blockmanager_mapped_block_read, TestChain100Setup)
+{
+    const auto& chainman = Assert(m_node.chainman);
+    auto& blockman = chainman->m_blockman;
+
+    const auto check_tip{[&] {
+        const FlatFilePos tip_pos{WITH_LOCK(chainman->GetMutex(), return chainman->ActiveChain().Tip()->GetBlockPos())};
+        CBlock block;
+        BOOST_REQUIRE(blockman.ReadBlockFromDisk(block, tip_pos));
+        CDataStream expected{SER_DISK, CLIENT_VERSION};
+        expected << block;
+
+        std::vector<uint8_t> raw;
+        BOOST_REQUIRE(blockman.ReadRawBlockFromDisk(raw, tip_pos));
+        BOOST_CHECK(Span{raw} == MakeUCharSpan(expected));
+#ifndef WIN32
+        node::MappedBlock mapped;
+        BOOST_REQUIRE(blockman.ReadRawBlockFromDisk(mapped, tip_pos));
+        BOOST_CHECK(mapped.data == Span{expected});
+#endif
+        return tip_pos;
+    }};
+
+    // Blocks appended to a file that is already mapped are still found.
+    const FlatFilePos old_pos{check_tip()};
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    const FlatFilePos new_pos{check_tip()};
+    BOOST_CHECK_EQUAL(old_pos.nFile, new_pos.nFile);
+    BOOST_CHECK_GT(new_pos.nPos, old_pos.nPos);
+
+    // Move on to a new block file, then unlink the old one. Mappings that are
+    // still referenced stay readable, but new reads fail.
+    node::MappedBlock mapped;
+    const bool have_mapping{blockman.ReadRawBlockFromDisk(mapped, new_pos)};
+    const std::vector<std::byte> mapped_copy{mapped.data.begin(), mapped.data.end()};
+    WITH_LOCK(chainman->GetMutex(), blockman.GetBlockFileInfo(new_pos.nFile)->nSize = MAX_BLOCKFILE_SIZE);
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    BOOST_CHECK_NE(check_tip().nFile, new_pos.nFile);
+
+    blockman.UnlinkPrunedFiles({new_pos.nFile});
+    BOOST_CHECK(blockman.OpenBlockFile(new_pos, true).IsNull());
+    if (have_mapping) BOOST_CHECK(mapped.data == Span{mapped_copy});
+    node::MappedBlock unlinked;
+    BOOST_CHECK(!blockman.ReadRawBlockFromDisk(unlinked, new_pos));
+}
+
+#ifndef WIN32
+BOOST_AUTO_TEST_CASE(blockmanager_file_map_cache)
+{
+    FlatFileSeq seq{m_args.GetDataDirBase(), "map", 16 * 1024};
+    node::FlatFileMapCache cache{seq, /*max_files=*/2};
+    {
+        AutoFile file{seq.Open(FlatFilePos{0, 0})};
+        file << std::vector<uint8_t>(100);
+    }
+    if (!cache.Get(0, 50)) return; // Mapping is disabled on this platform
+
+    // A file truncated behind our back is not handed out past its new end.
+    {
+        AutoFile file{seq.Open(FlatFilePos{0, 0})};
+        BOOST_REQUIRE(TruncateFile(file.Get(), 20));
+    }
+    BOOST_CHECK(!cache.Get(0, 50));
+    const auto mapped{cache.Get(0, 10)};
+    BOOST_REQUIRE(mapped);
+    BOOST_CHECK_LE(mapped->Data().size(), 20U);
+
+    // Removing a file drops its mapping and deletes it.
+    BOOST_CHECK(cache.Remove(0));
+    BOOST_CHECK(!fs::exists(seq.FileName(FlatFilePos{0, 0})));
+    BOOST_CHECK(!cache.Get(0, 0));
+}
+#endif
+
 BOOST_AUTO_TEST_CASE(blockmanager_flush_block_file)
 {
     KernelNotifications notifications{m_node.exit_status};
@@ -0,0 +1,72 @@
+// Copyright (c) 2024 The Bitbi Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <net.h>
+#include <node/blockservecache.h>
+#include <test/util/random.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+using node::BlockServeCache;
+
+BOOST_FIXTURE_TEST_SUITE(blockservecache_tests, BasicTestingSetup)
+
+static BlockServeCache::Payload MakePayload(size_t size)
+{
+    CSerializedNetMsg msg;
+    msg.data = g_insecure_rand_ctx.randbytes<unsigned char>(size);
+    msg.Share();
+    return msg.m_shared;
+}
+
+BOOST_AUTO_TEST_CASE(lru_within_budget)
+{
+    BlockServeCache cache{/*max_bytes=*/300};
+    BOOST_CHECK(cache.Enabled());
+    const uint256 a{InsecureRand256()}, b{InsecureRand256()}, c{InsecureRand256()};
+    const auto payload_a{MakePayload(100)};
+
+    // Witness and non-witness serializations are distinct entries.
+    cache.Insert(a, /*witness=*/true, payload_a);
+    BOOST_CHECK(cache.Get(a, /*witness=*/true) == payload_a);
+    BOOST_CHECK(!cache.Get(a, /*witness=*/false));
+    cache.Insert(a, /*witness=*/false, MakePayload(90));
+    BOOST_CHECK(cache.Get(a, /*witness=*/false));
+    BOOST_CHECK_EQUAL(cache.Bytes(), 190U);
+
+    // Inserting again does not replace or double count.
+    cache.Insert(a, /*witness=*/true, MakePayload(100));
+    BOOST_CHECK(cache.Get(a, /*witness=*/true) == payload_a);
+    BOOST_CHECK_EQUAL(cache.Bytes(), 190U);
+
+    // Going over budget evicts the least recently used entry, here a's non-witness one.
+    cache.Insert(b, /*witness=*/true, MakePayload(100));
+    BOOST_CHECK(cache.Get(a, /*witness=*/true));
+    cache.Insert(c, /*witness=*/true, MakePayload(100));
+    BOOST_CHECK(!cache.Get(a, /*witness=*/false));
+    BOOST_CHECK(cache.Get(a, /*witness=*/true));
+    BOOST_CHECK(cache.Get(b, /*witness=*/true));
+    BOOST_CHECK(cache.Get(c, /*witness=*/true));
+    BOOST_CHECK_EQUAL(cache.Bytes(), 300U);
+
+    // A block larger than the whole budget is not cached, and evicts nothing.
+    cache.Insert(InsecureRand256(), /*witness=*/true, MakePayload(301));
+    BOOST_CHECK_EQUAL(cache.Bytes(), 300U);
+}
+
+BOOST_AUTO_TEST_CASE(disabled)
+{
+    BlockServeCache cache{/*max_bytes=*/0};
+    BOOST_CHECK(!cache.Enabled());
+    const uint256 hash{InsecureRand256()};
+    cache.Insert(hash, /*witness=*/true, MakePayload(1));
+    BOOST_CHECK(!cache.Get(hash, /*witness=*/true));
+    BOOST_CHECK_EQUAL(cache.Bytes(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,7 @@
 #include <test/util/index.h>
 #include <test/util/setup_common.h>
 #include <test/util/validation.h>
+#include <txdb.h>
 #include <validation.h>
 
 #include <boost/test/unit_test.hpp>
@@ -118,4 +119,105 @@ BOOST_FIXTURE_TEST_CASE(coinstatsindex_unclean_shutdown, TestChain100Setup)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(coin_stats_accumulator_order, BasicTestingSetup)
+{
+    const uint256 txid_a{uint256::ONE};
+    const uint256 txid_b{uint256S("02")};
+    Coin coin{CTxOut{50, CScript() << OP_TRUE}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false};
+
+    kernel::CCoinsStats stats_in_order, stats_rejected;
+    kernel::CoinStatsAccumulator in_order{kernel::CoinStatsHashType::HASH_SERIALIZED, stats_in_order};
+    BOOST_CHECK(in_order.Add(COutPoint{txid_a, 0}, coin));
+    BOOST_CHECK(in_order.Add(COutPoint{txid_a, 1}, coin));
+    BOOST_CHECK(in_order.Add(COutPoint{txid_b, 0}, coin));
+    in_order.Finalize();
+
+    // Duplicates and txids sorting before the previous one are rejected, and
+    // leave the accumulated set unchanged.
+    kernel::CoinStatsAccumulator rejected{kernel::CoinStatsHashType::HASH_SERIALIZED, stats_rejected};
+    BOOST_CHECK(rejected.Add(COutPoint{txid_a, 0}, coin));
+    BOOST_CHECK(rejected.Add(COutPoint{txid_a, 1}, coin));
+    BOOST_CHECK(!rejected.Add(COutPoint{txid_a, 1}, coin));
+    BOOST_CHECK(!rejected.Add(COutPoint{txid_a, 0}, coin));
+    BOOST_CHECK(rejected.Add(COutPoint{txid_b, 0}, coin));
+    BOOST_CHECK(!rejected.Add(COutPoint{txid_a, 2}, coin));
+    rejected.Finalize();
+
+    BOOST_CHECK_EQUAL(stats_in_order.coins_count, 3U);
+    BOOST_CHECK_EQUAL(stats_in_order.nTransactions, 2U);
+    BOOST_CHECK_EQUAL(stats_rejected.coins_count, 3U);
+    BOOST_CHECK_EQUAL(stats_rejected.nTransactions, 2U);
+    BOOST_CHECK_EQUAL(stats_in_order.hashSerialized, stats_rejected.hashSerialized);
+
+    // The coins database sorts output indexes by their VARINT encoding, so
+    // 16512 (808000) comes before 16511 (FF7F).
+    kernel::CCoinsStats stats_varint;
+    kernel::CoinStatsAccumulator varint{kernel::CoinStatsHashType::MUHASH, stats_varint};
+    BOOST_CHECK(varint.Add(COutPoint{txid_a, 16512}, coin));
+    BOOST_CHECK(varint.Add(COutPoint{txid_a, 16511}, coin));
+    BOOST_CHECK(!varint.Add(COutPoint{txid_a, 16512}, coin));
+    BOOST_CHECK(varint.Add(COutPoint{txid_b, 0}, coin));
+    BOOST_CHECK_EQUAL(stats_varint.coins_count, 3U);
+    BOOST_CHECK_EQUAL(stats_varint.nTransactions, 2U);
+}
+
+BOOST_FIXTURE_TEST_CASE(coin_stats_sharded_cursors, TestChain100Setup)
+{
+    CCoinsViewDB& coins_db{*WITH_LOCK(::cs_main, return &m_node.chainman->ActiveChainstate().CoinsDB())};
+    {
+        LOCK(::cs_main);
+        // Output indexes whose VARINT encodings do not sort in numeric order.
+        const Coin coin{CTxOut{50, CScript() << OP_TRUE}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false};
+        CCoinsViewCache& tip{m_node.chainman->ActiveChainstate().CoinsTip()};
+        tip.AddCoin(COutPoint{uint256S("ab"), 16511}, Coin{coin}, /*possible_overwrite=*/false);
+        tip.AddCoin(COutPoint{uint256S("ab"), 16512}, Coin{coin}, /*possible_overwrite=*/false);
+        m_node.chainman->ActiveChainstate().ForceFlushStateToDisk();
+    }
+
+    kernel::CCoinsStats expected;
+    kernel::CoinStatsAccumulator expected_accumulator{kernel::CoinStatsHashType::MUHASH, expected};
+    std::unique_ptr<CCoinsViewCursor> cursor{coins_db.Cursor()};
+    for (; cursor->Valid(); cursor->Next()) {
+        COutPoint key;
+        Coin coin;
+        BOOST_REQUIRE(cursor->GetKey(key) && cursor->GetValue(coin));
+        BOOST_REQUIRE(expected_accumulator.Add(key, coin));
+    }
+    expected_accumulator.Finalize();
+    BOOST_CHECK(expected.coins_count > 0);
+
+    for (unsigned int num_shards : {1U, 3U, 16U, 300U}) {
+        auto shards{coins_db.ShardedCursors(num_shards)};
+        BOOST_CHECK_EQUAL(shards.size(), std::min(num_shards, 256U));
+
+        kernel::CCoinsStats stats;
+        kernel::CoinStatsAccumulator accumulator{kernel::CoinStatsHashType::MUHASH, stats};
+        std::vector<kernel::CCoinsStats> shard_stats(shards.size());
+        for (size_t i = 0; i < shards.size(); ++i) {
+            BOOST_CHECK(shards[i]->GetBestBlock() == cursor->GetBestBlock());
+            kernel::CoinStatsAccumulator shard_accumulator{kernel::CoinStatsHashType::MUHASH, shard_stats[i]};
+            for (; shards[i]->Valid(); shards[i]->Next()) {
+                COutPoint key;
+                Coin coin;
+                BOOST_REQUIRE(shards[i]->GetKey(key) && shards[i]->GetValue(coin));
+                BOOST_REQUIRE(shard_accumulator.Add(key, coin));
+            }
+            accumulator.Combine(shard_accumulator);
+        }
+        accumulator.Finalize();
+
+        BOOST_CHECK_EQUAL(stats.coins_count, expected.coins_count);
+        BOOST_CHECK_EQUAL(stats.nTransactions, expected.nTransactions);
+        BOOST_CHECK_EQUAL(stats.nBogoSize, expected.nBogoSize);
+        BOOST_CHECK(stats.total_amount == expected.total_amount);
+        BOOST_CHECK_EQUAL(stats.hashSerialized, expected.hashSerialized);
+    }
+
+    const auto computed{kernel::ComputeUTXOStats(kernel::CoinStatsHashType::MUHASH, &coins_db, m_node.chainman->m_blockman)};
+    BOOST_REQUIRE(computed);
+    BOOST_CHECK_EQUAL(computed->coins_count, expected.coins_count);
+    BOOST_CHECK_EQUAL(computed->hashSerialized, expected.hashSerialized);
+    BOOST_CHECK(kernel::ComputeUTXOStats(kernel::CoinStatsHashType::HASH_SERIALIZED, &coins_db, m_node.chainman->m_blockman));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
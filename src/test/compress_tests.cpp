@@ -4,6 +4,7 @@
 
 #include <compressor.h>
 #include <script/script.h>
+#include <streams.h>
 #include <test/util/setup_common.h>
 
 #include <stdint.h>
@@ -134,4 +135,28 @@ BOOST_AUTO_TEST_CASE(compress_script_to_uncompressed_pubkey_id)
     BOOST_CHECK_EQUAL(out[0], 0x04 | (script[65] & 0x01)); // least significant bit (lsb) of last char of pubkey is mapped into out[0]
 }
 
+BOOST_AUTO_TEST_CASE(compress_script_roundtrip)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CKey key_uncompressed;
+    key_uncompressed.MakeNewKey(false);
+
+    const std::vector<CScript> scripts{
+        CScript() << OP_DUP << OP_HASH160 << ToByteVector(key.GetPubKey().GetID()) << OP_EQUALVERIFY << OP_CHECKSIG,
+        CScript() << OP_HASH160 << ToByteVector(CScriptID(CScript() << OP_TRUE)) << OP_EQUAL,
+        CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG,
+        CScript() << ToByteVector(key_uncompressed.GetPubKey()) << OP_CHECKSIG,
+        CScript() << OP_RETURN << std::vector<unsigned char>(40, 0xab),
+    };
+    for (const CScript& script : scripts) {
+        DataStream stream{};
+        stream << Using<ScriptCompression>(script);
+        CScript decoded;
+        stream >> Using<ScriptCompression>(decoded);
+        BOOST_CHECK(stream.empty());
+        BOOST_CHECK(decoded == script);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -21,6 +21,7 @@
 #include <test/util/setup_common.h>
 #include <util/strencodings.h>
 
+#include <algorithm>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -838,6 +839,39 @@ BOOST_AUTO_TEST_CASE(chacha20_midblock)
     BOOST_CHECK(Span{block}.last(52) == Span{b3});
 }
 
+BOOST_AUTO_TEST_CASE(chacha20_multiblock)
+{
+    // Long outputs may be produced several blocks at a time. Compare them against
+    // producing one block at a time, including across a wrap of the block counter.
+    const auto key = InsecureRand256();
+    for (const uint32_t seek : {0U, 0xfffffff0U, 0xfffffff8U, 0xfffffffbU}) {
+        const ChaCha20::Nonce96 nonce{InsecureRand32(), InsecureRandBits(64)};
+        for (size_t blocks = 1; blocks <= 20; ++blocks) {
+            ChaCha20Aligned c20{MakeByteSpan(key)};
+            std::vector<std::byte> expected((blocks + 1) * ChaCha20Aligned::BLOCKLEN);
+            c20.Seek(nonce, seek);
+            for (size_t i = 0; i <= blocks; ++i) {
+                c20.Keystream(Span{expected}.subspan(i * ChaCha20Aligned::BLOCKLEN, ChaCha20Aligned::BLOCKLEN));
+            }
+
+            std::vector<std::byte> keystream(expected.size());
+            c20.Seek(nonce, seek);
+            c20.Keystream(Span{keystream}.first(blocks * ChaCha20Aligned::BLOCKLEN));
+            // The block after them continues from the right position.
+            c20.Keystream(Span{keystream}.last(ChaCha20Aligned::BLOCKLEN));
+            BOOST_CHECK(keystream == expected);
+
+            const auto plain{g_insecure_rand_ctx.randbytes<std::byte>(expected.size())};
+            std::vector<std::byte> cipher(expected.size());
+            c20.Seek(nonce, seek);
+            c20.Crypt(plain, cipher);
+            for (size_t i = 0; i < cipher.size(); ++i) {
+                BOOST_CHECK(cipher[i] == (plain[i] ^ expected[i]));
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(poly1305_testvector)
 {
     // RFC 7539, section 2.5.2.
@@ -1292,4 +1326,39 @@ BOOST_AUTO_TEST_CASE(muhash_tests)
     BOOST_CHECK_EQUAL(HexStr(out4), "3a31e6903aff0de9f62f9a9f7f8b861de76ce2cda09822b90014319ae5dc2271");
 }
 
+BOOST_AUTO_TEST_CASE(muhash_implementations)
+{
+    // All implementations must produce identical, fully reduced internal state.
+    auto compute = [](muhash_implementation::UseImplementation impl, const std::vector<std::vector<unsigned char>>& ops, Span<const uint8_t> start) {
+        MuHash3072AutoDetect(impl);
+        MuHash3072 acc;
+        DataStream{start} >> acc;
+        for (size_t i = 0; i < ops.size(); ++i) {
+            if (i % 3 == 2) {
+                acc.Remove(ops[i]);
+            } else {
+                acc.Insert(ops[i]);
+            }
+        }
+        MuHash3072 copy{acc};
+        uint256 out;
+        acc.Finalize(out);
+        DataStream ss{};
+        ss << copy << out;
+        return HexStr(ss.str());
+    };
+
+    for (int iter = 0; iter < 20; ++iter) {
+        std::vector<std::vector<unsigned char>> ops;
+        for (int i = 0; i < 1 + iter; ++i) ops.push_back(g_insecure_rand_ctx.randbytes(32));
+        // Random limbs for the starting numerator and denominator, saturated in some iterations
+        // to exercise values at or above the modulus.
+        std::vector<uint8_t> start = g_insecure_rand_ctx.randbytes<uint8_t>(2 * Num3072::BYTE_SIZE);
+        if (iter % 4 == 0) std::fill(start.begin(), start.end(), 0xff);
+        if (iter % 4 == 1) std::fill(start.begin(), start.begin() + Num3072::BYTE_SIZE, 0xff);
+        BOOST_CHECK_EQUAL(compute(muhash_implementation::STANDARD, ops, start), compute(muhash_implementation::USE_ALL, ops, start));
+    }
+    MuHash3072AutoDetect();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
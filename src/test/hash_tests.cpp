@@ -106,6 +106,14 @@ BOOST_AUTO_TEST_CASE(siphash)
 
     BOOST_CHECK_EQUAL(SipHashUint256(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, uint256S("1f1e1d1c1b1a191817161514131211100f0e0d0c0b0a09080706050403020100")), 0x7127512f72f27cceull);
 
+    // The four-lane variant matches the single one in every lane.
+    std::array<uint256, 4> vals{uint256S("1f1e1d1c1b1a191817161514131211100f0e0d0c0b0a09080706050403020100"), InsecureRand256(), InsecureRand256(), InsecureRand256()};
+    const auto hashes{SipHashUint256x4(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, {&vals[0], &vals[1], &vals[2], &vals[3]})};
+    BOOST_CHECK_EQUAL(hashes[0], 0x7127512f72f27cceull);
+    for (int i = 1; i < 4; ++i) {
+        BOOST_CHECK_EQUAL(hashes[i], SipHashUint256(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, vals[i]));
+    }
+
     // Check test vectors from spec, one byte at a time
     CSipHasher hasher2(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL);
     for (uint8_t x=0; x<std::size(siphash_4_2_testvec); ++x)
@@ -126,6 +126,17 @@ static void CheckSort(CTxMemPool& pool, std::vector<std::string>& sortedOrder) E
     }
 }
 
+// Ancestor score order is not an index of mapTx but built on demand.
+template<>
+void CheckSort<ancestor_score>(CTxMemPool& pool, std::vector<std::string>& sortedOrder) EXCLUSIVE_LOCKS_REQUIRED(pool.cs)
+{
+    BOOST_CHECK_EQUAL(pool.size(), sortedOrder.size());
+    int count = 0;
+    for (const auto& it : pool.GetSortedByAncestorScore()) {
+        BOOST_CHECK_EQUAL(it->GetTx().GetHash().ToString(), sortedOrder[count++]);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(MempoolIndexingTest)
 {
     CTxMemPool& pool = *Assert(m_node.mempool);
@@ -800,4 +811,181 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTestsDiamond)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolRemoveForBlockTest)
+{
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    LOCK2(::cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // [ta] <- [tb] <- [tc]
+    //          ^---- [td] (also spends [te])
+    // [te]
+    CTransactionRef ta = make_tx(/*output_values=*/{10 * COIN});
+    CTransactionRef tb = make_tx(/*output_values=*/{5 * COIN, 4 * COIN}, /*inputs=*/{ta});
+    CTransactionRef tc = make_tx(/*output_values=*/{4 * COIN}, /*inputs=*/{tb}, /*input_indices=*/{0});
+    CTransactionRef te = make_tx(/*output_values=*/{2 * COIN});
+    CTransactionRef td = make_tx(/*output_values=*/{5 * COIN}, /*inputs=*/{tb, te}, /*input_indices=*/{1, 0});
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(ta));
+    pool.addUnchecked(entry.Fee(2000LL).FromTx(tb));
+    pool.addUnchecked(entry.Fee(3000LL).FromTx(tc));
+    pool.addUnchecked(entry.Fee(4000LL).FromTx(te));
+    pool.addUnchecked(entry.Fee(5000LL).FromTx(td));
+    BOOST_CHECK_EQUAL((*pool.GetIter(td->GetHash()))->GetCountWithAncestors(), 4U);
+
+    // Confirm [ta] and [tb]; the remaining descendants lose them as ancestors.
+    pool.removeForBlock({ta, tb}, /*nBlockHeight=*/1);
+    BOOST_CHECK_EQUAL(pool.size(), 3U);
+    const auto c{*pool.GetIter(tc->GetHash())};
+    const auto d{*pool.GetIter(td->GetHash())};
+    const auto e{*pool.GetIter(te->GetHash())};
+    BOOST_CHECK_EQUAL(c->GetCountWithAncestors(), 1U);
+    BOOST_CHECK_EQUAL(c->GetSizeWithAncestors(), c->GetTxSize());
+    BOOST_CHECK_EQUAL(c->GetModFeesWithAncestors(), 3000);
+    BOOST_CHECK_EQUAL(c->GetSigOpCostWithAncestors(), c->GetSigOpCost());
+    BOOST_CHECK_EQUAL(d->GetCountWithAncestors(), 2U);
+    BOOST_CHECK_EQUAL(d->GetSizeWithAncestors(), d->GetTxSize() + e->GetTxSize());
+    BOOST_CHECK_EQUAL(d->GetModFeesWithAncestors(), 9000);
+    BOOST_CHECK(d->GetMemPoolParentsConst().size() == 1);
+    BOOST_CHECK_EQUAL(e->GetCountWithDescendants(), 2U);
+
+    // A block that is not closed under in-mempool ancestors is still handled.
+    pool.removeForBlock({td}, /*nBlockHeight=*/2);
+    BOOST_CHECK_EQUAL(pool.size(), 2U);
+    BOOST_CHECK_EQUAL(e->GetCountWithDescendants(), 1U);
+    BOOST_CHECK_EQUAL(e->GetModFeesWithDescendants(), 4000);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolChangesSinceTest)
+{
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    LOCK2(::cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // Add the way AcceptToMemoryPool does, handing out a sequence value.
+    const auto add = [&](const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(pool.cs) {
+        pool.addUnchecked(entry.FromTx(tx));
+        pool.GetAndIncrementSequence();
+    };
+    const auto sorted = [](std::vector<uint256> txids) {
+        std::sort(txids.begin(), txids.end());
+        return txids;
+    };
+
+    CTransactionRef ta = make_tx(/*output_values=*/{10 * COIN});
+    CTransactionRef tb = make_tx(/*output_values=*/{5 * COIN}, /*inputs=*/{ta});
+    CTransactionRef tc = make_tx(/*output_values=*/{2 * COIN});
+    CTransactionRef td = make_tx(/*output_values=*/{3 * COIN});
+
+    const uint64_t start{pool.GetSequence()};
+    add(ta);
+    add(tb);
+    const uint64_t snapshot{pool.GetSequence()};
+    add(tc);
+    pool.removeRecursive(*ta, MemPoolRemovalReason::REPLACED);
+    add(td);
+    pool.removeRecursive(*td, MemPoolRemovalReason::EXPIRY);
+
+    auto delta{pool.GetChangesSince(start)};
+    BOOST_REQUIRE(delta);
+    BOOST_CHECK(delta->added == std::vector<uint256>{tc->GetHash()});
+    BOOST_CHECK(delta->removed.empty());
+    BOOST_CHECK_EQUAL(delta->sequence, pool.GetSequence());
+
+    delta = pool.GetChangesSince(snapshot);
+    BOOST_REQUIRE(delta);
+    BOOST_CHECK(delta->added == std::vector<uint256>{tc->GetHash()});
+    BOOST_CHECK(sorted(delta->removed) == sorted({ta->GetHash(), tb->GetHash()}));
+
+    delta = pool.GetChangesSince(pool.GetSequence());
+    BOOST_REQUIRE(delta);
+    BOOST_CHECK(delta->added.empty() && delta->removed.empty());
+    BOOST_CHECK(!pool.GetChangesSince(pool.GetSequence() + 1));
+
+    // Only a bounded history is kept.
+    CTransactionRef te = make_tx(/*output_values=*/{1 * COIN});
+    for (size_t i = 0; i < MAX_MEMPOOL_SEQUENCED_CHANGES / 2; ++i) {
+        add(te);
+        pool.removeRecursive(*te, MemPoolRemovalReason::EXPIRY);
+    }
+    BOOST_CHECK(!pool.GetChangesSince(start));
+    delta = pool.GetChangesSince(pool.GetSequence() - 2);
+    BOOST_REQUIRE(delta);
+    BOOST_CHECK(delta->added.empty() && delta->removed.empty());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolFeeRateHigherTest)
+{
+    BOOST_CHECK(FeeRateHigher(2, 1, 1, 1));
+    BOOST_CHECK(!FeeRateHigher(1, 1, 1, 1));
+    BOOST_CHECK(!FeeRateHigher(-1, 1, 0, 1));
+    // Products that neither fit in 64 bits nor are exact as doubles.
+    BOOST_CHECK(FeeRateHigher(MAX_MONEY, 400'000'001, MAX_MONEY - 1, 400'000'001));
+    BOOST_CHECK(!FeeRateHigher(MAX_MONEY - 1, 400'000'000, MAX_MONEY, 400'000'000));
+    BOOST_CHECK(FeeRateHigher(MAX_MONEY, 400'000'000, MAX_MONEY, 400'000'001));
+}
+
+BOOST_AUTO_TEST_CASE(MempoolClusterLinearizationTest)
+{
+    CTxMemPool::Options opts{MemPoolOptionsForTest(m_node)};
+    opts.cluster_mempool = true;
+    CTxMemPool pool{opts};
+    LOCK2(::cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // A zero-fee parent with a high-fee child (CPFP) and a low-fee child, plus
+    // an unrelated transaction.
+    //
+    // [ta].0 <- [tb]
+    //     .1 <- [tc]
+    // [td]
+    CTransactionRef ta = make_tx(/*output_values=*/{5 * COIN, 5 * COIN});
+    CTransactionRef tb = make_tx(/*output_values=*/{5 * COIN}, /*inputs=*/{ta}, /*input_indices=*/{0});
+    CTransactionRef tc = make_tx(/*output_values=*/{5 * COIN}, /*inputs=*/{ta}, /*input_indices=*/{1});
+    CTransactionRef td = make_tx(/*output_values=*/{1 * COIN});
+    pool.addUnchecked(entry.Fee(0LL).FromTx(ta));
+    pool.addUnchecked(entry.Fee(20000LL).FromTx(tb));
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(tc));
+    pool.addUnchecked(entry.Fee(5000LL).FromTx(td));
+
+    const auto chunks{pool.LinearizeCluster(*pool.GetIter(tc->GetHash()))};
+    BOOST_REQUIRE_EQUAL(chunks.size(), 2U);
+    BOOST_REQUIRE_EQUAL(chunks[0].txs.size(), 2U);
+    BOOST_CHECK_EQUAL(chunks[0].txs[0]->GetTx().GetHash(), ta->GetHash());
+    BOOST_CHECK_EQUAL(chunks[0].txs[1]->GetTx().GetHash(), tb->GetHash());
+    BOOST_CHECK_EQUAL(chunks[0].fee, 20000);
+    BOOST_CHECK_EQUAL(chunks[0].vsize, GetVirtualTransactionSize(*ta) + GetVirtualTransactionSize(*tb));
+    BOOST_REQUIRE_EQUAL(chunks[1].txs.size(), 1U);
+    BOOST_CHECK_EQUAL(chunks[1].txs[0]->GetTx().GetHash(), tc->GetHash());
+    BOOST_CHECK_EQUAL(chunks[1].fee, 1000);
+
+    const auto single{pool.LinearizeCluster(*pool.GetIter(td->GetHash()))};
+    BOOST_REQUIRE_EQUAL(single.size(), 1U);
+    BOOST_CHECK_EQUAL(single[0].txs.size(), 1U);
+
+    // The linearization is cached for the whole cluster, and recomputed once a fee in it changes.
+    BOOST_CHECK_EQUAL(&pool.LinearizeCluster(*pool.GetIter(ta->GetHash())), &pool.LinearizeCluster(*pool.GetIter(tc->GetHash())));
+    pool.PrioritiseTransaction(tc->GetHash(), 100000);
+    const auto prioritised{pool.LinearizeCluster(*pool.GetIter(tb->GetHash()))};
+    BOOST_REQUIRE_EQUAL(prioritised.size(), 2U);
+    BOOST_CHECK_EQUAL(prioritised[0].txs[1]->GetTx().GetHash(), tc->GetHash());
+    BOOST_CHECK_EQUAL(prioritised[0].fee, 101000);
+    pool.PrioritiseTransaction(tc->GetHash(), -100000);
+    BOOST_CHECK_EQUAL(pool.LinearizeCluster(*pool.GetIter(tb->GetHash())).size(), 2U);
+
+    // A transaction that would grow a cluster beyond the limit is rejected.
+    CTransactionRef te = make_tx(/*output_values=*/{1 * COIN}, /*inputs=*/{tb}, /*input_indices=*/{0});
+    CTxMemPool::Limits limits{};
+    limits.cluster_count = 3;
+    BOOST_CHECK(!pool.CalculateMemPoolAncestors(entry.FromTx(te), limits));
+    limits.cluster_count = 4;
+    BOOST_CHECK(pool.CalculateMemPoolAncestors(entry.FromTx(te), limits));
+
+    // Eviction removes the worst chunk only, which leaves the CPFP package in place.
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(pool.exists(GenTxid::Txid(ta->GetHash())));
+    BOOST_CHECK(pool.exists(GenTxid::Txid(tb->GetHash())));
+    BOOST_CHECK(!pool.exists(GenTxid::Txid(tc->GetHash())));
+    BOOST_CHECK(pool.exists(GenTxid::Txid(td->GetHash())));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -31,7 +31,7 @@ using node::CBlockTemplate;
 
 namespace miner_tests {
 struct MinerTestingSetup : public TestingSetup {
-    void TestPackageSelection(const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    void TestPackageSelection(const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst, bool cluster_mempool) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     void TestBasicMining(const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst, int baseheight) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     void TestPrioritisedMining(const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     bool TestSequenceLocks(const CTransaction& tx, CTxMemPool& tx_mempool) EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
@@ -41,13 +41,15 @@ struct MinerTestingSetup : public TestingSetup {
         const std::optional<LockPoints> lock_points{CalculateLockPointsAtTip(tip, view_mempool, tx)};
         return lock_points.has_value() && CheckSequenceLocksAtTip(tip, *lock_points);
     }
-    CTxMemPool& MakeMempool()
+    CTxMemPool& MakeMempool(bool cluster_mempool = false)
     {
         // Delete the previous mempool to ensure with valgrind that the old
         // pointer is not accessed, when the new one should be accessed
         // instead.
         m_node.mempool.reset();
-        m_node.mempool = std::make_unique<CTxMemPool>(MemPoolOptionsForTest(m_node));
+        CTxMemPool::Options opts{MemPoolOptionsForTest(m_node)};
+        opts.cluster_mempool = cluster_mempool;
+        m_node.mempool = std::make_unique<CTxMemPool>(opts);
         return *m_node.mempool;
     }
     BlockAssembler AssemblerForTest(CTxMemPool& tx_mempool);
@@ -101,9 +103,9 @@ static std::unique_ptr<CBlockIndex> CreateBlockIndex(int nHeight, CBlockIndex* a
 // Test suite for ancestor feerate transaction selection.
 // Implemented as an additional function, rather than a separate test case,
 // to allow reusing the blockchain created in CreateNewBlock_validity.
-void MinerTestingSetup::TestPackageSelection(const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst)
+void MinerTestingSetup::TestPackageSelection(const CScript& scriptPubKey, const std::vector<CTransactionRef>& txFirst, bool cluster_mempool)
 {
-    CTxMemPool& tx_mempool{MakeMempool()};
+    CTxMemPool& tx_mempool{MakeMempool(cluster_mempool)};
     LOCK(tx_mempool.cs);
     // Test the ancestor feerate transaction selection.
     TestMemPoolEntryHelper entry;
@@ -647,7 +649,9 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     m_node.chainman->ActiveChain().Tip()->nHeight--;
     SetMockTime(0);
 
-    TestPackageSelection(scriptPubKey, txFirst);
+    TestPackageSelection(scriptPubKey, txFirst, /*cluster_mempool=*/false);
+    // Chunks of linearized clusters must be selected in the same order.
+    TestPackageSelection(scriptPubKey, txFirst, /*cluster_mempool=*/true);
 
     m_node.chainman->ActiveChain().Tip()->nHeight--;
     SetMockTime(0);
@@ -1565,4 +1565,84 @@ BOOST_AUTO_TEST_CASE(v2transport_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(v1transport_send_many)
+{
+    V1Transport sender{/*node_id=*/0, SER_NETWORK, INIT_PROTO_VERSION};
+    V1Transport receiver{/*node_id=*/1, SER_NETWORK, INIT_PROTO_VERSION};
+
+    // A regular message, one without payload, and one whose payload is shared with another copy.
+    CSerializedNetMsg ping;
+    ping.m_type = NetMsgType::PING;
+    ping.data = g_insecure_rand_ctx.randbytes<uint8_t>(8);
+    CSerializedNetMsg verack;
+    verack.m_type = NetMsgType::VERACK;
+    CSerializedNetMsg block;
+    block.m_type = NetMsgType::BLOCK;
+    block.data = g_insecure_rand_ctx.randbytes<uint8_t>(1000);
+    const std::vector<uint8_t> block_data{block.data};
+    block.Share();
+    BOOST_CHECK(block.data.empty());
+    BOOST_CHECK(Span{block.Payload()} == Span{block_data});
+    CSerializedNetMsg block_copy{block.Copy()};
+    BOOST_CHECK(block_copy.Payload().data() == block.Payload().data());
+
+    const std::vector<uint8_t> ping_data{ping.data};
+    BOOST_REQUIRE(sender.SetMessageToSend(ping));
+    BOOST_REQUIRE(sender.SetMessageToSend(verack));
+    BOOST_REQUIRE(sender.SetMessageToSend(block_copy));
+
+    // All headers and payloads are returned at once, the shared payload without being copied.
+    std::vector<Transport::SendSpan> spans;
+    BOOST_CHECK(!sender.GetBytesToSendMany(/*have_next_message=*/false, spans));
+    BOOST_REQUIRE_EQUAL(spans.size(), 5U);
+    BOOST_CHECK_EQUAL(*spans[3].m_type, NetMsgType::BLOCK);
+    BOOST_CHECK(spans[4].data.data() == block.Payload().data());
+    std::vector<uint8_t> wire;
+    for (const auto& span : spans) wire.insert(wire.end(), span.data.begin(), span.data.end());
+
+    // Partially sending continues the same stream, also across message boundaries.
+    size_t offset{0};
+    for (size_t sent : {10, 30, 20}) {
+        sender.MarkBytesSent(sent);
+        offset += sent;
+        spans.clear();
+        BOOST_CHECK(sender.GetBytesToSendMany(/*have_next_message=*/true, spans));
+        std::vector<uint8_t> rest;
+        for (const auto& span : spans) rest.insert(rest.end(), span.data.begin(), span.data.end());
+        BOOST_CHECK(Span{rest} == Span{wire}.subspan(offset));
+    }
+    sender.MarkBytesSent(wire.size() - offset);
+    const auto& [to_send, more, _msg_type] = sender.GetBytesToSend(/*have_next_message=*/false);
+    BOOST_CHECK(to_send.empty());
+    BOOST_CHECK(!more);
+    BOOST_CHECK_EQUAL(sender.GetSendMemoryUsage(), 0U);
+
+    // The receiver decodes the three messages.
+    Span<const uint8_t> msg_bytes{wire};
+    std::vector<CNetMessage> received;
+    while (!msg_bytes.empty()) {
+        BOOST_REQUIRE(receiver.ReceivedBytes(msg_bytes));
+        if (receiver.ReceivedMessageComplete()) {
+            bool reject{false};
+            received.push_back(receiver.GetReceivedMessage({}, reject));
+            BOOST_REQUIRE(!reject);
+        }
+    }
+    BOOST_REQUIRE_EQUAL(received.size(), 3U);
+    BOOST_CHECK_EQUAL(received[0].m_type, NetMsgType::PING);
+    BOOST_CHECK(Span{received[0].m_recv} == MakeByteSpan(ping_data));
+    BOOST_CHECK_EQUAL(received[1].m_type, NetMsgType::VERACK);
+    BOOST_CHECK_EQUAL(received[1].m_message_size, 0U);
+    BOOST_CHECK_EQUAL(received[2].m_type, NetMsgType::BLOCK);
+    BOOST_CHECK(Span{received[2].m_recv} == MakeByteSpan(block_data));
+
+    // The transport only accepts a bounded number of messages before they are sent.
+    for (size_t i = 0; i < V1Transport::MAX_SEND_QUEUE; ++i) {
+        CSerializedNetMsg msg{block.Copy()};
+        BOOST_CHECK(sender.SetMessageToSend(msg));
+    }
+    CSerializedNetMsg msg{block.Copy()};
+    BOOST_CHECK(!sender.SetMessageToSend(msg));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <arith_uint256.h>
+#include <consensus/validation.h>
 #include <pubkey.h>
 #include <script/sign.h>
 #include <script/signingprovider.h>
@@ -12,6 +13,7 @@
 
 #include <array>
 #include <cstdint>
+#include <set>
 
 #include <boost/test/unit_test.hpp>
 
@@ -136,4 +138,94 @@ BOOST_AUTO_TEST_CASE(DoS_mapOrphans)
     BOOST_CHECK(orphanage.CountOrphans() == 0);
 }
 
+static CTransactionRef MakeOrphan(const uint256& parent, unsigned int num_outputs = 1)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout.n = 0;
+    tx.vin[0].prevout.hash = parent;
+    tx.vin[0].scriptSig << OP_1;
+    tx.vout.resize(num_outputs);
+    for (auto& out : tx.vout) {
+        out.nValue = 1 * CENT;
+        out.scriptPubKey = CScript() << OP_TRUE;
+    }
+    return MakeTransactionRef(tx);
+}
+
+BOOST_AUTO_TEST_CASE(orphan_weight_limits)
+{
+    TxOrphanageTest orphanage;
+
+    // Peer 0 floods us; every orphan weighs the same.
+    const CTransactionRef first{MakeOrphan(InsecureRand256())};
+    const int64_t weight{GetTransactionWeight(*first)};
+    BOOST_CHECK(orphanage.AddTx(first, 0));
+    const int64_t per_peer{MAX_ORPHAN_WEIGHT_PER_PEER / weight};
+    for (int64_t i = 1; i < per_peer; ++i) {
+        BOOST_CHECK(orphanage.AddTx(MakeOrphan(InsecureRand256()), 0));
+    }
+    BOOST_CHECK_EQUAL(orphanage.TotalWeight(), per_peer * weight);
+    BOOST_CHECK(orphanage.HaveTx(GenTxid::Txid(first->GetHash())));
+
+    // Going over the per-peer quota drops the peer's oldest orphan.
+    BOOST_CHECK(orphanage.AddTx(MakeOrphan(InsecureRand256()), 0));
+    BOOST_CHECK(!orphanage.HaveTx(GenTxid::Txid(first->GetHash())));
+    BOOST_CHECK_EQUAL(orphanage.CountOrphans(), per_peer);
+
+    // Peer 1 has a single orphan, which survives limiting as long as
+    // peer 0 uses more weight.
+    const CTransactionRef other{MakeOrphan(InsecureRand256())};
+    BOOST_CHECK(orphanage.AddTx(other, 1));
+    orphanage.LimitOrphans(/*max_orphans=*/100, /*max_weight=*/2 * weight);
+    BOOST_CHECK_EQUAL(orphanage.CountOrphans(), 2U);
+    BOOST_CHECK(orphanage.HaveTx(GenTxid::Txid(other->GetHash())));
+    BOOST_CHECK_EQUAL(orphanage.TotalWeight(), 2 * weight);
+
+    orphanage.EraseForPeer(0);
+    BOOST_CHECK_EQUAL(orphanage.CountOrphans(), 1U);
+    orphanage.EraseForPeer(1);
+    BOOST_CHECK_EQUAL(orphanage.CountOrphans(), 0U);
+    BOOST_CHECK_EQUAL(orphanage.TotalWeight(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(orphan_work_set)
+{
+    TxOrphanageTest orphanage;
+
+    const CTransactionRef parent{MakeOrphan(InsecureRand256(), /*num_outputs=*/3)};
+    // Two children spending the parent, from the same peer, and one
+    // grandchild that only becomes ready once a child is accepted.
+    CMutableTransaction mtx{*MakeOrphan(parent->GetHash())};
+    const CTransactionRef child1{MakeTransactionRef(mtx)};
+    mtx.vin[0].prevout.n = 2;
+    const CTransactionRef child2{MakeTransactionRef(mtx)};
+    const CTransactionRef grandchild{MakeOrphan(child1->GetHash())};
+    BOOST_CHECK(orphanage.AddTx(child1, 0));
+    BOOST_CHECK(orphanage.AddTx(child2, 0));
+    BOOST_CHECK(orphanage.AddTx(grandchild, 0));
+    // An unrelated orphan spending an output the parent doesn't have
+    mtx.vin[0].prevout.n = 3;
+    BOOST_CHECK(orphanage.AddTx(MakeTransactionRef(mtx), 0));
+
+    orphanage.AddChildrenToWorkSet(*parent);
+    BOOST_CHECK(orphanage.HaveTxToReconsider(0));
+    std::set<CTransactionRef> work;
+    while (const CTransactionRef tx{orphanage.GetTxToReconsider(0)}) work.insert(tx);
+    BOOST_CHECK(work == std::set<CTransactionRef>({child1, child2}));
+    BOOST_CHECK(!orphanage.HaveTxToReconsider(0));
+
+    orphanage.AddChildrenToWorkSet(*child1);
+    BOOST_CHECK(orphanage.GetTxToReconsider(0) == grandchild);
+    BOOST_CHECK(orphanage.GetTxToReconsider(0) == nullptr);
+
+    // The whole work set can be extracted as one batch.
+    orphanage.AddChildrenToWorkSet(*parent);
+    orphanage.AddChildrenToWorkSet(*child1);
+    const auto batch{orphanage.GetTxsToReconsider(0)};
+    BOOST_CHECK(std::set<CTransactionRef>(batch.begin(), batch.end()) == std::set<CTransactionRef>({child1, child2, grandchild}));
+    BOOST_CHECK(!orphanage.HaveTxToReconsider(0));
+    BOOST_CHECK(orphanage.GetTxsToReconsider(0).empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -156,6 +156,28 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(CheckProofOfWorkParallel_test)
+{
+    const auto consensus = CreateChainParams(*m_node.args, ChainType::REGTEST)->GetConsensus();
+    // More than one chunk of headers
+    std::vector<CBlockHeader> headers(40);
+    for (size_t i = 0; i < headers.size(); ++i) {
+        CBlockHeader& header = headers[i];
+        header.hashPrevBlock = i ? headers[i - 1].GetHash() : consensus.hashGenesisBlock;
+        header.nTime = 1296688602 + i;
+        header.nBits = UintToArith256(consensus.powLimit).GetCompact();
+        while (!CheckProofOfWorkX(header, consensus)) ++header.nNonce;
+    }
+    BOOST_CHECK(CheckProofOfWorkParallel(headers, consensus));
+    // The hashes computed in parallel give the same answer as computing them one by one.
+    for (const CBlockHeader& header : headers) BOOST_CHECK(CheckProofOfWorkX(header, consensus));
+
+    // A target no hash can meet
+    headers[37].nBits = 0;
+    BOOST_CHECK(!CheckProofOfWorkParallel(headers, consensus));
+    BOOST_CHECK(CheckProofOfWorkParallel({}, consensus));
+}
+
 void sanity_check_chainparams(const ArgsManager& args, ChainType chain_type)
 {
     const auto chainParams = CreateChainParams(args, chain_type);
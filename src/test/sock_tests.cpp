@@ -11,6 +11,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <cassert>
+#include <memory>
 #include <thread>
 
 using namespace std::chrono_literals;
@@ -125,6 +126,25 @@ BOOST_AUTO_TEST_CASE(send_and_receive)
     BOOST_CHECK(SocketIsClosed(s[1]));
 }
 
+BOOST_AUTO_TEST_CASE(send_many)
+{
+    int s[2];
+    CreateSocketPair(s);
+    const Sock sender(s[0]);
+    const Sock receiver(s[1]);
+
+    const std::vector<unsigned char> header{'a', 'b'};
+    const std::vector<unsigned char> empty;
+    const std::vector<unsigned char> payload{'c', 'd', 'e'};
+    const std::vector<Span<const unsigned char>> buffers{header, empty, payload};
+    char recv_buf[10];
+
+    BOOST_CHECK_EQUAL(sender.SendMany(buffers, 0), 5);
+    BOOST_CHECK_EQUAL(receiver.Recv(recv_buf, sizeof(recv_buf), 0), 5);
+    BOOST_CHECK_EQUAL(strncmp("abcde", recv_buf, 5), 0);
+    BOOST_CHECK_EQUAL(sender.SendMany({}, 0), 0);
+}
+
 BOOST_AUTO_TEST_CASE(wait)
 {
     int s[2];
@@ -169,6 +189,61 @@ BOOST_AUTO_TEST_CASE(recv_until_terminator_limit)
     receiver.join();
 }
 
+static void CheckPoller(SockPoller& poller)
+{
+    int s[2];
+    CreateSocketPair(s);
+    auto sock0 = std::make_shared<const Sock>(s[0]);
+    auto sock1 = std::make_shared<const Sock>(s[1]);
+    Sock::EventsPerSock occurred;
+
+    BOOST_REQUIRE(poller.Set(sock0, Sock::RECV));
+    BOOST_REQUIRE(poller.Wait(0ms, occurred));
+    BOOST_CHECK(occurred.empty());
+
+    BOOST_REQUIRE_EQUAL(sock1->Send("a", 1, 0), 1);
+    BOOST_REQUIRE(poller.Wait(1min, occurred));
+    BOOST_REQUIRE_EQUAL(occurred.size(), 1U);
+    BOOST_CHECK(occurred.begin()->first == sock0);
+    BOOST_CHECK_EQUAL(occurred.begin()->second.occurred, Sock::RECV);
+
+    // Changing the requested events of a registered socket.
+    BOOST_REQUIRE(poller.Set(sock0, Sock::SEND));
+    BOOST_REQUIRE(poller.Wait(1min, occurred));
+    BOOST_REQUIRE_EQUAL(occurred.size(), 1U);
+    BOOST_CHECK_EQUAL(occurred.begin()->second.occurred, Sock::SEND);
+
+    // A closed socket is not waited on anymore, and a new socket that gets its
+    // descriptor number can be registered.
+    occurred.clear();
+    sock0.reset();
+    int t[2];
+    CreateSocketPair(t);
+    auto sock2 = std::make_shared<const Sock>(t[0]);
+    auto sock3 = std::make_shared<const Sock>(t[1]);
+    BOOST_REQUIRE(poller.Set(sock2, Sock::RECV));
+    BOOST_REQUIRE_EQUAL(sock3->Send("b", 1, 0), 1);
+    BOOST_REQUIRE(poller.Wait(1min, occurred));
+    BOOST_REQUIRE_EQUAL(occurred.size(), 1U);
+    BOOST_CHECK(occurred.begin()->first == sock2);
+    BOOST_CHECK_EQUAL(occurred.begin()->second.occurred, Sock::RECV);
+}
+
+BOOST_AUTO_TEST_CASE(poller)
+{
+    SockPoller poller;
+    CheckPoller(poller);
+}
+
+#ifdef USE_EPOLL
+BOOST_AUTO_TEST_CASE(epoll_poller)
+{
+    auto poller{CreateSockPollerOS()};
+    BOOST_REQUIRE(dynamic_cast<EpollSockPoller*>(poller.get()));
+    CheckPoller(*poller);
+}
+#endif // USE_EPOLL
+
 #endif /* WIN32 */
 
 BOOST_AUTO_TEST_SUITE_END()
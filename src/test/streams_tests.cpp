@@ -184,6 +184,32 @@ BOOST_AUTO_TEST_CASE(streams_vector_reader_rvalue)
     BOOST_CHECK(reader.empty());
 }
 
+BOOST_AUTO_TEST_CASE(streams_xor_span_reader)
+{
+    const std::vector<uint8_t> key{0xff, 0x00, 0x0f};
+    const std::vector<uint8_t> plain{0x82, 0xa7, 0x31, 0x01, 0x02, 0x03, 0x04, 0x05};
+    std::vector<uint8_t> obfuscated{plain};
+    util::Xor(MakeWritableByteSpan(obfuscated), MakeByteSpan(key));
+
+    XorSpanReader reader{MakeByteSpan(obfuscated), MakeByteSpan(key)};
+    uint32_t varint = 0;
+    reader >> VARINT(varint);
+    BOOST_CHECK_EQUAL(varint, 54321U);
+    BOOST_CHECK_EQUAL(reader.size(), 5U);
+
+    // Skipping bytes keeps the key offset in sync.
+    reader.ignore(1);
+    uint32_t n = 0;
+    reader >> n;
+    BOOST_CHECK_EQUAL(n, 0x05040302U);
+    BOOST_CHECK(reader.empty());
+    // The referenced data is left untouched.
+    BOOST_CHECK(obfuscated != plain);
+
+    BOOST_CHECK_THROW(reader >> n, std::ios_base::failure);
+    BOOST_CHECK_THROW(reader.ignore(1), std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_CASE(bitstream_reader_writer)
 {
     DataStream data{};
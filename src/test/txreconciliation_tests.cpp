@@ -4,10 +4,74 @@
 
 #include <node/txreconciliation.h>
 
+#include <random.h>
 #include <test/util/setup_common.h>
 
+#include <set>
+
 #include <boost/test/unit_test.hpp>
 
+namespace {
+
+constexpr NodeId PEER{0};
+
+/** Register two nodes with each other, as they would be on either end of one connection. */
+void RegisterPair(TxReconciliationTracker& initiator, TxReconciliationTracker& responder)
+{
+    const uint64_t initiator_salt{initiator.PreRegisterPeer(PEER)};
+    const uint64_t responder_salt{responder.PreRegisterPeer(PEER)};
+    BOOST_REQUIRE_EQUAL(initiator.RegisterPeer(PEER, /*is_peer_inbound=*/false, TXRECONCILIATION_VERSION, responder_salt),
+                        ReconciliationRegisterResult::SUCCESS);
+    BOOST_REQUIRE_EQUAL(responder.RegisterPeer(PEER, /*is_peer_inbound=*/true, TXRECONCILIATION_VERSION, initiator_salt),
+                        ReconciliationRegisterResult::SUCCESS);
+}
+
+std::vector<uint256> AddTxs(FastRandomContext& rng, size_t count, std::vector<TxReconciliationTracker*> trackers)
+{
+    std::vector<uint256> wtxids;
+    for (size_t i = 0; i < count; ++i) {
+        wtxids.push_back(rng.rand256());
+        for (auto* tracker : trackers) BOOST_REQUIRE(tracker->AddToSet(PEER, wtxids.back()));
+    }
+    return wtxids;
+}
+
+struct RoundResult {
+    bool success;
+    bool extended{false};
+    std::set<uint256> initiator_announced;
+    std::set<uint256> responder_announced;
+};
+
+/** Run a full reconciliation round between the two nodes. */
+RoundResult Reconcile(TxReconciliationTracker& initiator, TxReconciliationTracker& responder, std::chrono::microseconds now)
+{
+    const auto request{initiator.InitiateReconciliationRequest(PEER, now)};
+    BOOST_REQUIRE(request);
+    const auto sketch{responder.HandleReconciliationRequest(PEER, request->first, request->second, now)};
+    BOOST_REQUIRE(sketch);
+
+    RoundResult round;
+    auto result{initiator.HandleSketch(PEER, *sketch, now)};
+    if (result.action == TxReconciliationTracker::SketchResult::Action::REQUEST_EXTENSION) {
+        round.extended = true;
+        const auto extension{responder.HandleExtensionRequest(PEER)};
+        BOOST_REQUIRE(extension);
+        BOOST_CHECK_EQUAL(extension->size(), sketch->size());
+        result = initiator.HandleSketch(PEER, *extension, now);
+    }
+    BOOST_REQUIRE(result.action == TxReconciliationTracker::SketchResult::Action::FINISH);
+    round.success = result.success;
+    round.initiator_announced = {result.announce.begin(), result.announce.end()};
+
+    const auto announce{responder.HandleReconciliationDifference(PEER, result.success, result.ask_short_ids)};
+    BOOST_REQUIRE(announce);
+    round.responder_announced = {announce->begin(), announce->end()};
+    return round;
+}
+
+} // namespace
+
 BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
 
 BOOST_AUTO_TEST_CASE(RegisterPeerTest)
@@ -81,4 +145,134 @@ BOOST_AUTO_TEST_CASE(IsPeerRegisteredTest)
     BOOST_CHECK(!tracker.IsPeerRegistered(peer_id0));
 }
 
+BOOST_AUTO_TEST_CASE(ReconciliationTest)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::chrono::microseconds now{1'000'000};
+
+    TxReconciliationTracker initiator(TXRECONCILIATION_VERSION), responder(TXRECONCILIATION_VERSION);
+    RegisterPair(initiator, responder);
+
+    // The difference fits the estimated capacity.
+    AddTxs(rng, 20, {&initiator, &responder});
+    auto initiator_only{AddTxs(rng, 3, {&initiator})};
+    auto responder_only{AddTxs(rng, 2, {&responder})};
+    auto round{Reconcile(initiator, responder, now)};
+    BOOST_CHECK(round.success);
+    BOOST_CHECK(!round.extended);
+    BOOST_CHECK(round.initiator_announced == std::set<uint256>(initiator_only.begin(), initiator_only.end()));
+    BOOST_CHECK(round.responder_announced == std::set<uint256>(responder_only.begin(), responder_only.end()));
+
+    // Not before the next round is due, which the responder enforces too.
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(PEER, now + RECON_REQUEST_INTERVAL - 1us));
+    BOOST_CHECK(!responder.HandleReconciliationRequest(PEER, 0, 0, now + RECON_REQUEST_INTERVAL - 1us));
+    now += RECON_REQUEST_INTERVAL;
+
+    // The difference needs an extension: same set sizes, so it is estimated from the share q only.
+    AddTxs(rng, 20, {&initiator, &responder});
+    initiator_only = AddTxs(rng, 5, {&initiator});
+    responder_only = AddTxs(rng, 5, {&responder});
+    round = Reconcile(initiator, responder, now);
+    BOOST_CHECK(round.success);
+    BOOST_CHECK(round.extended);
+    BOOST_CHECK(round.initiator_announced == std::set<uint256>(initiator_only.begin(), initiator_only.end()));
+    BOOST_CHECK(round.responder_announced == std::set<uint256>(responder_only.begin(), responder_only.end()));
+    now += RECON_REQUEST_INTERVAL;
+
+    // The difference does not fit even the extension: both sides announce their whole set.
+    initiator_only = AddTxs(rng, 30, {&initiator});
+    responder_only = AddTxs(rng, 30, {&responder});
+    round = Reconcile(initiator, responder, now);
+    BOOST_CHECK(!round.success);
+    BOOST_CHECK(round.extended);
+    BOOST_CHECK(round.initiator_announced == std::set<uint256>(initiator_only.begin(), initiator_only.end()));
+    BOOST_CHECK(round.responder_announced == std::set<uint256>(responder_only.begin(), responder_only.end()));
+    now += RECON_REQUEST_INTERVAL;
+
+    // A transaction the peer announced to us is not reconciled.
+    const auto announced_by_peer{AddTxs(rng, 2, {&initiator})};
+    initiator.TryRemovingFromSet(PEER, announced_by_peer[0]);
+    round = Reconcile(initiator, responder, now);
+    BOOST_CHECK(round.success);
+    BOOST_CHECK(round.initiator_announced == std::set<uint256>{announced_by_peer[1]});
+}
+
+BOOST_AUTO_TEST_CASE(ReconciliationTimeoutTest)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::chrono::microseconds now{1'000'000};
+
+    TxReconciliationTracker initiator(TXRECONCILIATION_VERSION), responder(TXRECONCILIATION_VERSION);
+    RegisterPair(initiator, responder);
+
+    // An unanswered round is abandoned after a timeout, and its transactions go to the next one.
+    AddTxs(rng, 5, {&initiator});
+    auto request{initiator.InitiateReconciliationRequest(PEER, now)};
+    BOOST_REQUIRE(request);
+    BOOST_CHECK_EQUAL(request->first, 5);
+    AddTxs(rng, 1, {&initiator});
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(PEER, now + RECON_RESPONSE_TIMEOUT - 1us));
+    request = initiator.InitiateReconciliationRequest(PEER, now + RECON_RESPONSE_TIMEOUT);
+    BOOST_REQUIRE(request);
+    BOOST_CHECK_EQUAL(request->first, 6);
+
+    // The responder drops its round when a new request comes before it is finished, and keeps
+    // the transactions of the abandoned round.
+    const auto responder_wtxids{AddTxs(rng, 3, {&responder})};
+    BOOST_REQUIRE(responder.HandleReconciliationRequest(PEER, request->first, request->second, now + RECON_RESPONSE_TIMEOUT));
+    const auto round{Reconcile(initiator, responder, now + 2 * RECON_RESPONSE_TIMEOUT)};
+    BOOST_CHECK_EQUAL(round.initiator_announced.size(), 6);
+    BOOST_CHECK(round.responder_announced == std::set<uint256>(responder_wtxids.begin(), responder_wtxids.end()));
+}
+
+BOOST_AUTO_TEST_CASE(ReconciliationProtocolViolationTest)
+{
+    TxReconciliationTracker initiator(TXRECONCILIATION_VERSION), responder(TXRECONCILIATION_VERSION);
+    RegisterPair(initiator, responder);
+    const std::vector<uint8_t> sketch(4);
+
+    // Messages the peer should only send in its own role, or not before we asked.
+    BOOST_CHECK(!initiator.HandleReconciliationRequest(PEER, 0, 0, 1s));
+    BOOST_CHECK(!responder.InitiateReconciliationRequest(PEER, 1s));
+    BOOST_CHECK(responder.HandleSketch(PEER, sketch, 1s).action == TxReconciliationTracker::SketchResult::Action::PROTOCOL_VIOLATION);
+    BOOST_CHECK(initiator.HandleSketch(PEER, sketch, 1s).action == TxReconciliationTracker::SketchResult::Action::PROTOCOL_VIOLATION);
+    BOOST_CHECK(!initiator.HandleExtensionRequest(PEER));
+    BOOST_CHECK(!responder.HandleExtensionRequest(PEER));
+    BOOST_CHECK(!responder.HandleReconciliationDifference(PEER, true, {}));
+
+    // A sketch must hold whole elements.
+    BOOST_REQUIRE(initiator.InitiateReconciliationRequest(PEER, 1s));
+    BOOST_CHECK(initiator.HandleSketch(PEER, std::vector<uint8_t>(3), 1s).action == TxReconciliationTracker::SketchResult::Action::PROTOCOL_VIOLATION);
+
+    // Unregistered peers.
+    BOOST_CHECK(!initiator.AddToSet(/*peer_id=*/1, uint256::ONE));
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(/*peer_id=*/1, 1s));
+    BOOST_CHECK(!responder.HandleReconciliationRequest(/*peer_id=*/1, 0, 0, 1s));
+
+    // A new request too soon after the previous one.
+    BOOST_REQUIRE(responder.HandleReconciliationRequest(PEER, 0, 0, 1s));
+    BOOST_CHECK(!responder.HandleReconciliationRequest(PEER, 0, 0, 1s + RECON_REQUEST_INTERVAL - 1us));
+}
+
+BOOST_AUTO_TEST_CASE(ShouldFanoutToTest)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    TxReconciliationTracker initiator(TXRECONCILIATION_VERSION), responder(TXRECONCILIATION_VERSION);
+    RegisterPair(initiator, responder);
+
+    // Transactions are always flooded to peers we do not reconcile with.
+    BOOST_CHECK(initiator.ShouldFanoutTo(rng.rand256(), /*peer_id=*/1));
+
+    // Our only outbound reconciling peer gets every transaction; a share of inbound ones gets each.
+    size_t inbound_fanout{0};
+    for (int i = 0; i < 1000; ++i) {
+        const uint256 wtxid{rng.rand256()};
+        BOOST_CHECK(initiator.ShouldFanoutTo(wtxid, PEER));
+        const bool fanout{responder.ShouldFanoutTo(wtxid, PEER)};
+        BOOST_CHECK_EQUAL(responder.ShouldFanoutTo(wtxid, PEER), fanout);
+        inbound_fanout += fanout;
+    }
+    BOOST_CHECK(inbound_fanout > 50 && inbound_fanout < 150);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
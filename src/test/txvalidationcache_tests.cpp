@@ -162,6 +162,105 @@ static void ValidateCheckInputsForAllFlags(const CTransaction &tx, uint32_t fail
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(tx_precheck_script_cache, Dersig100Setup)
+{
+    // Scripts verified by PreCheckTransaction() outside of cs_main must be
+    // found in the script execution cache by the subsequent mempool checks.
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    const auto spend_output{[&](const COutPoint& prevout, CAmount value) {
+        CMutableTransaction spend;
+        spend.nVersion = 1;
+        spend.vin.resize(1);
+        spend.vin[0].prevout = prevout;
+        spend.vout.resize(1);
+        spend.vout[0].nValue = value;
+        spend.vout[0].scriptPubKey = scriptPubKey;
+        std::vector<unsigned char> vchSig;
+        uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+        BOOST_CHECK(coinbaseKey.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        spend.vin[0].scriptSig << vchSig;
+        return spend;
+    }};
+    // Check and submit a transaction the way the TX message handler does.
+    const auto process{[&](PreCheckedTransaction&& precheck) {
+        return WITH_LOCK(cs_main, return m_node.chainman->ProcessTransaction(std::move(precheck)));
+    }};
+    const auto precheck_and_process{[&](const CMutableTransaction& tx) {
+        PreCheckedTransaction precheck{MakeTransactionRef(tx), GetTime()};
+        m_node.chainman->PreCheckTransaction(precheck);
+        return process(std::move(precheck));
+    }};
+    CCoinsViewCache& coins_tip{*WITH_LOCK(cs_main, return &m_node.chainman->ActiveChainstate().CoinsTip())};
+    const auto coin_cached{[&](const COutPoint& outpoint) { return WITH_LOCK(cs_main, return coins_tip.HaveCoinInCache(outpoint)); }};
+    WITH_LOCK(cs_main, m_node.chainman->ActiveChainstate().ForceFlushStateToDisk());
+
+    const CMutableTransaction spend{spend_output(COutPoint{m_coinbase_txns[0]->GetHash(), 0}, 11 * CENT)};
+    CMutableTransaction bad_spend{spend};
+    bad_spend.vin[0].scriptSig = CScript() << std::vector<unsigned char>(71, 0x30);
+
+    // Script failures are reported like ProcessTransaction() would, and the
+    // coins looked up for them are not kept in the cache.
+    const auto bad_result{precheck_and_process(bad_spend)};
+    BOOST_CHECK(bad_result.m_result_type == MempoolAcceptResult::ResultType::INVALID);
+    BOOST_CHECK(bad_result.m_state.GetResult() == TxValidationResult::TX_CONSENSUS);
+    BOOST_CHECK(!coin_cached(spend.vin[0].prevout));
+
+    // So are failures of the cheap checks, which come first.
+    CMutableTransaction orphan{spend};
+    orphan.vin[0].prevout.n = 1;
+    BOOST_CHECK(precheck_and_process(orphan).m_state.GetResult() == TxValidationResult::TX_MISSING_INPUTS);
+
+    CMutableTransaction low_fee{spend};
+    low_fee.vout[0].nValue = m_coinbase_txns[0]->vout[0].nValue;
+    BOOST_CHECK_EQUAL(precheck_and_process(low_fee).m_state.GetRejectReason(), "min relay fee not met");
+    BOOST_CHECK(!coin_cached(spend.vin[0].prevout));
+
+    const CTransactionRef tx{MakeTransactionRef(spend)};
+    PreCheckedTransaction precheck{tx, GetTime()};
+    m_node.chainman->PreCheckTransaction(precheck);
+    {
+        LOCK(cs_main);
+        // A cache hit returns without queueing any script checks.
+        TxValidationState state;
+        PrecomputedTransactionData txdata;
+        std::vector<CScriptCheck> checks;
+        BOOST_CHECK(CheckInputScripts(*tx, state, coins_tip, STANDARD_SCRIPT_VERIFY_FLAGS, true, false, txdata, &checks));
+        BOOST_CHECK(checks.empty());
+    }
+    BOOST_CHECK(process(std::move(precheck)).m_result_type == MempoolAcceptResult::ResultType::VALID);
+
+    // Already in the mempool. The cached scripts leave the decision to ProcessTransaction().
+    BOOST_CHECK_EQUAL(precheck_and_process(spend).m_state.GetRejectReason(), "txn-already-in-mempool");
+
+    // A conflicting transaction enters the mempool between the checks and the
+    // submission, which then starts over instead of carrying on.
+    const COutPoint spend_output_0{tx->GetHash(), 0};
+    PreCheckedTransaction late{MakeTransactionRef(spend_output(spend_output_0, 10 * CENT)), GetTime()};
+    m_node.chainman->PreCheckTransaction(late);
+    const CMutableTransaction child{spend_output(spend_output_0, 9 * CENT)};
+    BOOST_CHECK(precheck_and_process(child).m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK_EQUAL(process(std::move(late)).m_state.GetRejectReason(), "txn-mempool-conflict");
+    BOOST_CHECK_EQUAL(WITH_LOCK(m_node.mempool->cs, return m_node.mempool->size()), 2U);
+
+    // In a batch, a transaction failing its scripts does not affect the others,
+    // and one spending an earlier transaction of the batch is left to
+    // ProcessTransaction().
+    const COutPoint child_output_0{child.GetHash(), 0};
+    CMutableTransaction bad_child_spend{spend_output(child_output_0, 8 * CENT)};
+    bad_child_spend.vin[0].scriptSig = CScript() << std::vector<unsigned char>(71, 0x30);
+    const CMutableTransaction child_spend{spend_output(child_output_0, 8 * CENT)};
+    std::vector<PreCheckedTransaction> batch;
+    batch.emplace_back(MakeTransactionRef(bad_child_spend), GetTime());
+    batch.emplace_back(MakeTransactionRef(child_spend), GetTime());
+    batch.emplace_back(MakeTransactionRef(spend_output(COutPoint{child_spend.GetHash(), 0}, 7 * CENT)), GetTime());
+    m_node.chainman->PreCheckTransactions(batch);
+    BOOST_CHECK(process(std::move(batch[0])).m_state.GetResult() == TxValidationResult::TX_CONSENSUS);
+    BOOST_CHECK(process(std::move(batch[1])).m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK(process(std::move(batch[2])).m_result_type == MempoolAcceptResult::ResultType::VALID);
+    BOOST_CHECK_EQUAL(WITH_LOCK(m_node.mempool->cs, return m_node.mempool->size()), 4U);
+}
+
 BOOST_FIXTURE_TEST_CASE(checkinputs_test, Dersig100Setup)
 {
     // Test that passing CheckInputScripts with one set of script flags doesn't imply
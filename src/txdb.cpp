@@ -14,6 +14,7 @@
 #include <uint256.h>
 #include <util/vector.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <iterator>
@@ -160,8 +161,8 @@ class CCoinsViewDBCursor: public CCoinsViewCursor
 public:
     // Prefer using CCoinsViewDB::Cursor() since we want to perform some
     // cache warmup on instantiation.
-    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256&hashBlockIn):
-        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
+    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256&hashBlockIn, unsigned int txid_prefix_end = 256):
+        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn), m_txid_prefix_end(txid_prefix_end) {}
     ~CCoinsViewDBCursor() = default;
 
     bool GetKey(COutPoint &key) const override;
@@ -173,6 +174,11 @@ public:
 private:
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
+    //! Iteration stops at the first txid whose leading byte is at least this
+    const unsigned int m_txid_prefix_end;
+
+    //! Cache the key of the current record, or invalidate the cursor if past the end
+    void CacheKey();
 
     friend class CCoinsViewDB;
 };
@@ -186,14 +192,46 @@ std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor() const
        that restriction.  */
     i->pcursor->Seek(DB_COIN);
     // Cache key of first record
-    if (i->pcursor->Valid()) {
-        CoinEntry entry(&i->keyTmp.second);
-        i->pcursor->GetKey(entry);
-        i->keyTmp.first = entry.key;
+    i->CacheKey();
+    return i;
+}
+
+std::vector<std::unique_ptr<CCoinsViewCursor>> CCoinsViewDB::ShardedCursors(unsigned int count) const
+{
+    count = std::clamp(count, 1U, 256U);
+    auto iterators{const_cast<CDBWrapper&>(*m_db).NewIterators(count)};
+
+    // Read the best block through the same database snapshot as the coins.
+    uint256 best_block;
+    uint8_t key{0};
+    iterators.front()->Seek(DB_BEST_BLOCK);
+    if (!iterators.front()->Valid() || !iterators.front()->GetKey(key) || key != DB_BEST_BLOCK ||
+        !iterators.front()->GetValue(best_block)) {
+        best_block.SetNull();
+    }
+
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    cursors.reserve(count);
+    for (unsigned int shard = 0; shard < count; ++shard) {
+        uint256 start;
+        *start.begin() = shard * 256 / count;
+        auto i = std::make_unique<CCoinsViewDBCursor>(
+            iterators[shard].release(), best_block, (shard + 1) * 256 / count);
+        i->pcursor->Seek(std::make_pair(DB_COIN, start));
+        i->CacheKey();
+        cursors.push_back(std::move(i));
+    }
+    return cursors;
+}
+
+void CCoinsViewDBCursor::CacheKey()
+{
+    CoinEntry entry(&keyTmp.second);
+    if (!pcursor->Valid() || !pcursor->GetKey(entry) || (entry.key == DB_COIN && *keyTmp.second.hash.begin() >= m_txid_prefix_end)) {
+        keyTmp.first = 0; // Make sure Valid() and GetKey() return false
     } else {
-        i->keyTmp.first = 0; // Make sure Valid() and GetKey() return false
+        keyTmp.first = entry.key;
     }
-    return i;
 }
 
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
@@ -219,10 +257,5 @@ bool CCoinsViewDBCursor::Valid() const
 void CCoinsViewDBCursor::Next()
 {
     pcursor->Next();
-    CoinEntry entry(&keyTmp.second);
-    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
-        keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
-    } else {
-        keyTmp.first = entry.key;
-    }
+    CacheKey();
 }
@@ -65,6 +65,8 @@ public:
     std::vector<uint256> GetHeadBlocks() const override;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
+    //! Shards are split by the leading byte of the txid, so at most 256 are returned.
+    std::vector<std::unique_ptr<CCoinsViewCursor>> ShardedCursors(unsigned int count) const override;
 
     //! Whether an unsupported database format is used.
     bool NeedsUpgrade();
@@ -25,7 +25,10 @@
 #include <util/translation.h>
 #include <validationinterface.h>
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <memory>
 #include <numeric>
 #include <optional>
 #include <string_view>
@@ -51,8 +54,8 @@ bool TestLockPointValidity(CChain& active_chain, const LockPoints& lp)
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap& cachedDescendants,
                                       const std::set<uint256>& setExclude, std::set<uint256>& descendants_to_remove)
 {
-    CTxMemPoolEntry::Children stageEntries, descendants;
-    stageEntries = updateIt->GetMemPoolChildrenConst();
+    setEntryRefs stageEntries, descendants;
+    stageEntries.insert(updateIt->GetMemPoolChildrenConst().begin(), updateIt->GetMemPoolChildrenConst().end());
 
     while (!stageEntries.empty()) {
         const CTxMemPoolEntry& descendant = *stageEntries.begin();
@@ -157,7 +160,7 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256>& vHashes
 util::Result<CTxMemPool::setEntries> CTxMemPool::CalculateAncestorsAndCheckLimits(
     int64_t entry_size,
     size_t entry_count,
-    CTxMemPoolEntry::Parents& staged_ancestors,
+    setEntryRefs& staged_ancestors,
     const Limits& limits) const
 {
     int64_t totalSizeWithAncestors = entry_size;
@@ -193,6 +196,31 @@ util::Result<CTxMemPool::setEntries> CTxMemPool::CalculateAncestorsAndCheckLimit
         }
     }
 
+    if (m_cluster_mempool && limits.cluster_count < std::numeric_limits<int64_t>::max()) {
+        // The entries join the clusters of their ancestors. Walk those clusters,
+        // stopping as soon as they are known to be too large.
+        WITH_FRESH_EPOCH(m_epoch);
+        std::vector<txiter> cluster;
+        for (const txiter& it : ancestors) {
+            visited(it);
+            cluster.push_back(it);
+        }
+        for (size_t i{0}; i < cluster.size(); ++i) {
+            if (cluster.size() + entry_count > static_cast<uint64_t>(limits.cluster_count)) {
+                return util::Error{Untranslated(strprintf("too many transactions in cluster [limit: %u]", limits.cluster_count))};
+            }
+            for (const auto& entries : {cluster[i]->GetMemPoolParentsConst(), cluster[i]->GetMemPoolChildrenConst()}) {
+                for (const CTxMemPoolEntry& entry : entries) {
+                    const txiter entry_it{mapTx.iterator_to(entry)};
+                    if (!visited(entry_it)) cluster.push_back(entry_it);
+                }
+            }
+        }
+        if (cluster.size() + entry_count > static_cast<uint64_t>(limits.cluster_count)) {
+            return util::Error{Untranslated(strprintf("too many transactions in cluster [limit: %u]", limits.cluster_count))};
+        }
+    }
+
     return ancestors;
 }
 
@@ -217,7 +245,7 @@ bool CTxMemPool::CheckPackageLimits(const Package& package,
         return false;
     }
 
-    CTxMemPoolEntry::Parents staged_ancestors;
+    setEntryRefs staged_ancestors;
     for (const auto& tx : package) {
         for (const auto& input : tx->vin) {
             std::optional<txiter> piter = GetIter(input.prevout.hash);
@@ -245,7 +273,7 @@ util::Result<CTxMemPool::setEntries> CTxMemPool::CalculateMemPoolAncestors(
     const Limits& limits,
     bool fSearchForParents /* = true */) const
 {
-    CTxMemPoolEntry::Parents staged_ancestors;
+    setEntryRefs staged_ancestors;
     const CTransaction &tx = entry.GetTx();
 
     if (fSearchForParents) {
@@ -265,7 +293,7 @@ util::Result<CTxMemPool::setEntries> CTxMemPool::CalculateMemPoolAncestors(
         // If we're not searching for parents, we require this to already be an
         // entry in the mempool and use the entry's cached parents.
         txiter it = mapTx.iterator_to(entry);
-        staged_ancestors = it->GetMemPoolParentsConst();
+        staged_ancestors.insert(it->GetMemPoolParentsConst().begin(), it->GetMemPoolParentsConst().end());
     }
 
     return CalculateAncestorsAndCheckLimits(entry.GetTxSize(), /*entry_count=*/1, staged_ancestors,
@@ -412,6 +440,8 @@ CTxMemPool::CTxMemPool(const Options& opts)
       m_max_datacarrier_bytes{opts.max_datacarrier_bytes},
       m_require_standard{opts.require_standard},
       m_full_rbf{opts.full_rbf},
+      m_cluster_mempool{opts.cluster_mempool},
+      m_persist_v1_dat{opts.persist_v1_dat},
       m_limits{opts.limits}
 {
 }
@@ -483,6 +513,9 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     vTxHashes.emplace_back(tx.GetWitnessHash(), newit);
     newit->vTxHashesIdx = vTxHashes.size() - 1;
 
+    // Callers hand out the current sequence value for the addition right after.
+    RecordChange(m_sequence_number, tx.GetHash(), /*added=*/true);
+
     TRACE3(mempool, added,
         entry.GetTx().GetHash().data(),
         entry.GetTxSize(),
@@ -490,6 +523,41 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     );
 }
 
+void CTxMemPool::RecordChange(uint64_t sequence, const uint256& txid, bool added)
+{
+    AssertLockHeld(cs);
+    m_changes.push_back({sequence, txid, added});
+    if (m_changes.size() > MAX_MEMPOOL_SEQUENCED_CHANGES) {
+        m_changes_start = m_changes.front().sequence + 1;
+        m_changes.pop_front();
+    }
+}
+
+std::optional<CTxMemPool::SequenceDelta> CTxMemPool::GetChangesSince(uint64_t since_sequence) const
+{
+    AssertLockHeld(cs);
+    if (since_sequence < m_changes_start || since_sequence > m_sequence_number) return std::nullopt;
+
+    // A transaction may have come and gone several times, only its first and
+    // last change matter.
+    std::map<uint256, std::pair<bool, bool>> first_last;
+    auto it = std::lower_bound(m_changes.begin(), m_changes.end(), since_sequence,
+                               [](const SequencedChange& change, uint64_t seq) { return change.sequence < seq; });
+    for (; it != m_changes.end(); ++it) {
+        auto [entry, inserted] = first_last.try_emplace(it->txid, it->added, it->added);
+        if (!inserted) entry->second.second = it->added;
+    }
+
+    SequenceDelta delta;
+    delta.sequence = m_sequence_number;
+    for (const auto& [txid, change] : first_last) {
+        const auto& [first_added, last_added] = change;
+        if (first_added && last_added) delta.added.push_back(txid);
+        if (!first_added && !last_added) delta.removed.push_back(txid);
+    }
+    return delta;
+}
+
 void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 {
     // We increment mempool sequence value no matter removal reason
@@ -512,6 +580,8 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     );
 
     const uint256 hash = it->GetTx().GetHash();
+    RecordChange(mempool_sequence, hash, /*added=*/false);
+    InvalidateLinearization(it);
     for (const CTxIn& txin : it->GetTx().vin)
         mapNextTx.erase(txin.prevout);
 
@@ -529,7 +599,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     totalTxSize -= it->GetTxSize();
     m_total_fee -= it->GetFee();
     cachedInnerUsage -= it->DynamicMemoryUsage();
-    cachedInnerUsage -= memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
+    cachedInnerUsage -= it->GetMemPoolParentsConst().DynamicMemoryUsage() + it->GetMemPoolChildrenConst().DynamicMemoryUsage();
     mapTx.erase(it);
     nTransactionsUpdated++;
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
@@ -649,21 +719,98 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
     }
     // Before the txs in the new block have been removed from the mempool, update policy estimates
     if (minerPolicyEstimator) {minerPolicyEstimator->processBlock(nBlockHeight, entries);}
-    for (const auto& tx : vtx)
-    {
-        txiter it = mapTx.find(tx->GetHash());
-        if (it != mapTx.end()) {
-            setEntries stage;
-            stage.insert(it);
-            RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
+    std::vector<txiter> confirmed;
+    confirmed.reserve(entries.size());
+    for (const CTxMemPoolEntry* entry : entries) confirmed.push_back(mapTx.iterator_to(*entry));
+    if (RemoveConfirmed(confirmed)) {
+        for (const auto& tx : vtx) {
+            removeConflicts(*tx);
+            ClearPrioritisation(tx->GetHash());
+        }
+    } else {
+        for (const auto& tx : vtx)
+        {
+            txiter it = mapTx.find(tx->GetHash());
+            if (it != mapTx.end()) {
+                setEntries stage;
+                stage.insert(it);
+                RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
+            }
+            removeConflicts(*tx);
+            ClearPrioritisation(tx->GetHash());
         }
-        removeConflicts(*tx);
-        ClearPrioritisation(tx->GetHash());
     }
     lastRollingFeeUpdate = GetTime();
     blockSinceLastRollingFeeBump = true;
 }
 
+bool CTxMemPool::RemoveConfirmed(const std::vector<txiter>& confirmed)
+{
+    AssertLockHeld(cs);
+    const setEntries confirmed_set(confirmed.begin(), confirmed.end());
+    for (const txiter& it : confirmed) {
+        for (const CTxMemPoolEntry& parent : it->GetMemPoolParentsConst()) {
+            if (!confirmed_set.count(mapTx.iterator_to(parent))) return false;
+        }
+    }
+
+    // Collect all remaining descendants of the confirmed entries.
+    std::vector<txiter> remaining;
+    {
+        WITH_FRESH_EPOCH(m_epoch);
+        for (const txiter& it : confirmed) visited(it);
+        for (const txiter& it : confirmed) {
+            for (const CTxMemPoolEntry& child : it->GetMemPoolChildrenConst()) {
+                const txiter child_it{mapTx.iterator_to(child)};
+                if (!visited(child_it)) remaining.push_back(child_it);
+            }
+        }
+        for (size_t i{0}; i < remaining.size(); ++i) {
+            for (const CTxMemPoolEntry& child : remaining[i]->GetMemPoolChildrenConst()) {
+                const txiter child_it{mapTx.iterator_to(child)};
+                if (!visited(child_it)) remaining.push_back(child_it);
+            }
+        }
+    }
+
+    // Subtract the confirmed ancestors of each remaining descendant in one update.
+    std::vector<txiter> ancestors;
+    for (const txiter& it : remaining) {
+        WITH_FRESH_EPOCH(m_epoch);
+        int32_t modify_size{0};
+        CAmount modify_fee{0};
+        int64_t modify_count{0};
+        int64_t modify_sigops{0};
+        ancestors.assign(1, it);
+        for (size_t i{0}; i < ancestors.size(); ++i) {
+            for (const CTxMemPoolEntry& parent : ancestors[i]->GetMemPoolParentsConst()) {
+                const txiter parent_it{mapTx.iterator_to(parent)};
+                if (visited(parent_it)) continue;
+                ancestors.push_back(parent_it);
+                if (confirmed_set.count(parent_it)) {
+                    modify_size -= parent_it->GetTxSize();
+                    modify_fee -= parent_it->GetModifiedFee();
+                    modify_count -= 1;
+                    modify_sigops -= parent_it->GetSigOpCost();
+                }
+            }
+        }
+        mapTx.modify(it, [=](CTxMemPoolEntry& e) { e.UpdateAncestorState(modify_size, modify_fee, modify_count, modify_sigops); });
+    }
+
+    // Sever the links to the confirmed entries, then remove them.
+    for (const txiter& it : confirmed) {
+        for (const CTxMemPoolEntry& parent : it->GetMemPoolParentsConst()) {
+            UpdateChild(mapTx.iterator_to(parent), it, false);
+        }
+        UpdateChildrenForRemoval(it);
+    }
+    for (const txiter& it : confirmed) {
+        removeUnchecked(it, MemPoolRemovalReason::BLOCK);
+    }
+    return true;
+}
+
 void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendheight) const
 {
     if (m_check_ratio == 0) return;
@@ -686,8 +833,8 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
         check_total_fee += it->GetFee();
         innerUsage += it->DynamicMemoryUsage();
         const CTransaction& tx = it->GetTx();
-        innerUsage += memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
-        CTxMemPoolEntry::Parents setParentCheck;
+        innerUsage += it->GetMemPoolParentsConst().DynamicMemoryUsage() + it->GetMemPoolChildrenConst().DynamicMemoryUsage();
+        setEntryRefs setParentCheck;
         for (const CTxIn &txin : tx.vin) {
             // Check that every mempool transaction's inputs refer to available coins, or other mempool tx's.
             indexed_transaction_set::const_iterator it2 = mapTx.find(txin.prevout.hash);
@@ -733,7 +880,7 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
         prev_ancestor_count = it->GetCountWithAncestors();
 
         // Check children against mapNextTx
-        CTxMemPoolEntry::Children setChildrenCheck;
+        setEntryRefs setChildrenCheck;
         auto iter = mapNextTx.lower_bound(COutPoint(it->GetTx().GetHash(), 0));
         int32_t child_sizes{0};
         for (; iter != mapNextTx.end() && iter->first->hash == it->GetTx().GetHash(); ++iter) {
@@ -819,6 +966,20 @@ std::vector<CTxMemPool::indexed_transaction_set::const_iterator> CTxMemPool::Get
     return iters;
 }
 
+std::vector<CTxMemPool::txiter> CTxMemPool::GetSortedByAncestorScore() const
+{
+    AssertLockHeld(cs);
+    std::vector<txiter> iters;
+    iters.reserve(mapTx.size());
+    for (txiter it = mapTx.begin(); it != mapTx.end(); ++it) {
+        iters.push_back(it);
+    }
+    std::sort(iters.begin(), iters.end(), [](txiter a, txiter b) {
+        return CompareTxMemPoolEntryByAncestorFee()(*a, *b);
+    });
+    return iters;
+}
+
 void CTxMemPool::queryHashes(std::vector<uint256>& vtxid) const
 {
     LOCK(cs);
@@ -900,6 +1061,7 @@ void CTxMemPool::PrioritiseTransaction(const uint256& hash, const CAmount& nFeeD
         txiter it = mapTx.find(hash);
         if (it != mapTx.end()) {
             mapTx.modify(it, [&nFeeDelta](CTxMemPoolEntry& e) { e.UpdateModifiedFee(nFeeDelta); });
+            InvalidateLinearization(it);
             // Now update all ancestors' modified fees with descendants
             auto ancestors{AssumeCalculateMemPoolAncestors(__func__, *it, Limits::NoLimits(), /*fSearchForParents=*/false)};
             for (txiter ancestorIt : ancestors) {
@@ -1044,8 +1206,8 @@ void CCoinsViewMemPool::Reset()
 
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    // Estimate the overhead of mapTx to be 12 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
+    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 12 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
 }
 
 void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked) {
@@ -1091,22 +1253,26 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, bool validFeeEstimat
 void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
 {
     AssertLockHeld(cs);
-    CTxMemPoolEntry::Children s;
-    if (add && entry->GetMemPoolChildren().insert(*child).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && entry->GetMemPoolChildren().erase(*child)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    CTxMemPoolEntry::Children& s = entry->GetMemPoolChildren();
+    const size_t usage_before{s.DynamicMemoryUsage()};
+    if (add ? s.insert(*child) : s.erase(*child)) {
+        cachedInnerUsage += s.DynamicMemoryUsage();
+        cachedInnerUsage -= usage_before;
+        InvalidateLinearization(entry);
+        InvalidateLinearization(child);
     }
 }
 
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
 {
     AssertLockHeld(cs);
-    CTxMemPoolEntry::Parents s;
-    if (add && entry->GetMemPoolParents().insert(*parent).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && entry->GetMemPoolParents().erase(*parent)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    CTxMemPoolEntry::Parents& s = entry->GetMemPoolParents();
+    const size_t usage_before{s.DynamicMemoryUsage()};
+    if (add ? s.insert(*parent) : s.erase(*parent)) {
+        cachedInnerUsage += s.DynamicMemoryUsage();
+        cachedInnerUsage -= usage_before;
+        InvalidateLinearization(entry);
+        InvalidateLinearization(parent);
     }
 }
 
@@ -1150,17 +1316,29 @@ void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpends
     while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
         indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
 
+        // In cluster mode, evict the worst chunk of the cluster containing the
+        // transaction with the worst descendant score. That chunk has no
+        // descendants outside of itself and its feerate is at most that of the
+        // descendant package.
+        std::vector<Chunk> chunks;
+        if (m_cluster_mempool) chunks = LinearizeCluster(mapTx.project<0>(it));
+
         // We set the new mempool min fee to the feerate of the removed set, plus the
         // "minimum reasonable fee rate" (ie some value under which we consider txn
         // to have 0 fee). This way, we don't allow txn to enter mempool with feerate
         // equal to txn which were removed with no block in between.
-        CFeeRate removed(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
+        CFeeRate removed = chunks.empty() ? CFeeRate(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants()) :
+                                            CFeeRate(chunks.back().fee, chunks.back().vsize);
         removed += m_incremental_relay_feerate;
         trackPackageRemoved(removed);
         maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
 
         setEntries stage;
-        CalculateDescendants(mapTx.project<0>(it), stage);
+        if (chunks.empty()) {
+            CalculateDescendants(mapTx.project<0>(it), stage);
+        } else {
+            stage.insert(chunks.back().txs.begin(), chunks.back().txs.end());
+        }
         nTxnRemoved += stage.size();
 
         std::vector<CTransaction> txn;
@@ -1257,3 +1435,114 @@ std::vector<CTxMemPool::txiter> CTxMemPool::GatherClusters(const std::vector<uin
     }
     return clustered_txs;
 }
+
+bool FeeRateHigher(CAmount fee_a, int64_t size_a, CAmount fee_b, int64_t size_b)
+{
+#ifdef __SIZEOF_INT128__
+    return __int128{fee_a} * size_b > __int128{fee_b} * size_a;
+#else
+    // Split the fees into 32-bit halves so that both partial products fit in 64 bits,
+    // and compare the products as (high, low) pairs.
+    const auto mul{[](CAmount fee, int64_t size) {
+        const int64_t high{(fee >> 32) * size};
+        const uint64_t low{uint64_t{uint32_t(fee)} * uint64_t(size)};
+        return std::make_pair(high + int64_t(low >> 32), uint32_t(low));
+    }};
+    return mul(fee_a, size_b) > mul(fee_b, size_a);
+#endif
+}
+
+void CTxMemPool::InvalidateLinearization(txiter it)
+{
+    AssertLockHeld(cs);
+    const auto cached{m_linearizations.find(it)};
+    if (cached == m_linearizations.end()) return;
+    const std::shared_ptr<const std::vector<Chunk>> chunks{cached->second};
+    for (const Chunk& chunk : *chunks) {
+        for (const txiter& member : chunk.txs) m_linearizations.erase(member);
+    }
+}
+
+const std::vector<CTxMemPool::Chunk>& CTxMemPool::LinearizeCluster(txiter tx) const
+{
+    AssertLockHeld(cs);
+    if (const auto cached{m_linearizations.find(tx)}; cached != m_linearizations.end()) return *cached->second;
+
+    static const std::vector<Chunk> TOO_LARGE;
+    const std::vector<txiter> cluster{GatherClusters({tx->GetTx().GetHash()})};
+    if (cluster.empty()) return TOO_LARGE;
+
+    // Fee and size of the ancestor set of each transaction, excluding ancestors that
+    // have already been linearized. Clusters are closed, so the cached ancestor state
+    // is exact to begin with.
+    struct Candidate {
+        CAmount fee;
+        int64_t vsize;
+        bool done{false};
+    };
+    std::map<txiter, Candidate, CompareIteratorByHash> candidates;
+    for (const txiter& it : cluster) {
+        candidates.emplace(it, Candidate{it->GetModFeesWithAncestors(), it->GetSizeWithAncestors()});
+    }
+
+    std::vector<txiter> linearization;
+    linearization.reserve(cluster.size());
+    while (linearization.size() < cluster.size()) {
+        // Pick the remaining ancestor set with the highest feerate.
+        auto best{candidates.end()};
+        for (auto c{candidates.begin()}; c != candidates.end(); ++c) {
+            if (c->second.done) continue;
+            if (best == candidates.end() || FeeRateHigher(c->second.fee, c->second.vsize, best->second.fee, best->second.vsize)) {
+                best = c;
+            }
+        }
+
+        // Collect its remaining ancestors, and order them topologically.
+        std::vector<txiter> package{best->first};
+        best->second.done = true;
+        for (size_t i{0}; i < package.size(); ++i) {
+            for (const CTxMemPoolEntry& parent : package[i]->GetMemPoolParentsConst()) {
+                auto& candidate{candidates.at(mapTx.iterator_to(parent))};
+                if (candidate.done) continue;
+                candidate.done = true;
+                package.push_back(mapTx.iterator_to(parent));
+            }
+        }
+        std::sort(package.begin(), package.end(), [](const txiter& a, const txiter& b) {
+            return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+        });
+        linearization.insert(linearization.end(), package.begin(), package.end());
+
+        // Remove the package from the ancestor state of the remaining descendants.
+        for (const txiter& it : package) {
+            setEntries descendants;
+            CalculateDescendants(it, descendants);
+            for (const txiter& desc : descendants) {
+                auto& candidate{candidates.at(desc)};
+                if (candidate.done) continue;
+                candidate.fee -= it->GetModifiedFee();
+                candidate.vsize -= it->GetTxSize();
+            }
+        }
+    }
+
+    // Merge each transaction into the preceding chunks as long as that raises their feerate.
+    auto result{std::make_shared<std::vector<Chunk>>()};
+    std::vector<Chunk>& chunks{*result};
+    for (const txiter& it : linearization) {
+        chunks.push_back(Chunk{{it}, it->GetModifiedFee(), it->GetTxSize()});
+        while (chunks.size() > 1) {
+            Chunk& last{chunks.back()};
+            Chunk& prev{chunks[chunks.size() - 2]};
+            if (!FeeRateHigher(last.fee, last.vsize, prev.fee, prev.vsize)) break;
+            prev.txs.insert(prev.txs.end(), last.txs.begin(), last.txs.end());
+            prev.fee += last.fee;
+            prev.vsize += last.vsize;
+            chunks.pop_back();
+        }
+    }
+
+    // Share the result between all members of the cluster until any of them changes.
+    for (const txiter& it : cluster) m_linearizations.emplace(it, result);
+    return chunks;
+}
@@ -31,7 +31,9 @@
 #include <boost/multi_index_container.hpp>
 
 #include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
 #include <optional>
 #include <set>
 #include <string>
@@ -44,11 +46,18 @@ class CChain;
 /** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
 static const uint32_t MEMPOOL_HEIGHT = 0x7FFFFFFF;
 
+/** Number of mempool additions and removals remembered for CTxMemPool::GetChangesSince() */
+static constexpr size_t MAX_MEMPOOL_SEQUENCED_CHANGES{100000};
+
 /**
  * Test whether the LockPoints height and time are still valid on the current chain
  */
 bool TestLockPointValidity(CChain& active_chain, const LockPoints& lp) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** Whether the feerate fee_a / size_a is higher than fee_b / size_b, compared exactly by
+ * cross-multiplication. Sizes must be positive and below 2^31. */
+bool FeeRateHigher(CAmount fee_a, int64_t size_a, CAmount fee_b, int64_t size_b);
+
 // extracts a transaction hash from CTxMemPoolEntry or CTransactionRef
 struct mempoolentry_txid
 {
@@ -240,12 +249,16 @@ struct TxMempoolInfo
  *
  * CTxMemPool::mapTx, and CTxMemPoolEntry bookkeeping:
  *
- * mapTx is a boost::multi_index that sorts the mempool on 5 criteria:
+ * mapTx is a boost::multi_index that sorts the mempool on 4 criteria:
  * - transaction hash (txid)
  * - witness-transaction hash (wtxid)
  * - descendant feerate [we use max(feerate of tx, feerate of tx with all descendants)]
  * - time in mempool
- * - ancestor feerate [we use min(feerate of tx, feerate of tx with all unconfirmed ancestors)]
+ *
+ * Ancestor feerate [we use min(feerate of tx, feerate of tx with all
+ * unconfirmed ancestors)] is only needed when assembling a block, so rather
+ * than maintaining a fifth index on every change, GetSortedByAncestorScore()
+ * builds that order on demand.
  *
  * Note: the term "descendant" refers to in-mempool transactions that depend on
  * this one, while "ancestor" refers to in-mempool transactions that a given
@@ -319,6 +332,19 @@ protected:
     // is added or removed from the mempool for any reason.
     mutable uint64_t m_sequence_number GUARDED_BY(cs){1};
 
+    /** An addition or removal of a transaction, tagged with its mempool sequence value. */
+    struct SequencedChange {
+        uint64_t sequence;
+        uint256 txid;
+        bool added;
+    };
+    /** Recent additions and removals in sequence order, see GetChangesSince(). */
+    std::deque<SequencedChange> m_changes GUARDED_BY(cs);
+    /** Lowest sequence value from which m_changes holds all changes. */
+    uint64_t m_changes_start GUARDED_BY(cs){1};
+
+    void RecordChange(uint64_t sequence, const uint256& txid, bool added) EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     void trackPackageRemoved(const CFeeRate& rate) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     bool m_load_tried GUARDED_BY(cs){false};
@@ -351,12 +377,6 @@ public:
                 boost::multi_index::tag<entry_time>,
                 boost::multi_index::identity<CTxMemPoolEntry>,
                 CompareTxMemPoolEntryByEntryTime
-            >,
-            // sorted by fee rate with ancestors
-            boost::multi_index::ordered_non_unique<
-                boost::multi_index::tag<ancestor_score>,
-                boost::multi_index::identity<CTxMemPoolEntry>,
-                CompareTxMemPoolEntryByAncestorFee
             >
         >
     > indexed_transaction_set;
@@ -395,6 +415,8 @@ public:
     std::vector<std::pair<uint256, txiter>> vTxHashes GUARDED_BY(cs); //!< All tx witness hashes/entries in mapTx, in random order
 
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
+    /** Work set of entries used while walking parent/child links */
+    typedef std::set<CTxMemPoolEntry::CTxMemPoolEntryRef, CompareIteratorByHash> setEntryRefs;
 
     using Limits = kernel::MemPoolLimits;
 
@@ -427,7 +449,7 @@ private:
      */
     util::Result<setEntries> CalculateAncestorsAndCheckLimits(int64_t entry_size,
                                                               size_t entry_count,
-                                                              CTxMemPoolEntry::Parents &staged_ancestors,
+                                                              setEntryRefs& staged_ancestors,
                                                               const Limits& limits
                                                               ) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
@@ -446,6 +468,8 @@ public:
     const std::optional<unsigned> m_max_datacarrier_bytes;
     const bool m_require_standard;
     const bool m_full_rbf;
+    const bool m_cluster_mempool;
+    const bool m_persist_v1_dat;
 
     const Limits m_limits;
 
@@ -597,6 +621,24 @@ public:
      * more transactions as a DoS protection. */
     std::vector<txiter> GatherClusters(const std::vector<uint256>& txids) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /** A set of transactions from one cluster that is included in a block, or evicted, as a whole. */
+    struct Chunk {
+        /** The transactions, in an order that is valid for a block. */
+        std::vector<txiter> txs;
+        /** Sum of modified fees. */
+        CAmount fee{0};
+        /** Sum of virtual sizes. */
+        int64_t vsize{0};
+    };
+
+    /** Linearize the cluster containing tx by repeatedly taking the remaining ancestor set with the
+     * highest modified feerate, and split the result into chunks of non-increasing feerate. Every
+     * prefix of the returned chunks is closed under ancestors, and the last chunk under descendants.
+     * The result is cached for the whole cluster until a transaction is added to or removed from it,
+     * or one of its fees is prioritised, and the returned reference is only valid until then.
+     * Returns an empty vector if the cluster is too large, see GatherClusters(). */
+    const std::vector<Chunk>& LinearizeCluster(txiter tx) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     /** Calculate all in-mempool ancestors of a set of transactions not already in the mempool and
      * check ancestor and descendant limits. Heuristics are used to estimate the ancestor and
      * descendant count of all entries if the package were to be added to the mempool.  The limits
@@ -618,6 +660,10 @@ public:
      *  already in it.  */
     void CalculateDescendants(txiter it, setEntries& setDescendants) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /** All entries, best ancestor feerate first (see CompareTxMemPoolEntryByAncestorFee).
+     *  Built on each call; used by block assembly instead of a permanent index. */
+    std::vector<txiter> GetSortedByAncestorScore() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
     /** The minimum fee to get into the mempool, which may itself not be enough
      *  for larger-sized transactions.
      *  The m_incremental_relay_feerate policy variable is used to bound the time it
@@ -735,6 +781,24 @@ public:
         return m_sequence_number;
     }
 
+    /** Net change of the set of mempool transactions between two sequence values. */
+    struct SequenceDelta {
+        /** Transactions added since, and still in the mempool. */
+        std::vector<uint256> added;
+        /** Transactions that were in the mempool at the start and are gone. */
+        std::vector<uint256> removed;
+        /** The current sequence value, to ask for the next delta with. */
+        uint64_t sequence;
+    };
+
+    /**
+     * Return the transactions added and removed since the mempool sequence
+     * value was `since_sequence`, as returned by GetSequence() or reported by
+     * the ZMQ sequence notifier. Returns std::nullopt if `since_sequence` is in
+     * the future or older than the bounded history of changes that is kept.
+     */
+    std::optional<SequenceDelta> GetChangesSince(uint64_t since_sequence) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
 private:
     /** UpdateForDescendants is used by UpdateTransactionsFromBlock to update
      *  the descendants for a single transaction that has been added to the
@@ -786,6 +850,17 @@ private:
      *  removal.
      */
     void removeUnchecked(txiter entry, MemPoolRemovalReason reason) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Remove the given entries, which were confirmed in a block, in one batch.
+     *  Returns false without changing anything if they are not closed under
+     *  in-mempool ancestors. Since none of them can then be a descendant of a
+     *  remaining entry, only the ancestor state of their remaining descendants
+     *  needs updating, which is done once per remaining descendant. */
+    bool RemoveConfirmed(const std::vector<txiter>& confirmed) EXCLUSIVE_LOCKS_REQUIRED(cs) LOCKS_EXCLUDED(m_epoch);
+
+    /** Linearizations computed by LinearizeCluster(), shared by all members of each cluster. */
+    mutable std::map<txiter, std::shared_ptr<const std::vector<Chunk>>, CompareIteratorByHash> m_linearizations GUARDED_BY(cs);
+    /** Drop the cached linearization of the cluster containing it, if any. */
+    void InvalidateLinearization(txiter it) EXCLUSIVE_LOCKS_REQUIRED(cs);
 public:
     /** visited marks a CTxMemPoolEntry as having been traversed
      * during the lifetime of the most recently created Epoch::Guard
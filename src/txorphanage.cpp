@@ -8,12 +8,11 @@
 #include <logging.h>
 #include <policy/policy.h>
 
+#include <algorithm>
 #include <cassert>
 
 /** Expiration time for orphan transactions in seconds */
 static constexpr int64_t ORPHAN_TX_EXPIRE_TIME = 20 * 60;
-/** Minimum time between orphan transactions expire time checks in seconds */
-static constexpr int64_t ORPHAN_TX_EXPIRE_INTERVAL = 5 * 60;
 
 
 bool TxOrphanage::AddTx(const CTransactionRef& tx, NodeId peer)
@@ -39,9 +38,20 @@ bool TxOrphanage::AddTx(const CTransactionRef& tx, NodeId peer)
         return false;
     }
 
-    auto ret = m_orphans.emplace(hash, OrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, m_orphan_list.size()});
+    // Make room within the peer's quota by dropping its oldest orphans
+    for (auto peer_it = m_peer_orphans.find(peer);
+         peer_it != m_peer_orphans.end() && peer_it->second.weight + sz > MAX_ORPHAN_WEIGHT_PER_PEER;
+         peer_it = m_peer_orphans.find(peer)) {
+        EraseTxNoLock(peer_it->second.orphans.front());
+    }
+    auto& peer_orphans = m_peer_orphans[peer];
+
+    auto ret = m_orphans.emplace(hash, OrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, sz, {}, {}});
     assert(ret.second);
-    m_orphan_list.push_back(ret.first);
+    ret.first->second.age_pos = m_orphans_by_age.insert(m_orphans_by_age.end(), ret.first);
+    ret.first->second.peer_pos = peer_orphans.orphans.insert(peer_orphans.orphans.end(), ret.first);
+    m_total_weight += sz;
+    UpdatePeerWeight(peer, peer_orphans, sz);
     // Allow for lookups in the orphan pool by wtxid, as well as txid
     m_wtxid_to_orphan_it.emplace(tx->GetWitnessHash(), ret.first);
     for (const CTxIn& txin : tx->vin) {
@@ -65,6 +75,13 @@ int TxOrphanage::EraseTxNoLock(const uint256& txid)
     std::map<uint256, OrphanTx>::iterator it = m_orphans.find(txid);
     if (it == m_orphans.end())
         return 0;
+    EraseTxNoLock(it);
+    return 1;
+}
+
+void TxOrphanage::EraseTxNoLock(OrphanMap::iterator it)
+{
+    AssertLockHeld(m_mutex);
     for (const CTxIn& txin : it->second.tx->vin)
     {
         auto itPrev = m_outpoint_to_orphan_it.find(txin.prevout);
@@ -75,22 +92,27 @@ int TxOrphanage::EraseTxNoLock(const uint256& txid)
             m_outpoint_to_orphan_it.erase(itPrev);
     }
 
-    size_t old_pos = it->second.list_pos;
-    assert(m_orphan_list[old_pos] == it);
-    if (old_pos + 1 != m_orphan_list.size()) {
-        // Unless we're deleting the last entry in m_orphan_list, move the last
-        // entry to the position we're deleting.
-        auto it_last = m_orphan_list.back();
-        m_orphan_list[old_pos] = it_last;
-        it_last->second.list_pos = old_pos;
-    }
+    m_orphans_by_age.erase(it->second.age_pos);
+    auto peer_it = m_peer_orphans.find(it->second.fromPeer);
+    assert(peer_it != m_peer_orphans.end());
+    peer_it->second.orphans.erase(it->second.peer_pos);
+    UpdatePeerWeight(peer_it->first, peer_it->second, -it->second.weight);
+    if (peer_it->second.orphans.empty()) m_peer_orphans.erase(peer_it);
+    m_total_weight -= it->second.weight;
+
     const auto& wtxid = it->second.tx->GetWitnessHash();
-    LogPrint(BCLog::TXPACKAGES, "   removed orphan tx %s (wtxid=%s)\n", txid.ToString(), wtxid.ToString());
-    m_orphan_list.pop_back();
-    m_wtxid_to_orphan_it.erase(it->second.tx->GetWitnessHash());
+    LogPrint(BCLog::TXPACKAGES, "   removed orphan tx %s (wtxid=%s)\n", it->first.ToString(), wtxid.ToString());
+    m_wtxid_to_orphan_it.erase(wtxid);
 
     m_orphans.erase(it);
-    return 1;
+}
+
+void TxOrphanage::UpdatePeerWeight(NodeId peer, PeerOrphans& info, int64_t delta)
+{
+    AssertLockHeld(m_mutex);
+    if (info.weight > 0) m_peers_by_weight.erase({info.weight, peer});
+    info.weight += delta;
+    if (info.weight > 0) m_peers_by_weight.emplace(info.weight, peer);
 }
 
 void TxOrphanage::EraseForPeer(NodeId peer)
@@ -100,49 +122,32 @@ void TxOrphanage::EraseForPeer(NodeId peer)
     m_peer_work_set.erase(peer);
 
     int nErased = 0;
-    std::map<uint256, OrphanTx>::iterator iter = m_orphans.begin();
-    while (iter != m_orphans.end())
-    {
-        std::map<uint256, OrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
-        if (maybeErase->second.fromPeer == peer)
-        {
-            nErased += EraseTxNoLock(maybeErase->second.tx->GetHash());
-        }
+    // Erasing a peer's last orphan erases its entry
+    for (auto peer_it = m_peer_orphans.find(peer); peer_it != m_peer_orphans.end(); peer_it = m_peer_orphans.find(peer)) {
+        EraseTxNoLock(peer_it->second.orphans.front());
+        ++nErased;
     }
     if (nErased > 0) LogPrint(BCLog::TXPACKAGES, "Erased %d orphan tx from peer=%d\n", nErased, peer);
 }
 
-void TxOrphanage::LimitOrphans(unsigned int max_orphans)
+void TxOrphanage::LimitOrphans(unsigned int max_orphans, int64_t max_weight)
 {
     LOCK(m_mutex);
 
     unsigned int nEvicted = 0;
-    static int64_t nNextSweep;
     int64_t nNow = GetTime();
-    if (nNextSweep <= nNow) {
-        // Sweep out expired orphan pool entries:
-        int nErased = 0;
-        int64_t nMinExpTime = nNow + ORPHAN_TX_EXPIRE_TIME - ORPHAN_TX_EXPIRE_INTERVAL;
-        std::map<uint256, OrphanTx>::iterator iter = m_orphans.begin();
-        while (iter != m_orphans.end())
-        {
-            std::map<uint256, OrphanTx>::iterator maybeErase = iter++;
-            if (maybeErase->second.nTimeExpire <= nNow) {
-                nErased += EraseTxNoLock(maybeErase->second.tx->GetHash());
-            } else {
-                nMinExpTime = std::min(maybeErase->second.nTimeExpire, nMinExpTime);
-            }
-        }
-        // Sweep again 5 minutes after the next entry that expires in order to batch the linear scan.
-        nNextSweep = nMinExpTime + ORPHAN_TX_EXPIRE_INTERVAL;
-        if (nErased > 0) LogPrint(BCLog::TXPACKAGES, "Erased %d orphan tx due to expiration\n", nErased);
+    // Sweep out expired orphan pool entries, which are the oldest ones:
+    int nErased = 0;
+    while (!m_orphans_by_age.empty() && m_orphans_by_age.front()->second.nTimeExpire <= nNow) {
+        EraseTxNoLock(m_orphans_by_age.front());
+        ++nErased;
     }
-    FastRandomContext rng;
-    while (m_orphans.size() > max_orphans)
+    if (nErased > 0) LogPrint(BCLog::TXPACKAGES, "Erased %d orphan tx due to expiration\n", nErased);
+    while (m_orphans.size() > max_orphans || m_total_weight > max_weight)
     {
-        // Evict a random orphan:
-        size_t randompos = rng.randrange(m_orphan_list.size());
-        EraseTxNoLock(m_orphan_list[randompos]->first);
+        // Evict the oldest orphan of the peer whose orphans weigh the most:
+        const NodeId peer{m_peers_by_weight.rbegin()->second};
+        EraseTxNoLock(m_peer_orphans.at(peer).orphans.front());
         ++nEvicted;
     }
     if (nEvicted > 0) LogPrint(BCLog::TXPACKAGES, "orphanage overflow, removed %u tx\n", nEvicted);
@@ -152,19 +157,20 @@ void TxOrphanage::AddChildrenToWorkSet(const CTransaction& tx)
 {
     LOCK(m_mutex);
 
-
-    for (unsigned int i = 0; i < tx.vout.size(); i++) {
-        const auto it_by_prev = m_outpoint_to_orphan_it.find(COutPoint(tx.GetHash(), i));
-        if (it_by_prev != m_outpoint_to_orphan_it.end()) {
-            for (const auto& elem : it_by_prev->second) {
-                // Get this source peer's work set, emplacing an empty set if it didn't exist
-                // (note: if this peer wasn't still connected, we would have removed the orphan tx already)
-                std::set<uint256>& orphan_work_set = m_peer_work_set.try_emplace(elem->second.fromPeer).first->second;
-                // Add this tx to the work set
-                orphan_work_set.insert(elem->first);
-                LogPrint(BCLog::TXPACKAGES, "added %s (wtxid=%s) to peer %d workset\n",
-                         tx.GetHash().ToString(), tx.GetWitnessHash().ToString(), elem->second.fromPeer);
-            }
+    // The outpoints spent by the children of tx are adjacent in the index,
+    // so they are found without a lookup per output.
+    const uint256& hash = tx.GetHash();
+    for (auto it_by_prev = m_outpoint_to_orphan_it.lower_bound(COutPoint(hash, 0));
+         it_by_prev != m_outpoint_to_orphan_it.end() && it_by_prev->first.hash == hash; ++it_by_prev) {
+        if (it_by_prev->first.n >= tx.vout.size()) break;
+        for (const auto& elem : it_by_prev->second) {
+            // Get this source peer's work set, emplacing an empty set if it didn't exist
+            // (note: if this peer wasn't still connected, we would have removed the orphan tx already)
+            std::set<uint256>& orphan_work_set = m_peer_work_set.try_emplace(elem->second.fromPeer).first->second;
+            // Add this tx to the work set
+            orphan_work_set.insert(elem->first);
+            LogPrint(BCLog::TXPACKAGES, "added %s (wtxid=%s) to peer %d workset\n",
+                     tx.GetHash().ToString(), tx.GetWitnessHash().ToString(), elem->second.fromPeer);
         }
     }
 }
@@ -199,6 +205,29 @@ CTransactionRef TxOrphanage::GetTxToReconsider(NodeId peer)
     return nullptr;
 }
 
+std::vector<CTransactionRef> TxOrphanage::GetTxsToReconsider(NodeId peer)
+{
+    LOCK(m_mutex);
+
+    std::vector<CTransactionRef> txs;
+    auto work_set_it = m_peer_work_set.find(peer);
+    if (work_set_it != m_peer_work_set.end()) {
+        std::vector<OrphanMap::iterator> orphans;
+        for (const uint256& txid : work_set_it->second) {
+            const auto orphan_it = m_orphans.find(txid);
+            if (orphan_it != m_orphans.end()) orphans.push_back(orphan_it);
+        }
+        m_peer_work_set.erase(work_set_it);
+        // Parents were announced before their children, so this tends to put
+        // them first.
+        std::sort(orphans.begin(), orphans.end(), [](const auto& a, const auto& b) {
+            return a->second.nTimeExpire < b->second.nTimeExpire;
+        });
+        for (const auto& it : orphans) txs.push_back(it->second.tx);
+    }
+    return txs;
+}
+
 bool TxOrphanage::HaveTxToReconsider(NodeId peer)
 {
     LOCK(m_mutex);
@@ -10,13 +10,26 @@
 #include <primitives/transaction.h>
 #include <sync.h>
 
+#include <list>
 #include <map>
 #include <set>
+#include <utility>
+#include <vector>
+
+/** Default for the total weight of all orphans kept, e.g. 10 orphans of the maximum standard weight */
+static constexpr int64_t DEFAULT_MAX_ORPHAN_WEIGHT{4'000'000};
+/** Maximum total weight of the orphans announced by a single peer. Its oldest
+ *  orphans are dropped to make room for new ones beyond this. */
+static constexpr int64_t MAX_ORPHAN_WEIGHT_PER_PEER{800'000};
 
 /** A class to track orphan transactions (failed on TX_MISSING_INPUTS)
  * Since we cannot distinguish orphans from bad transactions with
  * non-existent inputs, we heavily limit the number of orphans
  * we keep and the duration we keep them for.
+ *
+ * Orphans are accounted by weight per announcing peer. When the orphanage is
+ * full, the oldest orphan of the peer using the most weight is evicted, so
+ * that a peer flooding us with orphans only displaces its own.
  */
 class TxOrphanage {
 public:
@@ -42,12 +55,16 @@ public:
     /** Erase all orphans included in or invalidated by a new block */
     void EraseForBlock(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
 
-    /** Limit the orphanage to the given maximum */
-    void LimitOrphans(unsigned int max_orphans) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Limit the orphanage to the given maximum number of orphans and total weight */
+    void LimitOrphans(unsigned int max_orphans, int64_t max_weight = DEFAULT_MAX_ORPHAN_WEIGHT) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
 
     /** Add any orphans that list a particular tx as a parent into the from peer's work set */
     void AddChildrenToWorkSet(const CTransaction& tx) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);;
 
+    /** Extract all transactions from a peer's work set, oldest orphan first,
+     *  so that they can be validated as a batch. */
+    std::vector<CTransactionRef> GetTxsToReconsider(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
     /** Does this peer have any work to do? */
     bool HaveTxToReconsider(NodeId peer) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);;
 
@@ -58,26 +75,58 @@ public:
         return m_orphans.size();
     }
 
+    /** Return the total weight of the orphans in the orphanage */
+    int64_t TotalWeight() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return m_total_weight;
+    }
+
 protected:
     /** Guards orphan transactions */
     mutable Mutex m_mutex;
 
+    struct OrphanTx;
+    using OrphanMap = std::map<uint256, OrphanTx>;
+    /** Orphans in the order they were added, oldest first */
+    using OrphanList = std::list<OrphanMap::iterator>;
+
     struct OrphanTx {
         CTransactionRef tx;
         NodeId fromPeer;
         int64_t nTimeExpire;
-        size_t list_pos;
+        int64_t weight;
+        /** Position in m_orphans_by_age */
+        OrphanList::iterator age_pos;
+        /** Position in the announcing peer's PeerOrphans::orphans */
+        OrphanList::iterator peer_pos;
     };
 
     /** Map from txid to orphan transaction record. Limited by
      *  -maxorphantx/DEFAULT_MAX_ORPHAN_TRANSACTIONS */
-    std::map<uint256, OrphanTx> m_orphans GUARDED_BY(m_mutex);
+    OrphanMap m_orphans GUARDED_BY(m_mutex);
+
+    /** All orphans, oldest first, for expiry */
+    OrphanList m_orphans_by_age GUARDED_BY(m_mutex);
+
+    /** Total weight of all orphans */
+    int64_t m_total_weight GUARDED_BY(m_mutex){0};
+
+    struct PeerOrphans {
+        /** Orphans announced by the peer, oldest first */
+        OrphanList orphans;
+        int64_t weight{0};
+    };
+
+    /** Orphans by announcing peer */
+    std::map<NodeId, PeerOrphans> m_peer_orphans GUARDED_BY(m_mutex);
+
+    /** Peers by the total weight of their orphans, to find the largest one to evict from */
+    std::set<std::pair<int64_t, NodeId>> m_peers_by_weight GUARDED_BY(m_mutex);
 
     /** Which peer provided the orphans that need to be reconsidered */
     std::map<NodeId, std::set<uint256>> m_peer_work_set GUARDED_BY(m_mutex);
 
-    using OrphanMap = decltype(m_orphans);
-
     struct IteratorComparator
     {
         template<typename I>
@@ -88,18 +137,22 @@ protected:
     };
 
     /** Index from the parents' COutPoint into the m_orphans. Used
-     *  to remove orphan transactions from the m_orphans */
+     *  to remove orphan transactions from the m_orphans, and to find the
+     *  children of a parent, whose outpoints are adjacent in the index */
     std::map<COutPoint, std::set<OrphanMap::iterator, IteratorComparator>> m_outpoint_to_orphan_it GUARDED_BY(m_mutex);
 
-    /** Orphan transactions in vector for quick random eviction */
-    std::vector<OrphanMap::iterator> m_orphan_list GUARDED_BY(m_mutex);
-
     /** Index from wtxid into the m_orphans to lookup orphan
      *  transactions using their witness ids. */
     std::map<uint256, OrphanMap::iterator> m_wtxid_to_orphan_it GUARDED_BY(m_mutex);
 
     /** Erase an orphan by txid */
     int EraseTxNoLock(const uint256& txid) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    /** Erase an orphan */
+    void EraseTxNoLock(OrphanMap::iterator it) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    /** Account for a change in the weight of a peer's orphans */
+    void UpdatePeerWeight(NodeId peer, PeerOrphans& info, int64_t delta) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
 };
 
 #endif // BITCOIN_TXORPHANAGE_H
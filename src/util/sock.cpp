@@ -11,6 +11,7 @@
 #include <util/threadinterrupt.h>
 #include <util/time.h>
 
+#include <array>
 #include <memory>
 #include <stdexcept>
 #include <string>
@@ -19,6 +20,15 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#ifndef WIN32
+#include <climits>
+#include <sys/uio.h>
+#endif
+
 static inline bool IOErrorIsPermanent(int err)
 {
     return err != WSAEAGAIN && err != WSAEINTR && err != WSAEWOULDBLOCK && err != WSAEINPROGRESS;
@@ -47,6 +57,27 @@ ssize_t Sock::Send(const void* data, size_t len, int flags) const
     return send(m_socket, static_cast<const char*>(data), len, flags);
 }
 
+ssize_t Sock::SendMany(Span<const Span<const unsigned char>> buffers, int flags) const
+{
+    if (buffers.empty()) return 0;
+#ifdef WIN32
+    return Send(buffers[0].data(), buffers[0].size(), flags);
+#else
+    std::vector<iovec> iov;
+    iov.reserve(buffers.size());
+    for (const auto& buffer : buffers) {
+#ifdef IOV_MAX
+        if (iov.size() == IOV_MAX) break;
+#endif
+        iov.push_back({const_cast<unsigned char*>(buffer.data()), buffer.size()});
+    }
+    msghdr msg{};
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = iov.size();
+    return sendmsg(m_socket, &msg, flags);
+#endif
+}
+
 ssize_t Sock::Recv(void* buf, size_t len, int flags) const
 {
     return recv(m_socket, static_cast<char*>(buf), len, flags);
@@ -412,6 +443,120 @@ bool Sock::operator==(SOCKET s) const
     return m_socket == s;
 };
 
+bool SockPoller::Set(const std::shared_ptr<const Sock>& sock, Sock::Event requested)
+{
+    // A new socket may live at the address of a destroyed one, so the entry is
+    // replaced as a whole.
+    m_socks[sock.get()] = {sock, requested};
+    return true;
+}
+
+bool SockPoller::Wait(std::chrono::milliseconds timeout, Sock::EventsPerSock& occurred)
+{
+    occurred.clear();
+
+    Sock::EventsPerSock events_per_sock;
+    for (auto it = m_socks.begin(); it != m_socks.end();) {
+        auto sock{it->second.first.lock()};
+        if (!sock) {
+            it = m_socks.erase(it);
+            continue;
+        }
+        if (it->second.second != 0) {
+            events_per_sock.emplace(std::move(sock), Sock::Events{it->second.second});
+        }
+        ++it;
+    }
+
+    if (events_per_sock.empty() || !events_per_sock.begin()->first->WaitMany(timeout, events_per_sock)) {
+        return false;
+    }
+
+    for (auto& [sock, events] : events_per_sock) {
+        if (events.occurred != 0) occurred.emplace(sock, events);
+    }
+    return true;
+}
+
+#ifdef USE_EPOLL
+EpollSockPoller::~EpollSockPoller()
+{
+    close(m_epoll_fd);
+}
+
+bool EpollSockPoller::Set(const std::shared_ptr<const Sock>& sock, Sock::Event requested)
+{
+    const SOCKET fd{sock->m_socket};
+    epoll_event ev{};
+    if (requested & Sock::RECV) {
+        ev.events |= EPOLLIN;
+    }
+    if (requested & Sock::SEND) {
+        ev.events |= EPOLLOUT;
+    }
+    ev.data.fd = fd;
+
+    // Unless this socket is already registered, the descriptor is new to the
+    // epoll set: closing a previous socket with the same number removed it.
+    auto [it, inserted] = m_socks.try_emplace(fd);
+    const int op{!inserted && it->second.first.lock() == sock ? EPOLL_CTL_MOD : EPOLL_CTL_ADD};
+    it->second = {sock, requested};
+
+    if (epoll_ctl(m_epoll_fd, op, fd, &ev) == 0) return true;
+    if (op == EPOLL_CTL_ADD && errno == EEXIST && epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0) return true;
+    m_socks.erase(it);
+    return false;
+}
+
+bool EpollSockPoller::Wait(std::chrono::milliseconds timeout, Sock::EventsPerSock& occurred)
+{
+    occurred.clear();
+
+    // Any sockets that are ready beyond this are reported by the next wait.
+    std::array<epoll_event, 256> ready;
+    const int num_ready{epoll_wait(m_epoll_fd, ready.data(), ready.size(), count_milliseconds(timeout))};
+    if (num_ready == -1) {
+        return false;
+    }
+
+    for (int i = 0; i < num_ready; ++i) {
+        const auto it{m_socks.find(ready[i].data.fd)};
+        if (it == m_socks.end()) continue;
+        auto sock{it->second.first.lock()};
+        if (!sock) {
+            m_socks.erase(it);
+            continue;
+        }
+        Sock::Events events{it->second.second};
+        if (ready[i].events & EPOLLIN) {
+            events.occurred |= Sock::RECV;
+        }
+        if (ready[i].events & EPOLLOUT) {
+            events.occurred |= Sock::SEND;
+        }
+        if (ready[i].events & (EPOLLERR | EPOLLHUP)) {
+            events.occurred |= Sock::ERR;
+        }
+        occurred.emplace(std::move(sock), events);
+    }
+    return true;
+}
+#endif // USE_EPOLL
+
+std::unique_ptr<SockPoller> CreateSockPollerOS()
+{
+#ifdef USE_EPOLL
+    const int epoll_fd{epoll_create1(EPOLL_CLOEXEC)};
+    if (epoll_fd != -1) {
+        return std::make_unique<EpollSockPoller>(epoll_fd);
+    }
+    LogPrintf("Cannot create epoll instance, falling back to poll: %s\n", SysErrorString(errno));
+#endif
+    return std::make_unique<SockPoller>();
+}
+
+std::function<std::unique_ptr<SockPoller>()> CreateSockPoller = CreateSockPollerOS;
+
 std::string NetworkErrorString(int err)
 {
 #if defined(WIN32)
@@ -6,13 +6,17 @@
 #define BITCOIN_UTIL_SOCK_H
 
 #include <compat/compat.h>
+#include <span.h>
 #include <util/threadinterrupt.h>
 #include <util/time.h>
 
 #include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 /**
  * Maximum time to wait for I/O readiness.
@@ -64,6 +68,14 @@ public:
      */
     [[nodiscard]] virtual ssize_t Send(const void* data, size_t len, int flags) const;
 
+    /**
+     * sendmsg(2) wrapper that sends the given buffers, in order, with a single system call. Like
+     * Send(), it returns the number of bytes sent, which may be less than their total size. Code
+     * that uses this wrapper can be unit tested if this method is overridden by a mock Sock
+     * implementation. On Windows only the first buffer is sent.
+     */
+    [[nodiscard]] virtual ssize_t SendMany(Span<const Span<const unsigned char>> buffers, int flags) const;
+
     /**
      * recv(2) wrapper. Equivalent to `recv(m_socket, buf, len, flags);`. Code that uses this
      * wrapper can be unit tested if this method is overridden by a mock Sock implementation.
@@ -267,6 +279,10 @@ protected:
      */
     SOCKET m_socket;
 
+#ifdef USE_EPOLL
+    friend class EpollSockPoller;
+#endif
+
 private:
     /**
      * Close `m_socket` if it is not `INVALID_SOCKET`.
@@ -274,6 +290,80 @@ private:
     void Close();
 };
 
+/**
+ * A set of sockets to wait on that persists across waits, so that callers only
+ * need to tell about the sockets whose requested events change.
+ *
+ * This implementation calls `Sock::WaitMany()` on every wait, so it works with
+ * any `Sock`, including mocked ones, but costs time proportional to the number
+ * of sockets. `CreateSockPoller()` returns an `EpollSockPoller` instead where
+ * epoll(7) is available.
+ *
+ * Sockets are not owned by the poller: one that is closed stops being waited on.
+ * Not thread safe.
+ */
+class SockPoller
+{
+public:
+    virtual ~SockPoller() = default;
+
+    /**
+     * Start waiting for `requested` events on `sock`, or change the requested events
+     * if it is already waited on. `ERR` may be reported even if not requested.
+     * @return false if the socket cannot be waited on
+     */
+    [[nodiscard]] virtual bool Set(const std::shared_ptr<const Sock>& sock, Sock::Event requested);
+
+    /**
+     * Wait for any of the requested events to occur on any of the sockets.
+     * @param[in] timeout Wait this long for at least one event to occur.
+     * @param[out] occurred The sockets on which events occurred.
+     * @return true on success (or timeout, if `occurred` is empty), false if there is
+     * nothing to wait on or waiting failed
+     */
+    [[nodiscard]] virtual bool Wait(std::chrono::milliseconds timeout, Sock::EventsPerSock& occurred);
+
+private:
+    std::unordered_map<const Sock*, std::pair<std::weak_ptr<const Sock>, Sock::Event>> m_socks;
+};
+
+#ifdef USE_EPOLL
+/**
+ * A `SockPoller` backed by epoll(7): sockets are registered with the kernel once
+ * and a wait only returns the ready ones.
+ */
+class EpollSockPoller final : public SockPoller
+{
+public:
+    /** Take ownership of a descriptor returned by epoll_create1(2). */
+    explicit EpollSockPoller(int epoll_fd) : m_epoll_fd{epoll_fd} {}
+    ~EpollSockPoller() override;
+
+    EpollSockPoller(const EpollSockPoller&) = delete;
+    EpollSockPoller& operator=(const EpollSockPoller&) = delete;
+
+    bool Set(const std::shared_ptr<const Sock>& sock, Sock::Event requested) override;
+    bool Wait(std::chrono::milliseconds timeout, Sock::EventsPerSock& occurred) override;
+
+private:
+    const int m_epoll_fd;
+    /**
+     * Registered sockets by descriptor. The kernel forgets a descriptor when it is
+     * closed, after which its entry here is expired until the number is reused.
+     */
+    std::unordered_map<SOCKET, std::pair<std::weak_ptr<const Sock>, Sock::Event>> m_socks;
+};
+#endif // USE_EPOLL
+
+/** Create the most efficient `SockPoller` available on this system. */
+std::unique_ptr<SockPoller> CreateSockPollerOS();
+
+/**
+ * Factory for the poller used by the socket handler thread. Can be replaced in
+ * tests that mock `Sock`.
+ */
+extern std::function<std::unique_ptr<SockPoller>()> CreateSockPoller;
+
 /** Return readable error string for a network error code */
 std::string NetworkErrorString(int err);
 
@@ -72,6 +72,7 @@
 #include <utility>
 
 using kernel::CCoinsStats;
+using kernel::CoinStatsAccumulator;
 using kernel::CoinStatsHashType;
 using kernel::ComputeUTXOStats;
 using kernel::Notifications;
@@ -135,6 +136,16 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
                        std::vector<CScriptCheck>* pvChecks = nullptr)
                        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** Run the script checks of tx against the spent outputs in txdata, without
+ *  consulting the script execution cache, and fill in state on failure like
+ *  CheckInputScripts(). Does not require cs_main. */
+static bool ExecuteInputScripts(const CTransaction& tx, TxValidationState& state, unsigned int flags,
+                                bool cacheSigStore, PrecomputedTransactionData& txdata);
+
+/** After tx failed its script checks with the policy flags, change state to
+ *  TX_WITNESS_STRIPPED if the failure is only due to a missing witness. */
+static void DetectWitnessStripped(const CTransaction& tx, TxValidationState& state, PrecomputedTransactionData& txdata);
+
 bool CheckFinalTxAtTip(const CBlockIndex& active_chain_tip, const CTransaction& tx)
 {
     AssertLockHeld(cs_main);
@@ -551,6 +562,23 @@ public:
     // Single transaction acceptance
     MempoolAcceptResult AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Run only the checks that AcceptSingleTransaction() does before the script checks, and keep
+     * their outcome for FinishSingleTransaction(). ptx must outlive this object. Returns the
+     * rejection if they fail; otherwise PreCheckedTxData() holds the outputs spent by the
+     * transaction, so that its scripts can be verified without holding any lock.
+     */
+    std::optional<MempoolAcceptResult> PreCheckSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    PrecomputedTransactionData& PreCheckedTxData() { return Assert(m_prechecked)->m_precomputed_txdata; }
+
+    /**
+     * Carry on with the transaction passed to PreCheckSingleTransaction() from where it
+     * stopped, if its checks still hold. Returns std::nullopt otherwise, in which case the
+     * transaction has to go through AcceptSingleTransaction().
+     */
+    std::optional<MempoolAcceptResult> FinishSingleTransaction(ATMPArgs& args) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     /**
     * Multiple transaction acceptance. Transactions may or may not be interdependent, but must not
     * conflict with each other, and the transactions cannot already be in the mempool. Parents must
@@ -634,6 +662,13 @@ private:
     // Run checks for mempool replace-by-fee.
     bool ReplacementChecks(Workspace& ws) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
 
+    // The checks of AcceptSingleTransaction() before the script checks, and the rest of them.
+    bool PreCheckSingle(ATMPArgs& args, Workspace& ws) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
+    MempoolAcceptResult FinishSingle(ATMPArgs& args, Workspace& ws) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
+
+    // Whether the mempool changes since PreCheckSingleTransaction() leave its checks of ws valid.
+    bool MempoolUnchangedFor(const Workspace& ws) EXCLUSIVE_LOCKS_REQUIRED(m_pool.cs);
+
     // Enforce package mempool ancestor/descendant limits (distinct from individual
     // ancestor/descendant limits done in PreChecks).
     bool PackageMempoolChecks(const std::vector<CTransactionRef>& txns,
@@ -689,6 +724,12 @@ private:
 
     /** Whether the transaction(s) would replace any mempool transactions. If so, RBF rules apply. */
     bool m_rbf{false};
+
+    /** The transaction passed to PreCheckSingleTransaction(), and the chain tip and mempool
+     * sequence its checks were done at. */
+    std::optional<Workspace> m_prechecked;
+    const CBlockIndex* m_prechecked_tip{nullptr};
+    uint64_t m_prechecked_sequence{0};
 };
 
 bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
@@ -935,6 +976,7 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
             .ancestor_size_vbytes = maybe_rbf_limits.ancestor_size_vbytes,
             .descendant_count = maybe_rbf_limits.descendant_count + 1,
             .descendant_size_vbytes = maybe_rbf_limits.descendant_size_vbytes + EXTRA_DESCENDANT_TX_SIZE_LIMIT,
+            .cluster_count = maybe_rbf_limits.cluster_count,
         };
         const auto error_message{util::ErrorString(ancestors).original};
         if (ws.m_vsize > EXTRA_DESCENDANT_TX_SIZE_LIMIT) {
@@ -1037,16 +1079,7 @@ bool MemPoolAccept::PolicyScriptChecks(const ATMPArgs& args, Workspace& ws)
     // Check input scripts and signatures.
     // This is done last to help prevent CPU exhaustion denial-of-service attacks.
     if (!CheckInputScripts(tx, state, m_view, scriptVerifyFlags, true, false, ws.m_precomputed_txdata)) {
-        // SCRIPT_VERIFY_CLEANSTACK requires SCRIPT_VERIFY_WITNESS, so we
-        // need to turn both off, and compare against just turning off CLEANSTACK
-        // to see if the failure is specifically due to witness validation.
-        TxValidationState state_dummy; // Want reported failures to be from first CheckInputScripts
-        if (!tx.HasWitness() && CheckInputScripts(tx, state_dummy, m_view, scriptVerifyFlags & ~(SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_CLEANSTACK), true, false, ws.m_precomputed_txdata) &&
-                !CheckInputScripts(tx, state_dummy, m_view, scriptVerifyFlags & ~SCRIPT_VERIFY_CLEANSTACK, true, false, ws.m_precomputed_txdata)) {
-            // Only the witness is missing, so the transaction itself may be fine.
-            state.Invalid(TxValidationResult::TX_WITNESS_STRIPPED,
-                    state.GetRejectReason(), state.GetDebugMessage());
-        }
+        DetectWitnessStripped(tx, state, ws.m_precomputed_txdata);
         return false; // state filled in by CheckInputScripts
     }
 
@@ -1226,9 +1259,27 @@ MempoolAcceptResult MemPoolAccept::AcceptSingleTransaction(const CTransactionRef
 
     Workspace ws(ptx);
 
-    if (!PreChecks(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
+    if (!PreCheckSingle(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
+
+    return FinishSingle(args, ws);
+}
+
+bool MemPoolAccept::PreCheckSingle(ATMPArgs& args, Workspace& ws)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(m_pool.cs);
+
+    if (!PreChecks(args, ws)) return false;
+
+    if (m_rbf && !ReplacementChecks(ws)) return false;
 
-    if (m_rbf && !ReplacementChecks(ws)) return MempoolAcceptResult::Failure(ws.m_state);
+    return true;
+}
+
+MempoolAcceptResult MemPoolAccept::FinishSingle(ATMPArgs& args, Workspace& ws)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(m_pool.cs);
 
     // Perform the inexpensive checks first and avoid hashing and signature verification unless
     // those checks pass, to mitigate CPU exhaustion denial-of-service attacks.
@@ -1246,12 +1297,81 @@ MempoolAcceptResult MemPoolAccept::AcceptSingleTransaction(const CTransactionRef
 
     if (!Finalize(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
 
-    GetMainSignals().TransactionAddedToMempool(ptx, m_pool.GetAndIncrementSequence());
+    GetMainSignals().TransactionAddedToMempool(ws.m_ptx, m_pool.GetAndIncrementSequence());
 
     return MempoolAcceptResult::Success(std::move(ws.m_replaced_transactions), ws.m_vsize, ws.m_base_fees,
                                         effective_feerate, single_wtxid);
 }
 
+std::optional<MempoolAcceptResult> MemPoolAccept::PreCheckSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args)
+{
+    AssertLockHeld(cs_main);
+    LOCK(m_pool.cs);
+
+    Workspace& ws{m_prechecked.emplace(ptx)};
+    if (!PreCheckSingle(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
+
+    std::vector<CTxOut> spent_outputs;
+    spent_outputs.reserve(ptx->vin.size());
+    for (const CTxIn& txin : ptx->vin) {
+        spent_outputs.push_back(m_view.AccessCoin(txin.prevout).out);
+    }
+    ws.m_precomputed_txdata.Init(*ptx, std::move(spent_outputs));
+    m_prechecked_tip = m_active_chainstate.m_chain.Tip();
+    m_prechecked_sequence = m_pool.GetSequence();
+    return std::nullopt;
+}
+
+std::optional<MempoolAcceptResult> MemPoolAccept::FinishSingleTransaction(ATMPArgs& args)
+{
+    AssertLockHeld(cs_main);
+    LOCK(m_pool.cs);
+
+    // The locks were released since PreCheckSingleTransaction(), so its checks only
+    // still hold if no block was connected or disconnected, the mempool did not change
+    // in a way that matters to them, and the fee they went by was not prioritised
+    // since. Replacements also went by the fees of the transactions they replace, so
+    // start over for those.
+    Workspace& ws{*Assert(m_prechecked)};
+    CAmount modified_fees{ws.m_base_fees};
+    m_pool.ApplyDelta(ws.m_hash, modified_fees);
+    if (m_prechecked_tip != m_active_chainstate.m_chain.Tip() || !MempoolUnchangedFor(ws) ||
+        modified_fees != ws.m_modified_fees || m_rbf) {
+        return std::nullopt;
+    }
+    return FinishSingle(args, ws);
+}
+
+bool MemPoolAccept::MempoolUnchangedFor(const Workspace& ws)
+{
+    AssertLockHeld(m_pool.cs);
+    const uint64_t sequence{m_pool.GetSequence()};
+    if (sequence == m_prechecked_sequence) return true;
+
+    // Every addition and removal takes one sequence value, so if all of them
+    // were additions of transactions that are still there, nothing was evicted
+    // and the mempool minimum fee did not go up.
+    const auto delta{m_pool.GetChangesSince(m_prechecked_sequence)};
+    if (!delta || delta->added.size() != sequence - m_prechecked_sequence) return false;
+
+    // None of the additions may spend the same outputs, be this transaction, or
+    // count towards the descendant limits of its ancestors.
+    if (m_pool.exists(GenTxid::Txid(ws.m_hash))) return false;
+    for (const CTxIn& txin : ws.m_ptx->vin) {
+        if (m_pool.GetConflictTx(txin.prevout)) return false;
+    }
+    if (ws.m_ancestors.empty()) return true;
+    for (const uint256& txid : delta->added) {
+        const auto it{m_pool.GetIter(txid)};
+        if (!it) return false;
+        const auto ancestors{m_pool.AssumeCalculateMemPoolAncestors(__func__, **it, CTxMemPool::Limits::NoLimits(), /*fSearchForParents=*/false)};
+        for (CTxMemPool::txiter ancestor : ancestors) {
+            if (ws.m_ancestors.count(ancestor)) return false;
+        }
+    }
+    return true;
+}
+
 PackageMempoolAcceptResult MemPoolAccept::AcceptMultipleTransactions(const std::vector<CTransactionRef>& txns, ATMPArgs& args)
 {
     AssertLockHeld(cs_main);
@@ -1572,18 +1692,11 @@ PackageMempoolAcceptResult MemPoolAccept::AcceptPackage(const Package& package,
 
 } // anon namespace
 
-MempoolAcceptResult AcceptToMemoryPool(Chainstate& active_chainstate, const CTransactionRef& tx,
-                                       int64_t accept_time, bool bypass_limits, bool test_accept)
+static void UncacheRejectedCoins(Chainstate& active_chainstate, const CTransactionRef& tx, const MempoolAcceptResult& result,
+                                 const std::vector<COutPoint>& coins_to_uncache)
     EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
 {
     AssertLockHeld(::cs_main);
-    const CChainParams& chainparams{active_chainstate.m_chainman.GetParams()};
-    assert(active_chainstate.GetMempool() != nullptr);
-    CTxMemPool& pool{*active_chainstate.GetMempool()};
-
-    std::vector<COutPoint> coins_to_uncache;
-    auto args = MemPoolAccept::ATMPArgs::SingleAccept(chainparams, accept_time, bypass_limits, coins_to_uncache, test_accept);
-    MempoolAcceptResult result = MemPoolAccept(pool, active_chainstate).AcceptSingleTransaction(tx, args);
     if (result.m_result_type != MempoolAcceptResult::ResultType::VALID) {
         // Remove coins that were not present in the coins cache before calling
         // AcceptSingleTransaction(); this is to prevent memory DoS in case we receive a large
@@ -1600,6 +1713,21 @@ MempoolAcceptResult AcceptToMemoryPool(Chainstate& active_chainstate, const CTra
     // After we've (potentially) uncached entries, ensure our coins cache is still within its size limits
     BlockValidationState state_dummy;
     active_chainstate.FlushStateToDisk(state_dummy, FlushStateMode::PERIODIC);
+}
+
+MempoolAcceptResult AcceptToMemoryPool(Chainstate& active_chainstate, const CTransactionRef& tx,
+                                       int64_t accept_time, bool bypass_limits, bool test_accept)
+    EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
+{
+    AssertLockHeld(::cs_main);
+    const CChainParams& chainparams{active_chainstate.m_chainman.GetParams()};
+    assert(active_chainstate.GetMempool() != nullptr);
+    CTxMemPool& pool{*active_chainstate.GetMempool()};
+
+    std::vector<COutPoint> coins_to_uncache;
+    auto args = MemPoolAccept::ATMPArgs::SingleAccept(chainparams, accept_time, bypass_limits, coins_to_uncache, test_accept);
+    MempoolAcceptResult result = MemPoolAccept(pool, active_chainstate).AcceptSingleTransaction(tx, args);
+    UncacheRejectedCoins(active_chainstate, tx, result, coins_to_uncache);
     return result;
 }
 
@@ -1891,19 +2019,35 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
     }
     assert(txdata.m_spent_outputs.size() == tx.vin.size());
 
-    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+    if (!pvChecks) {
+        if (!ExecuteInputScripts(tx, state, flags, cacheSigStore, txdata)) return false;
+    } else {
+        for (unsigned int i = 0; i < tx.vin.size(); i++) {
+            // We very carefully only pass in things to CScriptCheck which
+            // are clearly committed to by tx' witness hash. This provides
+            // a sanity check that our caching is not introducing consensus
+            // failures through additional data in, eg, the coins being
+            // spent being checked as a part of CScriptCheck.
+            pvChecks->emplace_back(txdata.m_spent_outputs[i], tx, i, flags, cacheSigStore, &txdata);
+        }
+    }
 
-        // We very carefully only pass in things to CScriptCheck which
-        // are clearly committed to by tx' witness hash. This provides
-        // a sanity check that our caching is not introducing consensus
-        // failures through additional data in, eg, the coins being
-        // spent being checked as a part of CScriptCheck.
+    if (cacheFullScriptStore && !pvChecks) {
+        // We executed all of the provided scripts, and were told to
+        // cache the result. Do so now.
+        g_scriptExecutionCache.insert(hashCacheEntry);
+    }
 
+    return true;
+}
+
+static bool ExecuteInputScripts(const CTransaction& tx, TxValidationState& state, unsigned int flags,
+                                bool cacheSigStore, PrecomputedTransactionData& txdata)
+{
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
         // Verify signature
         CScriptCheck check(txdata.m_spent_outputs[i], tx, i, flags, cacheSigStore, &txdata);
-        if (pvChecks) {
-            pvChecks->emplace_back(std::move(check));
-        } else if (!check()) {
+        if (!check()) {
             if (flags & STANDARD_NOT_MANDATORY_VERIFY_FLAGS) {
                 // Check whether the failure was caused by a
                 // non-mandatory script verification check, such as
@@ -1930,14 +2074,22 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
             return state.Invalid(TxValidationResult::TX_CONSENSUS, strprintf("mandatory-script-verify-flag-failed (%s)", ScriptErrorString(check.GetScriptError())));
         }
     }
+    return true;
+}
 
-    if (cacheFullScriptStore && !pvChecks) {
-        // We executed all of the provided scripts, and were told to
-        // cache the result. Do so now.
-        g_scriptExecutionCache.insert(hashCacheEntry);
+static void DetectWitnessStripped(const CTransaction& tx, TxValidationState& state, PrecomputedTransactionData& txdata)
+{
+    // SCRIPT_VERIFY_CLEANSTACK requires SCRIPT_VERIFY_WITNESS, so we
+    // need to turn both off, and compare against just turning off CLEANSTACK
+    // to see if the failure is specifically due to witness validation.
+    TxValidationState state_dummy; // Want reported failures to be from the first script check
+    constexpr unsigned int scriptVerifyFlags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    if (!tx.HasWitness() && ExecuteInputScripts(tx, state_dummy, scriptVerifyFlags & ~(SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_CLEANSTACK), true, txdata) &&
+            !ExecuteInputScripts(tx, state_dummy, scriptVerifyFlags & ~SCRIPT_VERIFY_CLEANSTACK, true, txdata)) {
+        // Only the witness is missing, so the transaction itself may be fine.
+        state.Invalid(TxValidationResult::TX_WITNESS_STRIPPED,
+                state.GetRejectReason(), state.GetDebugMessage());
     }
-
-    return true;
 }
 
 bool FatalError(Notifications& notifications, BlockValidationState& state, const std::string& strMessage, const bilingual_str& userMessage)
@@ -3915,6 +4067,11 @@ static bool ContextualCheckBlockHeader(const CBlockHeader& block, BlockValidatio
     return true;
 }
 
+bool ContextualCheckBlockHeader(const CBlockHeader& block, BlockValidationState& state, ChainstateManager& chainman, const CBlockIndex* pindexPrev)
+{
+    return ContextualCheckBlockHeader(block, state, chainman.m_blockman, chainman, pindexPrev, chainman.m_options.adjusted_time_callback());
+}
+
 /** NOTE: This function is not currently invoked by ConnectBlock(), so we
  *  should consider upgrade issues if we change which consensus rules are
  *  enforced in this function (eg by adding a new consensus rule). See comment
@@ -4295,6 +4452,152 @@ MempoolAcceptResult ChainstateManager::ProcessTransaction(const CTransactionRef&
     return result;
 }
 
+static uint256 ScriptExecutionCacheEntry(const CTransaction& tx, unsigned int flags)
+{
+    uint256 hashCacheEntry;
+    CSHA256 hasher = g_scriptExecutionCacheHasher;
+    hasher.Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
+    return hashCacheEntry;
+}
+
+struct PreCheckedTransaction::Impl {
+    Impl(const CTransactionRef& tx, int64_t accept_time) : m_tx{tx}, m_accept_time{accept_time} {}
+
+    const CTransactionRef m_tx;
+    const int64_t m_accept_time;
+    //! Coins pulled into the coins cache by the checks, released if the transaction is rejected
+    std::vector<COutPoint> m_coins_to_uncache;
+    //! The rejection, if the transaction failed the checks
+    std::optional<MempoolAcceptResult> m_rejection;
+    //! The mempool acceptance started by the checks, if they passed
+    Chainstate* m_chainstate{nullptr};
+    std::optional<MemPoolAccept> m_accept;
+    std::optional<MemPoolAccept::ATMPArgs> m_args;
+};
+
+PreCheckedTransaction::PreCheckedTransaction(const CTransactionRef& tx, int64_t accept_time)
+    : m_impl{std::make_unique<Impl>(tx, accept_time)} {}
+PreCheckedTransaction::PreCheckedTransaction(PreCheckedTransaction&&) noexcept = default;
+PreCheckedTransaction& PreCheckedTransaction::operator=(PreCheckedTransaction&&) noexcept = default;
+PreCheckedTransaction::~PreCheckedTransaction() = default;
+
+const CTransactionRef& PreCheckedTransaction::GetTx() const { return m_impl->m_tx; }
+
+MempoolAcceptResult ChainstateManager::ProcessTransaction(PreCheckedTransaction&& precheck)
+{
+    AssertLockHeld(cs_main);
+    PreCheckedTransaction::Impl& impl{*precheck.m_impl};
+    Chainstate& active_chainstate = ActiveChainstate();
+    if (!active_chainstate.GetMempool()) {
+        TxValidationState state;
+        state.Invalid(TxValidationResult::TX_NO_MEMPOOL, "no-mempool");
+        return MempoolAcceptResult::Failure(state);
+    }
+    MempoolAcceptResult result{[&]() EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+        if (impl.m_rejection) return std::move(*impl.m_rejection);
+        if (impl.m_accept && impl.m_chainstate == &active_chainstate) {
+            if (auto finished{impl.m_accept->FinishSingleTransaction(*impl.m_args)}) return std::move(*finished);
+        }
+        auto args{MemPoolAccept::ATMPArgs::SingleAccept(GetParams(), impl.m_accept_time, /*bypass_limits=*/false, impl.m_coins_to_uncache, /*test_accept=*/false)};
+        return MemPoolAccept(*active_chainstate.GetMempool(), active_chainstate).AcceptSingleTransaction(impl.m_tx, args);
+    }()};
+    UncacheRejectedCoins(active_chainstate, impl.m_tx, result, impl.m_coins_to_uncache);
+    active_chainstate.GetMempool()->check(active_chainstate.CoinsTip(), active_chainstate.m_chain.Height() + 1);
+    return result;
+}
+
+void ChainstateManager::PreCheckTransaction(PreCheckedTransaction& tx)
+{
+    PreCheckTransactions(Span{&tx, 1});
+}
+
+void ChainstateManager::PreCheckTransactions(Span<PreCheckedTransaction> txs)
+{
+    AssertLockNotHeld(cs_main);
+    std::vector<PreCheckedTransaction::Impl*> pending;
+    unsigned int block_flags;
+    {
+        LOCK(cs_main);
+        Chainstate& active_chainstate{ActiveChainstate()};
+        CTxMemPool* pool{active_chainstate.GetMempool()};
+        if (!pool) return;
+        block_flags = GetBlockScriptFlags(*active_chainstate.m_chain.Tip(), *this);
+        std::set<uint256> batch_txids;
+        for (PreCheckedTransaction& precheck : txs) {
+            PreCheckedTransaction::Impl& impl{*precheck.m_impl};
+            const CTransactionRef& tx{impl.m_tx};
+            batch_txids.insert(tx->GetHash());
+            if (g_scriptExecutionCache.contains(ScriptExecutionCacheEntry(*tx, STANDARD_SCRIPT_VERIFY_FLAGS), /*erase=*/false) &&
+                g_scriptExecutionCache.contains(ScriptExecutionCacheEntry(*tx, block_flags), /*erase=*/false)) {
+                continue;
+            }
+
+            // Do the cheap checks of AcceptToMemoryPool() first, so that no script
+            // verification time is spent on transactions it would reject anyway.
+            // ProcessTransaction() carries on from there.
+            impl.m_chainstate = &active_chainstate;
+            impl.m_args.emplace(MemPoolAccept::ATMPArgs::SingleAccept(GetParams(), impl.m_accept_time, /*bypass_limits=*/false, impl.m_coins_to_uncache, /*test_accept=*/false));
+            impl.m_accept.emplace(*pool, active_chainstate);
+            if (auto rejection{impl.m_accept->PreCheckSingleTransaction(tx, *impl.m_args)}) {
+                // Children of transactions earlier in the batch can only be
+                // checked once those are in the mempool, so leave them to
+                // ProcessTransaction().
+                const bool spends_batch{std::any_of(tx->vin.begin(), tx->vin.end(),
+                                                    [&](const CTxIn& txin) { return batch_txids.count(txin.prevout.hash); })};
+                if (rejection->m_state.GetResult() == TxValidationResult::TX_MISSING_INPUTS && spends_batch) {
+                    impl.m_accept.reset();
+                } else {
+                    impl.m_rejection.emplace(std::move(*rejection));
+                }
+                continue;
+            }
+            pending.push_back(&impl);
+        }
+    }
+
+    // Verify the scripts against the spent outputs looked up above, like
+    // PolicyScriptChecks() would, spreading the inputs of the whole batch over
+    // the script check threads.
+    std::vector<CScriptCheck> checks;
+    for (PreCheckedTransaction::Impl* impl : pending) {
+        PrecomputedTransactionData& txdata{impl->m_accept->PreCheckedTxData()};
+        for (unsigned int i = 0; i < impl->m_tx->vin.size(); i++) {
+            checks.emplace_back(txdata.m_spent_outputs[i], *impl->m_tx, i, STANDARD_SCRIPT_VERIFY_FLAGS, /*cacheIn=*/true, &txdata);
+        }
+    }
+    bool all_valid{false};
+    if (scriptcheckqueue.HasThreads() && checks.size() > 1) {
+        CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+        control.Add(std::move(checks));
+        all_valid = control.Wait();
+    }
+
+    std::vector<uint256> cache_entries;
+    for (PreCheckedTransaction::Impl* impl : pending) {
+        const CTransaction& tx{*impl->m_tx};
+        PrecomputedTransactionData& txdata{impl->m_accept->PreCheckedTxData()};
+        TxValidationState state;
+        // If the batch failed, find out which transactions failed it one by
+        // one, so that they do not keep the others out of the cache. The
+        // signatures verified so far are found in the signature cache.
+        if (!all_valid && !ExecuteInputScripts(tx, state, STANDARD_SCRIPT_VERIFY_FLAGS, /*cacheSigStore=*/true, txdata)) {
+            DetectWitnessStripped(tx, state, txdata);
+            impl->m_rejection.emplace(MempoolAcceptResult::Failure(state));
+            continue;
+        }
+        cache_entries.push_back(ScriptExecutionCacheEntry(tx, STANDARD_SCRIPT_VERIFY_FLAGS));
+        // Like ConsensusScriptChecks(), this mostly hits the signature cache.
+        if (ExecuteInputScripts(tx, state, block_flags, /*cacheSigStore=*/true, txdata)) {
+            cache_entries.push_back(ScriptExecutionCacheEntry(tx, block_flags));
+        }
+    }
+
+    // Record the results, so that ProcessTransaction() finds them in the
+    // script execution cache instead of verifying the scripts again.
+    LOCK(cs_main);
+    for (const uint256& entry : cache_entries) g_scriptExecutionCache.insert(entry);
+}
+
 bool TestBlockValidity(BlockValidationState& state,
                        const CChainParams& chainparams,
                        Chainstate& chainstate,
@@ -5473,6 +5776,13 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     LogPrintf("[snapshot] loading coins from snapshot %s\n", base_blockhash.ToString());
     int64_t coins_processed{0};
 
+    // Hash the coins as they are streamed in, rather than reading the whole
+    // set back from the coins database once loading is done. Requiring the
+    // snapshot to be in coins database order (as written by dumptxoutset)
+    // guarantees the result is identical to hashing the database contents.
+    CCoinsStats stats{base_height, base_blockhash};
+    CoinStatsAccumulator accumulator{CoinStatsHashType::HASH_SERIALIZED, stats};
+
     while (coins_left > 0) {
         try {
             coins_file >> outpoint;
@@ -5495,6 +5805,12 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
             return false;
         }
 
+        if (!accumulator.Add(outpoint, coin)) {
+            LogPrintf("[snapshot] bad snapshot - duplicate or out of order coin after deserializing %d coins\n",
+                      coins_count - coins_left);
+            return false;
+        }
+
         coins_cache.EmplaceCoinInternalDANGER(std::move(outpoint), std::move(coin));
 
         --coins_left;
@@ -5561,27 +5877,12 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
 
     assert(coins_cache.GetBestBlock() == base_blockhash);
 
-    // As above, okay to immediately release cs_main here since no other context knows
-    // about the snapshot_chainstate.
-    CCoinsViewDB* snapshot_coinsdb = WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsDB());
-
-    std::optional<CCoinsStats> maybe_stats;
-
-    try {
-        maybe_stats = ComputeUTXOStats(
-            CoinStatsHashType::HASH_SERIALIZED, snapshot_coinsdb, m_blockman, [&interrupt = m_interrupt] { SnapshotUTXOHashBreakpoint(interrupt); });
-    } catch (StopHashingException const&) {
-        return false;
-    }
-    if (!maybe_stats.has_value()) {
-        LogPrintf("[snapshot] failed to generate coins stats\n");
-        return false;
-    }
+    accumulator.Finalize();
 
     // Assert that the deserialized chainstate contents match the expected assumeutxo value.
-    if (AssumeutxoHash{maybe_stats->hashSerialized} != au_data.hash_serialized) {
+    if (AssumeutxoHash{stats.hashSerialized} != au_data.hash_serialized) {
         LogPrintf("[snapshot] bad snapshot content hash: expected %s, got %s\n",
-            au_data.hash_serialized.ToString(), maybe_stats->hashSerialized.ToString());
+            au_data.hash_serialized.ToString(), stats.hashSerialized.ToString());
         return false;
     }
 
@@ -263,6 +263,27 @@ PackageMempoolAcceptResult ProcessNewPackage(Chainstate& active_chainstate, CTxM
                                                    const Package& txns, bool test_accept)
                                                    EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/**
+ * A transaction on its way into the mempool. ChainstateManager::PreCheckTransaction()
+ * runs its checks without holding cs_main, and ChainstateManager::ProcessTransaction()
+ * carries on from there.
+ */
+class PreCheckedTransaction
+{
+public:
+    PreCheckedTransaction(const CTransactionRef& tx, int64_t accept_time);
+    PreCheckedTransaction(PreCheckedTransaction&&) noexcept;
+    PreCheckedTransaction& operator=(PreCheckedTransaction&&) noexcept;
+    ~PreCheckedTransaction();
+
+    const CTransactionRef& GetTx() const;
+
+private:
+    friend class ChainstateManager;
+    struct Impl;
+    std::unique_ptr<Impl> m_impl;
+};
+
 /* Mempool validation helper functions */
 
 /**
@@ -347,6 +368,9 @@ static_assert(std::is_nothrow_destructible_v<CScriptCheck>);
 /** Context-independent validity checks */
 bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, bool fCheckMerkleRoot = true);
 
+/** Context-dependent validity checks of a header that would extend pindexPrev. Its proof of work is not checked. */
+bool ContextualCheckBlockHeader(const CBlockHeader& block, BlockValidationState& state, ChainstateManager& chainman, const CBlockIndex* pindexPrev) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Check a block is completely valid from start to finish (only works on top of our current best block) */
 bool TestBlockValidity(BlockValidationState& state,
                        const CChainParams& chainparams,
@@ -1183,6 +1207,36 @@ public:
     [[nodiscard]] MempoolAcceptResult ProcessTransaction(const CTransactionRef& tx, bool test_accept=false)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /**
+     * Try to add a transaction to the memory pool, carrying on from the checks
+     * PreCheckTransaction() did on it. The checks that come before the script
+     * checks are only repeated if the chain tip or the mempool changed since.
+     * If they failed, this returns their rejection.
+     */
+    [[nodiscard]] MempoolAcceptResult ProcessTransaction(PreCheckedTransaction&& tx)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /**
+     * Run the cheap checks of ProcessTransaction() on a transaction that is about
+     * to be submitted with it, and if they pass, verify its scripts without holding
+     * cs_main or the mempool lock. The spent outputs are looked up under a short
+     * lock, and the scripts are checked against them on the calling thread. The
+     * script checks are recorded in the script execution cache.
+     *
+     * The outcome is kept in tx, which must then be passed to ProcessTransaction().
+     * That also releases the coins looked up here if the transaction is rejected.
+     */
+    void PreCheckTransaction(PreCheckedTransaction& tx) LOCKS_EXCLUDED(cs_main);
+
+    /**
+     * PreCheckTransaction() for a batch of transactions that are submitted one
+     * after the other, with the script checks of the whole batch spread over the
+     * script check threads. A transaction that fails them only affects itself.
+     * Transactions spending outputs of earlier ones in the batch are left to
+     * ProcessTransaction() if their inputs are not found yet.
+     */
+    void PreCheckTransactions(Span<PreCheckedTransaction> txs) LOCKS_EXCLUDED(cs_main);
+
     //! Load the block tree and coins database from disk, initializing state if we're running with -reindex
     bool LoadBlockIndex() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
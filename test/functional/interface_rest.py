@@ -366,6 +366,17 @@ class RESTTest (BitbiTestFramework):
 
         assert_equal(json_obj, raw_mempool)
 
+        # Check the mempool response for changes since a sequence number
+        json_obj = self.test_rest_request("/mempool/contents", query_params={"verbose": "false", "since_sequence": "1"})
+        assert_equal(json_obj, self.nodes[0].getrawmempool(False, False, 1))
+        assert_equal(sorted(json_obj['added']), sorted(txs))
+        assert_equal(json_obj['removed'], [])
+        assert_equal(json_obj['mempool_sequence'], raw_mempool['mempool_sequence'])
+        json_obj = self.test_rest_request("/mempool/contents", query_params={"verbose": "false", "since_sequence": str(raw_mempool['mempool_sequence'])})
+        assert_equal(json_obj, {'added': [], 'removed': [], 'mempool_sequence': raw_mempool['mempool_sequence']})
+        resp = self.test_rest_request("/mempool/contents", ret_type=RetType.OBJ, status=400, query_params={"verbose": "false", "since_sequence": str(raw_mempool['mempool_sequence'] + 1)})
+        assert_equal(resp.read().decode('utf-8').strip(), 'The "since_sequence" query parameter is unknown or too old, fetch the full contents with mempool_sequence=true instead.')
+
         # Check for error response if verbose=true and mempool_sequence=true
         resp = self.test_rest_request("/mempool/contents", ret_type=RetType.OBJ, status=400, query_params={"verbose": "true", "mempool_sequence": "true"})
         assert_equal(resp.read().decode('utf-8').strip(), 'Verbose results cannot contain mempool sequence values. (hint: set "verbose=false")')
@@ -379,7 +390,11 @@ class RESTTest (BitbiTestFramework):
         assert_equal(resp.read().decode('utf-8').strip(), 'The "mempool_sequence" query parameter must be either "true" or "false".')
 
         # Now mine the transactions
+        sequence_before_block = raw_mempool['mempool_sequence']
         newblockhash = self.generate(self.nodes[1], 1)
+        json_obj = self.test_rest_request("/mempool/contents", query_params={"verbose": "false", "since_sequence": str(sequence_before_block)})
+        assert_equal(sorted(json_obj['removed']), sorted(txs))
+        assert_equal(json_obj['added'], [])
 
         # Check if the 3 tx show up in the new block
         json_obj = self.test_rest_request(f"/block/{newblockhash[0]}")
@@ -28,6 +28,9 @@ Test is as follows:
   - Restart node0 with -persistmempool. Verify that it has 5
     transactions in its mempool. This tests that -persistmempool=0
     does not overwrite a previously valid mempool stored on disk.
+  - Restart node0 with -persistmempoolv1. Verify that it loads the
+    legacy file it saves as well as the checksummed default one, and
+    that a file with a bad checksum is rejected.
   - Remove node0 mempool.dat and verify savemempool RPC recreates it
     and verify that node1 can load it and has 5 transactions in its
     mempool.
@@ -175,6 +178,33 @@ class MempoolPersistTest(BitbiTestFramework):
         assert self.nodes[0].getmempoolinfo()["loaded"]
         assert_equal(len(self.nodes[0].getrawmempool()), 7)
 
+        self.log.debug("Stop-start node0 with -persistmempoolv1 twice. Verify that it loads the legacy file it saved.")
+        self.stop_nodes()
+        self.start_node(0, extra_args=["-persistmempoolv1"])
+        self.stop_nodes()
+        self.start_node(0, extra_args=["-persistmempoolv1"])
+        assert self.nodes[0].getmempoolinfo()["loaded"]
+        assert_equal(len(self.nodes[0].getrawmempool()), 7)
+
+        self.log.debug("Stop-start node0 with the default format. Verify that it loads the checksummed file it saved.")
+        self.stop_nodes()
+        self.start_node(0)
+        self.stop_nodes()
+        self.start_node(0)
+        assert self.nodes[0].getmempoolinfo()["loaded"]
+        assert_equal(len(self.nodes[0].getrawmempool()), 7)
+
+        self.log.debug("Corrupt a copy of mempool.dat. Verify that importmempool rejects it because of its checksum.")
+        with open(mempooldat0, "rb") as f:
+            mempooldat_bytes = bytearray(f.read())
+        mempooldat_bytes[-1] ^= 1
+        mempooldat_corrupt = mempooldat0 + ".corrupt"
+        with open(mempooldat_corrupt, "wb") as f:
+            f.write(mempooldat_bytes)
+        with self.nodes[0].assert_debug_log(["Checksum mismatch, data corrupted"]):
+            assert_raises_rpc_error(-1, "Unable to import mempool file, see debug.log for details.", self.nodes[0].importmempool, mempooldat_corrupt)
+        os.remove(mempooldat_corrupt)
+
         self.log.debug("Remove the mempool.dat file. Verify that savemempool to disk via RPC re-creates it")
         os.remove(mempooldat0)
         result0 = self.nodes[0].savemempool()
@@ -147,6 +147,7 @@ class CompactBlocksTest(BitbiTestFramework):
         self.num_nodes = 1
         self.extra_args = [[
             "-acceptnonstdtxn=1",
+            "-fastcmpctrelay",
         ]]
         self.utxos = []
 
@@ -715,6 +716,37 @@ class CompactBlocksTest(BitbiTestFramework):
                 l.last_message["cmpctblock"].header_and_shortids.header.calc_sha256()
                 assert_equal(l.last_message["cmpctblock"].header_and_shortids.header.sha256, block.sha256)
 
+    # A compact block extending the tip is relayed to high-bandwidth peers as
+    # soon as its header is valid, before the block itself can be validated.
+    def test_fast_cmpctblock_relay(self, sender, listener):
+        node = self.nodes[0]
+        utxo = self.utxos.pop(0)
+        block = self.build_block_with_transactions(node, utxo, 5)
+        cmpct_block = HeaderAndShortIDs()
+        cmpct_block.initialize_from_block(block)
+
+        listener.clear_block_announcement()
+        sender.send_and_ping(msg_cmpctblock(cmpct_block.to_p2p()))
+        # The transactions are missing, so the block hasn't been validated yet.
+        assert int(node.getbestblockhash(), 16) != block.sha256
+        listener.wait_for_block_announcement(block.sha256)
+        with p2p_lock:
+            assert "cmpctblock" in listener.last_message
+        listener.clear_block_announcement()
+
+        msg = msg_blocktxn()
+        msg.block_transactions.blockhash = block.sha256
+        msg.block_transactions.transactions = block.vtx[1:]
+        sender.send_and_ping(msg)
+        assert_equal(int(node.getbestblockhash(), 16), block.sha256)
+        self.utxos.append([block.vtx[-1].sha256, 0, block.vtx[-1].vout[0].nValue])
+
+        # The block isn't announced again once it is connected.
+        node.syncwithvalidationinterfacequeue()
+        listener.sync_with_ping()
+        with p2p_lock:
+            assert not listener.received_block_announcement()
+
     # Test that we don't get disconnected if we relay a compact block with valid header,
     # but invalid transactions.
     def test_invalid_tx_in_compactblock(self, test_node):
@@ -954,6 +986,9 @@ class CompactBlocksTest(BitbiTestFramework):
         self.request_cb_announcements(self.additional_segwit_node)
         self.test_end_to_end_block_relay([self.segwit_node, self.additional_segwit_node])
 
+        self.log.info("Testing relay of compact blocks before validation...")
+        self.test_fast_cmpctblock_relay(self.segwit_node, self.additional_segwit_node)
+
         self.log.info("Testing handling of invalid compact blocks...")
         self.test_invalid_tx_in_compactblock(self.segwit_node)
 
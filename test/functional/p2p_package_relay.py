@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+# Copyright (c) 2024 The Bitbi Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test relay of transactions together with their unconfirmed parents.
+
+Peers negotiate package relay with sendpackages between version and verack.
+When a package relay peer sends a transaction with missing inputs, the node asks
+for the transaction and its parents with getpkgtxns and validates the pkgtxns
+answer as a single package.
+"""
+
+import time
+
+from test_framework.blocktools import COINBASE_MATURITY
+from test_framework.messages import (
+    MSG_WTX,
+    msg_getpkgtxns,
+    msg_pkgtxns,
+    msg_sendpackages,
+    msg_tx,
+    msg_wtxidrelay,
+)
+from test_framework.p2p import (
+    P2PTxInvStore,
+    p2p_lock,
+)
+from test_framework.test_framework import BitbiTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+    create_lots_of_big_transactions,
+    gen_return_txouts,
+)
+from test_framework.wallet import MiniWallet
+
+
+class PackageRelayPeer(P2PTxInvStore):
+    def __init__(self, sendpackages=True):
+        super().__init__()
+        # wtxidrelay is sent below, so that sendpackages can follow it.
+        self.wtxidrelay = False
+        self.sendpackages = sendpackages
+        self.msgtypes = []
+
+    def on_message(self, message):
+        super().on_message(message)
+        self.msgtypes.append(message.msgtype)
+
+    def on_version(self, message):
+        if message.nVersion >= 70016:
+            self.send_message(msg_wtxidrelay())
+            if self.sendpackages:
+                self.send_message(msg_sendpackages())
+        super().on_version(message)
+
+    def wait_for_getpkgtxns(self, wtxid):
+        self.wait_until(lambda: "getpkgtxns" in self.last_message and self.last_message["getpkgtxns"].wtxid == wtxid)
+
+
+class PackageRelayTest(BitbiTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        self.extra_args = [[
+            "-datacarriersize=100000",
+            "-maxmempool=5",
+            "-packagerelay",
+        ]]
+
+    def create_parent_and_child(self):
+        parent = self.wallet.create_self_transfer()
+        child = self.wallet.create_self_transfer(utxo_to_spend=parent["new_utxo"])
+        return parent, child
+
+    def test_negotiation(self):
+        node = self.nodes[0]
+        self.log.info("Check that sendpackages is sent before verack")
+        peer = node.add_p2p_connection(PackageRelayPeer())
+        assert b"sendpackages" in peer.msgtypes
+        assert peer.msgtypes.index(b"sendpackages") < peer.msgtypes.index(b"verack")
+        node.disconnect_p2ps()
+
+        self.log.info("Check that sendpackages after verack leads to disconnection")
+        peer = node.add_p2p_connection(PackageRelayPeer(sendpackages=False))
+        with node.assert_debug_log(["sendpackages received after verack"]):
+            peer.send_message(msg_sendpackages())
+            peer.wait_for_disconnect()
+
+        self.log.info("Check that sendpackages is not sent without -packagerelay")
+        self.restart_node(0, extra_args=[])
+        peer = node.add_p2p_connection(PackageRelayPeer())
+        assert b"sendpackages" not in peer.msgtypes
+        self.restart_node(0)
+
+    def test_orphan_package_request(self):
+        node = self.nodes[0]
+        self.log.info("Check that an orphan from a package relay peer is fetched with its parents")
+        parent, child = self.create_parent_and_child()
+        peer = node.add_p2p_connection(PackageRelayPeer())
+        peer.send_and_ping(msg_tx(child["tx"]))
+        child_wtxid = int(child["wtxid"], 16)
+        peer.wait_for_getpkgtxns(child_wtxid)
+        assert child["txid"] not in node.getrawmempool()
+
+        peer.send_and_ping(msg_pkgtxns([parent["tx"], child["tx"]]))
+        assert_equal(sorted(node.getrawmempool()), sorted([parent["txid"], child["txid"]]))
+        self.generate(node, 1)
+        node.disconnect_p2ps()
+
+        self.log.info("Check that the orphan of a peer without package relay is not fetched as a package")
+        parent, child = self.create_parent_and_child()
+        peer = node.add_p2p_connection(PackageRelayPeer(sendpackages=False))
+        peer.send_and_ping(msg_tx(child["tx"]))
+        assert "getpkgtxns" not in peer.last_message
+        node.disconnect_p2ps()
+
+    def fill_mempool(self):
+        """Fill the mempool with large transactions until its minimum feerate exceeds the relay feerate."""
+        node = self.nodes[0]
+        txouts = gen_return_txouts()
+        relayfee = node.getnetworkinfo()["relayfee"]
+        with node.assert_debug_log(["rolling minimum fee bumped"]):
+            for i in range(75):
+                create_lots_of_big_transactions(self.wallet, node, (i + 1) * relayfee * 130, 1, txouts)
+        assert_greater_than(node.getmempoolinfo()["mempoolminfee"], relayfee)
+
+    def test_cpfp(self):
+        node = self.nodes[0]
+        self.log.info("Check that a parent below the mempool minimum feerate is accepted with a child paying for it")
+        self.fill_mempool()
+        parent = self.wallet.create_self_transfer(fee_rate=node.getnetworkinfo()["relayfee"])
+        child = self.wallet.create_self_transfer(utxo_to_spend=parent["new_utxo"], fee_rate=10 * node.getmempoolinfo()["mempoolminfee"])
+        peer = node.add_p2p_connection(PackageRelayPeer())
+        with node.assert_debug_log(["mempool min fee not met"]):
+            peer.send_and_ping(msg_tx(parent["tx"]))
+        assert parent["txid"] not in node.getrawmempool()
+
+        peer.send_and_ping(msg_tx(child["tx"]))
+        peer.wait_for_getpkgtxns(int(child["wtxid"], 16))
+        peer.send_and_ping(msg_pkgtxns([parent["tx"], child["tx"]]))
+        mempool = node.getrawmempool()
+        assert parent["txid"] in mempool
+        assert child["txid"] in mempool
+        node.disconnect_p2ps()
+
+    def test_expired_request(self):
+        node = self.nodes[0]
+        self.log.info("Check that a pkgtxns answer arriving after the request timed out is ignored")
+        parent, child = self.create_parent_and_child()
+        peer = node.add_p2p_connection(PackageRelayPeer())
+        mock_time = int(time.time())
+        node.setmocktime(mock_time)
+        peer.send_and_ping(msg_tx(child["tx"]))
+        peer.wait_for_getpkgtxns(int(child["wtxid"], 16))
+        node.setmocktime(mock_time + 61)
+        with node.assert_debug_log(["unrequested pkgtxns"]):
+            peer.send_and_ping(msg_pkgtxns([parent["tx"], child["tx"]]))
+        assert_equal(node.getrawmempool(), [])
+        node.setmocktime(0)
+        self.wallet.sendrawtransaction(from_node=node, tx_hex=parent["hex"])
+        self.wallet.sendrawtransaction(from_node=node, tx_hex=child["hex"])
+        self.generate(node, 1)
+        node.disconnect_p2ps()
+
+    def test_unsolicited_package(self):
+        node = self.nodes[0]
+        self.log.info("Check that an unrequested pkgtxns is ignored")
+        parent, child = self.create_parent_and_child()
+        peer = node.add_p2p_connection(PackageRelayPeer())
+        with node.assert_debug_log(["unrequested pkgtxns"]):
+            peer.send_and_ping(msg_pkgtxns([parent["tx"], child["tx"]]))
+        assert_equal(node.getrawmempool(), [])
+        node.disconnect_p2ps()
+
+    def test_serve_package(self):
+        node = self.nodes[0]
+        self.log.info("Check that getpkgtxns is answered with the parents and the transaction")
+        peer = node.add_p2p_connection(PackageRelayPeer())
+        parent, child = self.create_parent_and_child()
+        self.wallet.sendrawtransaction(from_node=node, tx_hex=parent["hex"])
+        self.wallet.sendrawtransaction(from_node=node, tx_hex=child["hex"])
+        # Transactions are only served after they have been announced.
+        peer.wait_for_broadcast([parent["wtxid"], child["wtxid"]])
+
+        peer.send_and_ping(msg_getpkgtxns(int(child["wtxid"], 16)))
+        with p2p_lock:
+            txs = peer.last_message["pkgtxns"].txs
+        assert_equal([tx.getwtxid() for tx in txs], [parent["wtxid"], child["wtxid"]])
+
+        self.log.info("Check that getpkgtxns for a transaction without unconfirmed parents is answered with notfound")
+        peer.send_and_ping(msg_getpkgtxns(int(parent["wtxid"], 16)))
+        with p2p_lock:
+            notfound = peer.last_message["notfound"].vec
+        assert_equal([(inv.type, inv.hash) for inv in notfound], [(MSG_WTX, int(parent["wtxid"], 16))])
+        self.generate(node, 1)
+        node.disconnect_p2ps()
+
+    def run_test(self):
+        self.wallet = MiniWallet(self.nodes[0])
+        # Enough mature coins to fill the mempool in test_cpfp()
+        self.generate(self.wallet, COINBASE_MATURITY + 100)
+
+        self.test_negotiation()
+        self.test_orphan_package_request()
+        self.test_unsolicited_package()
+        self.test_serve_package()
+        self.test_expired_request()
+        self.test_cpfp()
+
+
+if __name__ == '__main__':
+    PackageRelayTest().main()
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+# Copyright (c) 2024 The Bitbi Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test transaction announcement through set reconciliation (BIP-330).
+
+The node on the outbound side of a connection initiates reconciliations with
+reqtxrcncl, the other side answers with a sketch of its reconciliation set, and
+the initiator finishes the round with reconcildiff. Transactions the sketches
+show to be missing on either side are then announced by inv.
+"""
+
+from test_framework.blocktools import COINBASE_MATURITY
+from test_framework.messages import (
+    msg_reconcildiff,
+    msg_reqtxrcncl,
+    msg_sendtxrcncl,
+    msg_wtxidrelay,
+)
+from test_framework.p2p import (
+    P2PInterface,
+    p2p_lock,
+)
+from test_framework.test_framework import BitbiTestFramework
+from test_framework.util import assert_equal
+from test_framework.wallet import MiniWallet
+
+
+class ReconciliationPeer(P2PInterface):
+    def __init__(self):
+        super().__init__()
+        # wtxidrelay is sent below, so that sendtxrcncl can follow it.
+        self.wtxidrelay = False
+
+    def on_version(self, message):
+        if message.nVersion >= 70016:
+            self.send_message(msg_wtxidrelay())
+            sendtxrcncl = msg_sendtxrcncl()
+            sendtxrcncl.version = 1
+            sendtxrcncl.salt = 2
+            self.send_message(sendtxrcncl)
+        super().on_version(message)
+
+
+class TxReconciliationTest(BitbiTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.setup_clean_chain = True
+        self.extra_args = [['-txreconciliation']] * self.num_nodes
+
+    def test_relay(self):
+        # node1 connects to node0, so it is the one initiating reconciliations. The transactions
+        # not flooded to it are only announced after a reconciliation round.
+        self.log.info("Check that transactions reach the initiator through reconciliation rounds")
+        txs = [self.wallet.send_self_transfer(from_node=self.nodes[0]) for _ in range(5)]
+        self.sync_mempools()
+        assert all(tx["txid"] in self.nodes[1].getrawmempool() for tx in txs)
+
+        initiator_recv = self.nodes[1].getpeerinfo()[0]["bytesrecv_per_msg"]
+        responder_recv = self.nodes[0].getpeerinfo()[0]["bytesrecv_per_msg"]
+        assert "sketch" in initiator_recv
+        assert "reqtxrcncl" in responder_recv
+        assert "reconcildiff" in responder_recv
+
+    def test_responder(self):
+        node = self.nodes[0]
+        self.log.info("Check that reqtxrcncl from an inbound peer is answered with a sketch")
+        peer = node.add_p2p_connection(ReconciliationPeer())
+        peer.send_and_ping(msg_reqtxrcncl(set_size=0, q=8191))
+        peer.wait_until(lambda: "sketch" in peer.last_message)
+        with p2p_lock:
+            # Both sets are empty: a sketch of capacity one, with nothing in it.
+            assert_equal(peer.last_message["sketch"].skdata, bytes(4))
+        peer.send_and_ping(msg_reconcildiff(success=True))
+
+        self.log.info("Check that reconcildiff without a reconciliation in progress leads to disconnection")
+        with node.assert_debug_log(["unexpected reconcildiff"]):
+            peer.send_message(msg_reconcildiff(success=True))
+            peer.wait_for_disconnect()
+
+        self.log.info("Check that reqtxrcncl before the previous round is finished leads to disconnection")
+        peer = node.add_p2p_connection(ReconciliationPeer())
+        peer.send_and_ping(msg_reqtxrcncl(set_size=0, q=8191))
+        with node.assert_debug_log(["unexpected reqtxrcncl"]):
+            peer.send_message(msg_reqtxrcncl(set_size=0, q=8191))
+            peer.wait_for_disconnect()
+
+    def run_test(self):
+        self.wallet = MiniWallet(self.nodes[0])
+        self.generate(self.wallet, COINBASE_MATURITY + 10)
+
+        self.test_relay()
+        self.test_responder()
+
+
+if __name__ == '__main__':
+    TxReconciliationTest().main()
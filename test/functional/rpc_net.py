@@ -124,6 +124,7 @@ class NetTest(BitbiTestFramework):
                 "addr_relay_enabled": False,
                 "bip152_hb_from": False,
                 "bip152_hb_to": False,
+                "blocks_taken_over": 0,
                 "bytesrecv": 0,
                 "bytesrecv_per_msg": {},
                 "bytessent": 0,
@@ -133,6 +134,7 @@ class NetTest(BitbiTestFramework):
                 "id": no_version_peer_id,
                 "inbound": True,
                 "inflight": [],
+                "inflight_limit": 16,
                 "last_block": 0,
                 "last_transaction": 0,
                 "lastrecv": 0,
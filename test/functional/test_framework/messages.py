@@ -1889,6 +1889,140 @@ class msg_sendtxrcncl:
         return "msg_sendtxrcncl(version=%lu, salt=%lu)" %\
             (self.version, self.salt)
 
+
+class msg_reqtxrcncl:
+    __slots__ = ("set_size", "q")
+    msgtype = b"reqtxrcncl"
+
+    def __init__(self, set_size=0, q=0):
+        self.set_size = set_size
+        self.q = q
+
+    def deserialize(self, f):
+        self.set_size = struct.unpack("<H", f.read(2))[0]
+        self.q = struct.unpack("<H", f.read(2))[0]
+
+    def serialize(self):
+        r = b""
+        r += struct.pack("<H", self.set_size)
+        r += struct.pack("<H", self.q)
+        return r
+
+    def __repr__(self):
+        return "msg_reqtxrcncl(set_size=%lu, q=%lu)" %\
+            (self.set_size, self.q)
+
+
+class msg_sketch:
+    __slots__ = ("skdata",)
+    msgtype = b"sketch"
+
+    def __init__(self, skdata=b""):
+        self.skdata = skdata
+
+    def deserialize(self, f):
+        self.skdata = deser_string(f)
+
+    def serialize(self):
+        return ser_string(self.skdata)
+
+    def __repr__(self):
+        return "msg_sketch(skdata=%s)" % (self.skdata.hex())
+
+
+class msg_reqsketchext:
+    __slots__ = ()
+    msgtype = b"reqsketchext"
+
+    def __init__(self):
+        pass
+
+    def deserialize(self, f):
+        pass
+
+    def serialize(self):
+        return b""
+
+    def __repr__(self):
+        return "msg_reqsketchext()"
+
+
+class msg_reconcildiff:
+    __slots__ = ("success", "ask_shortids")
+    msgtype = b"reconcildiff"
+
+    def __init__(self, success=False, ask_shortids=None):
+        self.success = success
+        self.ask_shortids = ask_shortids if ask_shortids is not None else []
+
+    def deserialize(self, f):
+        self.success = struct.unpack("<B", f.read(1))[0] != 0
+        self.ask_shortids = [struct.unpack("<I", f.read(4))[0] for _ in range(deser_compact_size(f))]
+
+    def serialize(self):
+        r = b""
+        r += struct.pack("<B", self.success)
+        r += ser_compact_size(len(self.ask_shortids))
+        for short_id in self.ask_shortids:
+            r += struct.pack("<I", short_id)
+        return r
+
+    def __repr__(self):
+        return "msg_reconcildiff(success=%s, ask_shortids=%s)" %\
+            (self.success, self.ask_shortids)
+
+
+class msg_sendpackages:
+    __slots__ = ()
+    msgtype = b"sendpackages"
+
+    def __init__(self):
+        pass
+
+    def deserialize(self, f):
+        pass
+
+    def serialize(self):
+        return b""
+
+    def __repr__(self):
+        return "msg_sendpackages()"
+
+
+class msg_getpkgtxns:
+    __slots__ = ("wtxid",)
+    msgtype = b"getpkgtxns"
+
+    def __init__(self, wtxid=0):
+        self.wtxid = wtxid
+
+    def deserialize(self, f):
+        self.wtxid = deser_uint256(f)
+
+    def serialize(self):
+        return ser_uint256(self.wtxid)
+
+    def __repr__(self):
+        return "msg_getpkgtxns(wtxid=%064x)" % (self.wtxid)
+
+
+class msg_pkgtxns:
+    __slots__ = ("txs",)
+    msgtype = b"pkgtxns"
+
+    def __init__(self, txs=None):
+        self.txs = txs or []
+
+    def deserialize(self, f):
+        self.txs = deser_vector(f, CTransaction)
+
+    def serialize(self):
+        return ser_vector(self.txs, "serialize_with_witness")
+
+    def __repr__(self):
+        return "msg_pkgtxns(txs=%s)" % (repr(self.txs))
+
+
 class TestFrameworkScript(unittest.TestCase):
     def test_addrv2_encode_decode(self):
         def check_addrv2(ip, net):